@@ -0,0 +1,319 @@
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include "../../includes/thread_pool.hpp"
+#include "../../common/benchmark/json_writer.hpp"
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed tasks.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Busy-waits for `duration`, standing for the work of a task.
+ */
+static void work(std::chrono::nanoseconds duration) {
+  if (duration.count() > 0) {
+    auto deadline = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < deadline) {}
+  }
+  count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Waits for `count` to reach `target`.
+ */
+static void await(size_t target) {
+  while (count.load(std::memory_order_relaxed) < target) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \struct mutex_pool_t
+ * \brief The textbook thread pool, whose workers share a deque
+ * of `std::function` guarded by a mutex and a condition variable.
+ */
+struct mutex_pool_t {
+
+  explicit mutex_pool_t(size_t concurrency)
+    : done_(false) {
+    for (size_t i = 0; i < concurrency; ++i) {
+      threads_.push_back(std::thread(&mutex_pool_t::worker, this));
+    }
+  }
+
+  ~mutex_pool_t() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      done_ = true;
+    }
+    ready_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void schedule(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      tasks_.push_back(std::move(task));
+    }
+    ready_.notify_one();
+  }
+
+  template <typename F>
+  void schedule_bulk_n(size_t size, const F& f) {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      for (size_t i = 0; i < size; ++i) {
+        tasks_.push_back([f, i] () { f(i); });
+      }
+    }
+    ready_.notify_all();
+  }
+
+private:
+
+  void worker() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        ready_.wait(lock, [this] () { return (done_ || !tasks_.empty()); });
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex lock_;
+  std::condition_variable ready_;
+  bool done_;
+};
+
+/**
+ * \brief The executors which are compared.
+ */
+enum executor_t {
+  POOL,
+  MUTEX_POOL,
+  ASYNC,
+  THREAD_PER_TASK,
+  EXECUTORS
+};
+
+static const char* executor_names[EXECUTORS] = { "pool_t", "mutex_pool", "std::async", "thread_per_task" };
+
+/**
+ * \brief Runs `tasks` tasks with `std::async`, or a thread per task,
+ * keeping at most `threads` of them in flight.
+ */
+template <typename F>
+static void run_threads(executor_t executor, size_t threads, size_t tasks, const F& f) {
+  std::vector<std::future<void>> futures;
+  std::vector<std::thread> spawned;
+  for (size_t started = 0; started < tasks; ) {
+    size_t wave = tasks - started < threads ? tasks - started : threads;
+    for (size_t i = 0; i < wave; ++i, ++started) {
+      if (executor == ASYNC) {
+        futures.push_back(std::async(std::launch::async, f));
+      } else {
+        spawned.push_back(std::thread(f));
+      }
+    }
+    for (std::future<void>& future : futures) {
+      future.get();
+    }
+    for (std::thread& thread : spawned) {
+      thread.join();
+    }
+    futures.clear();
+    spawned.clear();
+  }
+}
+
+/**
+ * \brief Runs `tasks` independent tasks lasting `duration`, scheduled one
+ * at a time, or at once when `bulk` is set.
+ * \return the number of tasks run per second.
+ */
+static double run_independent(executor_t executor, size_t threads, size_t tasks, std::chrono::nanoseconds duration, bool bulk) {
+  auto task = [duration] () { work(duration); };
+  auto indexed = [duration] (size_t) { work(duration); };
+  count = 0;
+  auto start = std::chrono::steady_clock::now();
+  if (executor == POOL) {
+    thread::pool::pool_t pool(threads);
+    if (bulk) {
+      pool.schedule_bulk_n(tasks, indexed);
+    } else {
+      for (size_t i = 0; i < tasks; ++i) {
+        pool.schedule_and_forget(task);
+      }
+    }
+    await(tasks);
+  } else if (executor == MUTEX_POOL) {
+    mutex_pool_t pool(threads);
+    if (bulk) {
+      pool.schedule_bulk_n(tasks, indexed);
+    } else {
+      for (size_t i = 0; i < tasks; ++i) {
+        pool.schedule(task);
+      }
+    }
+    await(tasks);
+  } else {
+    run_threads(executor, threads, tasks, task);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return (tasks / elapsed.count());
+}
+
+/**
+ * \brief Runs `rounds` fork-join rounds, each of them forking 64
+ * tasks lasting a microsecond and joining them.
+ * \return the number of rounds run per second.
+ */
+static double run_fork_join(executor_t executor, size_t threads, size_t rounds) {
+  static const size_t FORK = 64;
+  auto task = [] () { work(std::chrono::microseconds(1)); };
+  count = 0;
+  auto start = std::chrono::steady_clock::now();
+  if (executor == POOL) {
+    thread::pool::pool_t pool(threads);
+    for (size_t round = 0; round < rounds; ++round) {
+      pool.schedule_batch_n(FORK, [] (size_t) { work(std::chrono::microseconds(1)); }).wait();
+    }
+  } else if (executor == MUTEX_POOL) {
+    mutex_pool_t pool(threads);
+    for (size_t round = 1; round <= rounds; ++round) {
+      for (size_t i = 0; i < FORK; ++i) {
+        pool.schedule(task);
+      }
+      await(round * FORK);
+    }
+  } else {
+    for (size_t round = 0; round < rounds; ++round) {
+      run_threads(executor, threads, FORK, task);
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return (rounds / elapsed.count());
+}
+
+/**
+ * \struct workload_t
+ * \brief A workload run on every executor.
+ */
+struct workload_t {
+  const char* name;
+  const char* unit;
+  std::chrono::nanoseconds duration;
+  size_t tasks;
+  size_t thread_tasks;
+  bool bulk;
+  bool fork_join;
+};
+
+/**
+ * \brief Application entry point, which runs every workload on every
+ * executor with 1 to N threads, N being the hardware concurrency or the
+ * first argument, and prints a table per workload, or writes the results
+ * as JSON if `--json` is given.
+ */
+int main(int argc, char* argv[]) {
+  size_t max_threads = std::thread::hardware_concurrency();
+  bool as_json = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--json") == 0) {
+      as_json = true;
+    } else {
+      max_threads = std::strtoul(argv[i], nullptr, 10);
+    }
+  }
+  max_threads = max_threads > 0 ? max_threads : 1;
+  std::vector<size_t> threads;
+  for (size_t count = 1; count < max_threads; count *= 2) {
+    threads.push_back(count);
+  }
+  threads.push_back(max_threads);
+
+  // Executors spawning a thread per task run fewer tasks, since the
+  // results are given as rates.
+  const workload_t workloads[] = {
+    { "empty", "tasks/s", std::chrono::nanoseconds(0), 200 * 1000, 5 * 1000, false, false },
+    { "1us", "tasks/s", std::chrono::microseconds(1), 100 * 1000, 5 * 1000, false, false },
+    { "100us", "tasks/s", std::chrono::microseconds(100), 2 * 1000, 1 * 1000, false, false },
+    { "bulk", "tasks/s", std::chrono::nanoseconds(0), 200 * 1000, 0, true, false },
+    { "fork_join", "rounds/s", std::chrono::nanoseconds(0), 1000, 100, false, true }
+  };
+
+  json_writer_t json(std::cout);
+  if (as_json) {
+    json.begin_object().value("benchmark", "executors");
+    json.begin_array("results");
+  }
+  for (const workload_t& workload : workloads) {
+    if (!as_json) {
+      std::cout << std::endl << workload.name << " (" << workload.unit << ")" << std::endl;
+      std::cout << std::left << std::setw(10) << "threads";
+      for (const char* name : executor_names) {
+        std::cout << std::setw(18) << name;
+      }
+      std::cout << std::endl;
+    }
+    for (size_t count : threads) {
+      if (!as_json) {
+        std::cout << std::left << std::setw(10) << count;
+      }
+      for (size_t e = 0; e < EXECUTORS; ++e) {
+        executor_t executor = static_cast<executor_t>(e);
+        bool spawning = executor == ASYNC || executor == THREAD_PER_TASK;
+        size_t tasks = spawning ? workload.thread_tasks : workload.tasks;
+        // Executors without a bulk interface do not run the bulk workload.
+        double rate = tasks == 0 ? 0
+          : workload.fork_join ? run_fork_join(executor, count, tasks)
+          : run_independent(executor, count, tasks, workload.duration, workload.bulk);
+        if (as_json) {
+          json.begin_object()
+            .value("workload", workload.name)
+            .value("executor", executor_names[e])
+            .value("threads", static_cast<uint64_t>(count))
+            .value("unit", workload.unit);
+          if (tasks > 0) {
+            json.value("rate", rate);
+          } else {
+            json.null("rate");
+          }
+          json.end_object();
+        } else if (tasks > 0) {
+          std::cout << std::setw(18) << std::fixed << std::setprecision(0) << rate;
+        } else {
+          std::cout << std::setw(18) << "-";
+        }
+      }
+      if (!as_json) {
+        std::cout << std::endl;
+      }
+    }
+  }
+  if (as_json) {
+    json.end_array();
+    json.end_object();
+    json.finish();
+  }
+  return (0);
+}
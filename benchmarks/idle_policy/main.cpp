@@ -0,0 +1,85 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <ctime>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief The number of tasks scheduled per measurement.
+ */
+static const size_t iterations = 2000;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed tasks.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief The wakeup latency of every scheduled task, in microseconds.
+ */
+static std::vector<double> latencies(iterations);
+
+/**
+ * \return the processor time consumed by the process, in milliseconds.
+ */
+static double cpu_time() {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (ts.tv_sec * 1e3 + ts.tv_nsec / 1e6);
+}
+
+/**
+ * \brief Schedules `iterations` tasks one at a time on a single-worker
+ * pool using the given idle policy, with `gap` between two tasks, and
+ * reports the wakeup latency along with the processor time burnt.
+ */
+template <typename IdlePolicy>
+void run(const char* name, std::chrono::microseconds gap) {
+  thread::pool::parameterized_pool_t<
+    thread::pool::WORK_PARTITIONING_HEAVY,
+    1 * 1000,
+    IdlePolicy
+  > pool(1);
+
+  count = 0;
+  auto cpu_start = cpu_time();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    auto scheduled = std::chrono::steady_clock::now();
+    pool.schedule_and_forget([scheduled, i] () {
+      std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - scheduled;
+      latencies[i] = latency.count();
+      ++count;
+    });
+    while (count < i + 1) {
+      std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(gap);
+  }
+  std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - start;
+  auto cpu = cpu_time() - cpu_start;
+
+  std::sort(latencies.begin(), latencies.end());
+  std::cout << std::left << std::setw(22) << name
+            << std::setw(10) << gap.count()
+            << std::setw(14) << latencies[iterations / 2]
+            << std::setw(14) << latencies[iterations * 99 / 100]
+            << std::setw(14) << 100.0 * cpu / wall.count() << std::endl;
+}
+
+/**
+ * \brief Application entry point.
+ */
+int main() {
+  std::cout << std::left << std::setw(22) << "policy" << std::setw(10) << "gap (us)"
+            << std::setw(14) << "p50 (us)" << std::setw(14) << "p99 (us)"
+            << std::setw(14) << "cpu (%)" << std::endl;
+  for (auto gap : { std::chrono::microseconds(10), std::chrono::microseconds(100), std::chrono::microseconds(1000) }) {
+    run<thread::pool::busy_poll_t>("busy-poll", gap);
+    run<thread::pool::spin_yield_park_t<>>("spin-yield-park", gap);
+    run<thread::pool::spin_yield_park_t<200, 200>>("spin-200-yield-200", gap);
+    run<thread::pool::park_immediately_t>("park-immediately", gap);
+  }
+  return (0);
+}
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../../includes/thread_pool.hpp"
+#include "../../common/benchmark/json_writer.hpp"
+
+/**
+ * \struct options_t
+ * \brief The options of the load generator, given on the command line
+ * as `--name value` pairs.
+ */
+struct options_t {
+
+  /**
+   * \brief The number of workers of the pool.
+   */
+  size_t workers = std::thread::hardware_concurrency();
+
+  /**
+   * \brief The target utilization of the workers, which
+   * sets the arrival rate given the mean service time.
+   */
+  double utilization = 0.7;
+
+  /**
+   * \brief The arrival process, `poisson` or `constant`.
+   */
+  std::string arrivals = "poisson";
+
+  /**
+   * \brief The distribution of service times, `constant`,
+   * `exponential` or `bimodal`.
+   */
+  std::string service = "exponential";
+
+  /**
+   * \brief The mean service time, in microseconds.
+   */
+  double mean_service_us = 10;
+
+  /**
+   * \brief How long tasks are submitted for, in milliseconds.
+   */
+  size_t duration_ms = 1000;
+
+  /**
+   * \brief The `BULK_MAX_ITEMS` of the pool, among 1, 10, 100 and 500.
+   */
+  size_t bulk = thread::pool::WORK_PARTITIONING_HEAVY;
+
+  /**
+   * \brief The seed of the random distributions.
+   */
+  unsigned seed = 42;
+};
+
+/**
+ * \brief In the bimodal distribution, the share of slow
+ * tasks, and how much slower than the others they are.
+ */
+static const double SLOW_SHARE = 0.1;
+static const double SLOW_FACTOR = 10;
+
+/**
+ * \struct record_t
+ * \brief The timestamps of a task, in nanoseconds: when it was meant to
+ * be submitted according to the open-loop schedule, when it actually
+ * was, when it started and when it finished.
+ */
+struct record_t {
+  uint64_t scheduled;
+  uint64_t submitted;
+  uint64_t started;
+  uint64_t finished;
+  uint64_t service;
+};
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of finished tasks.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Runs a task, busy-waiting for its service time.
+ */
+static void serve(record_t* record) {
+  record->started = thread::pool::steady_now();
+  uint64_t deadline = record->started + record->service;
+  while (thread::pool::steady_now() < deadline) {}
+  record->finished = thread::pool::steady_now();
+  count.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * \brief Waits until the steady clock reaches `time`, sleeping while it is
+ * far away and yielding otherwise, so that the generator leaves the CPU
+ * to the workers when there are more threads than CPUs.
+ */
+static void wait_until(uint64_t time) {
+  for (uint64_t now = thread::pool::steady_now(); now < time; now = thread::pool::steady_now()) {
+    if (time - now > 200 * 1000) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(time - now - 100 * 1000));
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/**
+ * \brief Submits tasks following the open-loop schedule, whatever
+ * the state of the pool, and waits for all of them to finish.
+ * \return the records of the submitted tasks.
+ */
+template <size_t BULK>
+std::vector<record_t> generate(const options_t& options) {
+  std::mt19937_64 random(options.seed);
+  double mean_service = options.mean_service_us * 1000.0;
+  double rate = options.utilization * options.workers / mean_service;
+  std::exponential_distribution<double> interarrival(rate);
+  std::exponential_distribution<double> exponential(1.0 / mean_service);
+  std::bernoulli_distribution slow(SLOW_SHARE);
+  double fast = mean_service / (1 - SLOW_SHARE + SLOW_SHARE * SLOW_FACTOR);
+
+  uint64_t duration = options.duration_ms * 1000 * 1000;
+  std::vector<record_t> records(static_cast<size_t>(rate * duration * 1.5) + 1024);
+  thread::pool::parameterized_pool_t<BULK, 100> pool(options.workers);
+  const auto token = pool.template create_token_of<typename thread::pool::parameterized_pool_t<BULK, 100>::producer_token_t>();
+
+  count = 0;
+  size_t submitted = 0;
+  uint64_t start = thread::pool::steady_now() + 1000 * 1000;
+  double offset = 0;
+  while (submitted < records.size()) {
+    offset += options.arrivals == "constant" ? 1.0 / rate : interarrival(random);
+    if (offset >= duration) {
+      break;
+    }
+    record_t& record = records[submitted++];
+    record.scheduled = start + static_cast<uint64_t>(offset);
+    if (options.service == "constant") {
+      record.service = static_cast<uint64_t>(mean_service);
+    } else if (options.service == "bimodal") {
+      record.service = static_cast<uint64_t>(slow(random) ? fast * SLOW_FACTOR : fast);
+    } else {
+      record.service = static_cast<uint64_t>(exponential(random));
+    }
+    wait_until(record.scheduled);
+    record.submitted = thread::pool::steady_now();
+    pool.schedule_and_forget(token, &serve, &record);
+  }
+  while (count.load(std::memory_order_acquire) < submitted) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  records.resize(submitted);
+  return (records);
+}
+
+/**
+ * \brief Writes the cumulative distribution of `values` at a fixed
+ * set of percentiles.
+ */
+static void write_cdf(json_writer_t& json, const char* name, std::vector<uint64_t> values) {
+  static const double percentiles[] = { 0, 10, 25, 50, 75, 90, 95, 99, 99.9, 99.99, 100 };
+  std::sort(values.begin(), values.end());
+  json.begin_array(name);
+  for (double percentile : percentiles) {
+    size_t rank = values.empty() ? 0 : static_cast<size_t>(percentile / 100.0 * (values.size() - 1) + 0.5);
+    json.begin_object()
+      .value("percentile", percentile)
+      .value("ns", values.empty() ? uint64_t(0) : values[rank])
+      .end_object();
+  }
+  json.end_array();
+}
+
+/**
+ * \brief Parses the command line into `options`.
+ * \return false if an option is unknown.
+ */
+static bool parse(int argc, char* argv[], options_t& options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string name(argv[i]);
+    const char* value = argv[i + 1];
+    if (name == "--workers") {
+      options.workers = std::strtoul(value, nullptr, 10);
+    } else if (name == "--utilization") {
+      options.utilization = std::strtod(value, nullptr);
+    } else if (name == "--arrivals") {
+      options.arrivals = value;
+    } else if (name == "--service") {
+      options.service = value;
+    } else if (name == "--mean-service-us") {
+      options.mean_service_us = std::strtod(value, nullptr);
+    } else if (name == "--duration-ms") {
+      options.duration_ms = std::strtoul(value, nullptr, 10);
+    } else if (name == "--bulk") {
+      options.bulk = std::strtoul(value, nullptr, 10);
+    } else if (name == "--seed") {
+      options.seed = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+    } else {
+      return (false);
+    }
+  }
+  options.workers = options.workers > 0 ? options.workers : 1;
+  return ((argc % 2) == 1
+    && (options.arrivals == "poisson" || options.arrivals == "constant")
+    && (options.service == "constant" || options.service == "exponential" || options.service == "bimodal")
+    && (options.bulk == 1 || options.bulk == 10 || options.bulk == 100 || options.bulk == 500)
+    && options.utilization > 0 && options.mean_service_us > 0);
+}
+
+/**
+ * \brief Application entry point, which submits tasks to a pool on an
+ * open-loop schedule and writes the distribution of their latencies as
+ * JSON on the standard output.
+ */
+int main(int argc, char* argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::cerr << "usage: " << argv[0] << " [--workers n] [--utilization u] [--arrivals poisson|constant]"
+      << " [--service constant|exponential|bimodal] [--mean-service-us t] [--duration-ms d]"
+      << " [--bulk 1|10|100|500] [--seed s]" << std::endl;
+    return (1);
+  }
+  std::vector<record_t> records =
+    options.bulk == 1 ? generate<1>(options) :
+    options.bulk == 10 ? generate<10>(options) :
+    options.bulk == 100 ? generate<100>(options) : generate<500>(options);
+
+  std::vector<uint64_t> lag, wait, response;
+  uint64_t service = 0, first = ~uint64_t(0), last = 0;
+  for (const record_t& record : records) {
+    lag.push_back(record.submitted - record.scheduled);
+    wait.push_back(record.started - record.scheduled);
+    response.push_back(record.finished - record.scheduled);
+    service += record.finished - record.started;
+    first = record.scheduled < first ? record.scheduled : first;
+    last = record.finished > last ? record.finished : last;
+  }
+  double elapsed = records.empty() ? 0 : static_cast<double>(last - first);
+
+  json_writer_t json(std::cout);
+  json.begin_object()
+    .value("benchmark", "load_generator")
+    .value("workers", static_cast<uint64_t>(options.workers))
+    .value("target_utilization", options.utilization)
+    .value("arrivals", options.arrivals)
+    .value("service", options.service)
+    .value("mean_service_us", options.mean_service_us)
+    .value("bulk_max_items", static_cast<uint64_t>(options.bulk))
+    .value("tasks", static_cast<uint64_t>(records.size()))
+    .value("achieved_utilization", elapsed > 0 ? service / (elapsed * options.workers) : 0.0);
+  // Latencies are measured from the scheduled submission of each task,
+  // so that a generator falling behind does not hide queueing delay.
+  write_cdf(json, "submission_lag", lag);
+  write_cdf(json, "queue_wait", wait);
+  write_cdf(json, "response_time", response);
+  json.end_object();
+  json.finish();
+  return (0);
+}
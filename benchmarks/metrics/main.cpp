@@ -0,0 +1,94 @@
+#include <iostream>
+#include <iomanip>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief The number of tasks to schedule.
+ */
+static const size_t tasks = 2 * 1000 * 1000;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed tasks.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief A pool collecting metrics.
+ */
+using metered_pool_t = thread::pool::parameterized_pool_t<
+  thread::pool::WORK_PARTITIONING_HEAVY,
+  1000,
+  thread::pool::spin_yield_park_t<>,
+  thread::pool::moodycamel_queue_t,
+  thread::pool::pool_metrics_t
+>;
+
+/**
+ * \brief Busy-waits for `duration`, standing for the work of a task.
+ */
+static void work(std::chrono::nanoseconds duration) {
+  if (duration.count() > 0) {
+    auto deadline = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < deadline) {}
+  }
+  count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Schedules `tasks` tasks lasting `duration` one at a time,
+ * or in bulk, on the given pool.
+ * \return the throughput, in millions of tasks per second.
+ */
+template <typename Pool>
+double run(Pool& pool, bool bulk, std::chrono::nanoseconds duration) {
+  size_t tasks = duration.count() > 0 ? ::tasks / 10 : ::tasks;
+  count = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  if (bulk) {
+    pool.schedule_bulk_n(tasks, [duration] (size_t) { work(duration); });
+  } else {
+    for (size_t i = 0; i < tasks; ++i) {
+      pool.schedule_and_forget([duration] () { work(duration); });
+    }
+  }
+  while (count < tasks) {
+    std::this_thread::yield();
+  }
+  std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - start;
+  return (tasks / diff.count() / 1e6);
+}
+
+/**
+ * \brief Compares the throughput of a pool with and without metrics,
+ * running tasks lasting `duration`.
+ */
+void compare(const char* name, bool bulk, std::chrono::nanoseconds duration) {
+  thread::pool::pool_t plain(std::thread::hardware_concurrency());
+  metered_pool_t metered(std::thread::hardware_concurrency());
+  double without = run(plain, bulk, duration);
+  double with = run(metered, bulk, duration);
+
+  std::cout << std::left << std::setw(24) << name
+            << std::fixed << std::setprecision(2)
+            << std::setw(16) << without
+            << std::setw(16) << with
+            << (without - with) / without * 100.0 << " %" << std::endl;
+  thread::pool::metrics_snapshot_t snapshot = metered.snapshot();
+  std::cout << "  run time p50/p99 " << snapshot.run_time.percentile(50) << "/" << snapshot.run_time.percentile(99)
+            << " ns, queue wait p50/p99 " << snapshot.queue_wait.percentile(50) << "/" << snapshot.queue_wait.percentile(99)
+            << " ns" << std::endl;
+}
+
+/**
+ * \brief Application entry point.
+ */
+int main() {
+  std::cout << std::left << std::setw(24) << "scenario" << std::setw(16) << "Mtasks/s"
+            << std::setw(16) << "with metrics" << "overhead" << std::endl;
+  compare("schedule_and_forget", false, std::chrono::nanoseconds(0));
+  compare("schedule_bulk_n", true, std::chrono::nanoseconds(0));
+  compare("schedule_and_forget 1us", false, std::chrono::microseconds(1));
+  compare("schedule_bulk_n 1us", true, std::chrono::microseconds(1));
+  return (0);
+}
@@ -0,0 +1,183 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "../../includes/thread_pool.hpp"
+#include "../../common/benchmark/perf_counters.hpp"
+#include "../../common/benchmark/json_writer.hpp"
+
+/**
+ * \brief The number of tasks scheduled by each scenario,
+ * which can be given as the first argument.
+ */
+static size_t tasks = 1000 * 1000;
+
+/**
+ * \brief The number of workers of the pools.
+ */
+static const size_t workers = std::thread::hardware_concurrency();
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed tasks.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief The task run by every scenario.
+ */
+static void task() {
+  count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Waits for `target` tasks to have run.
+ */
+static void await(size_t target) {
+  while (count.load(std::memory_order_relaxed) < target) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Schedules every task with `.schedule()`, and waits for their futures.
+ */
+static void run_schedule(bool token) {
+  thread::pool::pool_t pool(workers);
+  const auto producer = pool.create_token_of<thread::pool::pool_t::producer_token_t>();
+  std::vector<std::future<void>> futures;
+  futures.reserve(tasks);
+  for (size_t i = 0; i < tasks; ++i) {
+    futures.push_back(token ? pool.schedule(producer, &task) : pool.schedule(&task));
+  }
+  for (std::future<void>& future : futures) {
+    future.wait();
+  }
+}
+
+/**
+ * \brief Schedules every task with `.schedule_and_forget()`.
+ */
+static void run_schedule_and_forget(bool token) {
+  thread::pool::pool_t pool(workers);
+  const auto producer = pool.create_token_of<thread::pool::pool_t::producer_token_t>();
+  for (size_t i = 0; i < tasks; ++i) {
+    if (token) {
+      pool.schedule_and_forget(producer, &task);
+    } else {
+      pool.schedule_and_forget(&task);
+    }
+  }
+  await(tasks);
+}
+
+/**
+ * \brief Schedules the tasks with `.schedule_bulk()`, by arrays of 1000 tasks.
+ */
+static void run_schedule_bulk(bool token) {
+  static const size_t BULK = 1000;
+  thread::pool::pool_t pool(workers);
+  const auto producer = pool.create_token_of<thread::pool::pool_t::producer_token_t>();
+  std::vector<void (*)()> bulk(BULK, &task);
+  for (size_t scheduled = 0; scheduled < tasks; scheduled += BULK) {
+    size_t size = tasks - scheduled < BULK ? tasks - scheduled : BULK;
+    if (token) {
+      pool.schedule_bulk(producer, bulk.begin(), bulk.begin() + size);
+    } else {
+      pool.schedule_bulk(bulk.begin(), bulk.begin() + size);
+    }
+  }
+  await(tasks);
+}
+
+/**
+ * \brief A pool of producers schedules the tasks on a pool of consumers,
+ * each producer scheduling 1000 tasks with a token of its own.
+ */
+static void run_producers_consumers(bool token) {
+  static const size_t PER_PRODUCER = 1000;
+  thread::pool::pool_t consumers(workers);
+  thread::pool::pool_t producers(workers);
+  size_t batches = (tasks + PER_PRODUCER - 1) / PER_PRODUCER;
+  auto batch = producers.schedule_batch_n(batches, [&consumers, token] (size_t) {
+    if (token) {
+      const auto producer = consumers.create_token_of<thread::pool::pool_t::producer_token_t>();
+      for (size_t i = 0; i < PER_PRODUCER; ++i) {
+        consumers.schedule_and_forget(producer, &task);
+      }
+    } else {
+      for (size_t i = 0; i < PER_PRODUCER; ++i) {
+        consumers.schedule_and_forget(&task);
+      }
+    }
+  });
+  batch.wait();
+  await(batches * PER_PRODUCER);
+}
+
+/**
+ * \brief Runs a scenario within the counters, including the creation
+ * and destruction of its pools, so that the events of their workers are
+ * accounted for, and writes its results.
+ */
+static void measure(json_writer_t& json, const char* name, bool token, void (*scenario)(bool)) {
+  perf_counters_t counters;
+  count = 0;
+  counters.start();
+  auto start = std::chrono::steady_clock::now();
+  scenario(token);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  counters.stop();
+  size_t run = count.load();
+
+  json.begin_object()
+    .value("name", name)
+    .value("token", token)
+    .value("tasks", static_cast<uint64_t>(run))
+    .value("seconds", elapsed.count())
+    .value("tasks_per_second", run / elapsed.count());
+  json.begin_object("totals");
+  for (size_t i = 0; i < perf_counters_t::EVENTS; ++i) {
+    if (counters.available(i)) {
+      json.value(perf_counters_t::name(i), counters.value(i));
+    } else {
+      json.null(perf_counters_t::name(i));
+    }
+  }
+  json.end_object();
+  json.begin_object("per_task");
+  for (size_t i = 0; i < perf_counters_t::EVENTS; ++i) {
+    if (counters.available(i)) {
+      json.value(perf_counters_t::name(i), static_cast<double>(counters.value(i)) / run);
+    } else {
+      json.null(perf_counters_t::name(i));
+    }
+  }
+  json.end_object();
+  json.end_object();
+}
+
+/**
+ * \brief Application entry point, which writes the results as JSON
+ * on the standard output. Counters which cannot be opened, for lack
+ * of permissions or hardware support, are reported as null.
+ */
+int main(int argc, char* argv[]) {
+  if (argc > 1) {
+    tasks = std::strtoul(argv[1], nullptr, 10);
+  }
+  json_writer_t json(std::cout);
+  json.begin_object()
+    .value("benchmark", "perf_counters")
+    .value("workers", static_cast<uint64_t>(workers));
+  json.begin_array("scenarios");
+  for (int token = 0; token < 2; ++token) {
+    measure(json, "schedule", token, &run_schedule);
+    measure(json, "schedule_and_forget", token, &run_schedule_and_forget);
+    measure(json, "schedule_bulk", token, &run_schedule_bulk);
+    measure(json, "producers_consumers", token, &run_producers_consumers);
+  }
+  json.end_array();
+  json.end_object();
+  json.finish();
+  return (0);
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <iomanip>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief The number of tasks scheduled per measurement.
+ */
+static const size_t iterations = 1000 * 1000;
+
+/**
+ * \brief The number of tasks scheduled at once by producers.
+ */
+static const size_t chunk = 32;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed tasks.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief A producer scheduling `tasks` empty tasks in chunks
+ * on the given pool, retrying whenever a bounded queue is full.
+ */
+template <typename Pool>
+void producer(Pool* pool, size_t tasks) {
+  std::vector<thread::pool::consumer_t> callables(chunk, [] () { ++count; });
+  for (size_t i = 0; i < tasks; i += chunk) {
+    while (!pool->schedule_bulk(callables.data(), chunk)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/**
+ * \brief Runs `producers` producer threads against a pool of `consumers`
+ * workers using the given queue backend, and reports the throughput.
+ */
+template <template <typename> class Queue>
+void run(const char* name, size_t producers, size_t consumers) {
+  using pool_t = thread::pool::parameterized_pool_t<
+    thread::pool::WORK_PARTITIONING_HEAVY,
+    1 * 1000,
+    thread::pool::spin_yield_park_t<>,
+    Queue
+  >;
+  pool_t pool(consumers, 64 * 1024);
+  std::vector<std::thread> threads;
+
+  count = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < producers; ++i) {
+    threads.push_back(std::thread(producer<pool_t>, &pool, iterations / producers));
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  while (count < iterations / producers / chunk * chunk * producers) {
+    std::this_thread::yield();
+  }
+  std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - start;
+
+  std::cout << std::left << std::setw(12) << name
+            << std::setw(12) << producers
+            << std::setw(12) << consumers
+            << std::fixed << std::setprecision(2)
+            << count / diff.count() / 1e6 << std::endl;
+}
+
+/**
+ * \brief Application entry point.
+ */
+int main() {
+  size_t concurrency = std::thread::hardware_concurrency() + 1;
+
+  std::cout << std::left << std::setw(12) << "queue" << std::setw(12) << "producers"
+            << std::setw(12) << "consumers" << "Mtasks/s" << std::endl;
+  run<thread::pool::moodycamel_queue_t>("moodycamel", 1, 1);
+  run<thread::pool::locked_queue_t>("locked", 1, 1);
+  run<thread::pool::mpmc_queue_t>("mpmc", 1, 1);
+  run<thread::pool::spsc_queue_t>("spsc", 1, 1);
+  run<thread::pool::moodycamel_queue_t>("moodycamel", 4, concurrency);
+  run<thread::pool::locked_queue_t>("locked", 4, concurrency);
+  run<thread::pool::mpmc_queue_t>("mpmc", 4, concurrency);
+  return (0);
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief The number of producer threads.
+ */
+static const size_t producers = 64;
+
+/**
+ * \brief The number of tasks scheduled by each producer.
+ */
+static const size_t tasks_per_producer = 20 * 1000;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed tasks.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Schedules tasks capturing `SIZE` bytes, which do not fit inline
+ * within a task, from `producers` threads on a pool allocating them from
+ * the global heap or from its slabs, and reports the throughput.
+ */
+template <size_t SIZE>
+void run(const char* name, bool slabs) {
+  thread::pool::pool_options_t options;
+  options.task_slabs = slabs;
+  thread::pool::pool_t pool(std::thread::hardware_concurrency(), options);
+  std::vector<std::thread> threads;
+
+  count = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < producers; ++i) {
+    threads.push_back(std::thread([&pool] () {
+      std::array<char, SIZE> payload = {};
+      for (size_t j = 0; j < tasks_per_producer; ++j) {
+        pool.schedule_and_forget([payload] () { count += payload.size() > 0; });
+      }
+    }));
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  while (count < producers * tasks_per_producer) {
+    std::this_thread::yield();
+  }
+  std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - start;
+  thread::pool::allocation_stats_t stats = pool.allocation_stats();
+
+  std::cout << std::left << std::setw(12) << name
+            << std::setw(12) << SIZE
+            << std::fixed << std::setprecision(2)
+            << std::setw(12) << count / diff.count() / 1e6
+            << stats.allocations << std::endl;
+}
+
+/**
+ * \brief Application entry point.
+ */
+int main() {
+  std::cout << std::left << std::setw(12) << "allocator" << std::setw(12) << "bytes"
+            << std::setw(12) << "Mtasks/s" << "allocations" << std::endl;
+  run<64>("malloc", false);
+  run<64>("slabs", true);
+  run<256>("malloc", false);
+  run<256>("slabs", true);
+  run<1024>("malloc", false);
+  run<1024>("slabs", true);
+  return (0);
+}
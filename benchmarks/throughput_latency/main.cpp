@@ -0,0 +1,297 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include "../../includes/thread_pool.hpp"
+#include "../../common/benchmark/json_writer.hpp"
+
+/**
+ * \brief The number of tasks scheduled to measure the throughput,
+ * which can be given as the first argument.
+ */
+static size_t tasks = 200 * 1000;
+
+/**
+ * \brief The load of the latency phase, as a fraction of the
+ * measured throughput, which can be given as the second argument.
+ */
+static double load = 0.5;
+
+/**
+ * \brief How long tasks are scheduled for during the latency phase.
+ */
+static const std::chrono::milliseconds latency_phase(250);
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed tasks.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \struct recorder_t
+ * \brief The latencies observed by a single worker.
+ */
+struct recorder_t {
+
+  /**
+   * \brief The time from the enqueue of tasks to their start.
+   */
+  thread::pool::log_histogram_t raw;
+
+  /**
+   * \brief The time from the intended enqueue of tasks to their start,
+   * which accounts for the tasks a producer could not schedule on time
+   * because the pool held it back, correcting the coordinated omission.
+   */
+  thread::pool::log_histogram_t corrected;
+};
+
+/**
+ * \brief The recorders of every worker of the current configuration.
+ */
+static std::vector<std::unique_ptr<recorder_t>> recorders;
+
+/**
+ * \brief Lock guarding the recorders.
+ */
+static std::mutex recorders_lock;
+
+/**
+ * \return the recorder of the calling worker, created on first use.
+ */
+static recorder_t& local_recorder() {
+  static thread_local recorder_t* recorder = nullptr;
+  if (recorder == nullptr) {
+    std::lock_guard<std::mutex> lock(recorders_lock);
+    recorders.emplace_back(new recorder_t());
+    recorder = recorders.back().get();
+  }
+  return (*recorder);
+}
+
+/**
+ * \struct probe_t
+ * \brief A task of `SIZE` bytes recording its latency, which is stored
+ * inline within a task for small sizes, and allocated otherwise.
+ */
+template <size_t SIZE>
+struct probe_t {
+
+  static_assert(SIZE >= 2 * sizeof(uint64_t), "probes hold two timestamps");
+
+  /**
+   * \brief The time at which the task should have been enqueued, zero
+   * when only the throughput is measured, and the time it was enqueued.
+   */
+  uint64_t intended;
+  uint64_t enqueued;
+
+  /**
+   * \brief Brings the task to its size.
+   */
+  char payload[SIZE - 2 * sizeof(uint64_t)];
+
+  void operator()() const {
+    if (intended != 0) {
+      uint64_t start = thread::pool::steady_now();
+      recorder_t& recorder = local_recorder();
+      recorder.raw.record(start - enqueued);
+      recorder.corrected.record(start - intended);
+    }
+    count.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * \struct config_t
+ * \brief A configuration of the benchmark.
+ */
+struct config_t {
+  size_t producers;
+  size_t consumers;
+  size_t task_size;
+  size_t bulk;
+  bool token;
+};
+
+/**
+ * \struct result_t
+ * \brief The results of a configuration.
+ */
+struct result_t {
+  double throughput;
+  double enqueue_ns;
+  thread::pool::histogram_snapshot_t raw;
+  thread::pool::histogram_snapshot_t corrected;
+};
+
+/**
+ * \brief Schedules tasks on `pool` from a producer, either as fast as
+ * possible, or one every `interval` nanoseconds if it is not zero.
+ * \return the time spent scheduling, in nanoseconds.
+ */
+template <size_t SIZE, typename Pool>
+uint64_t produce(Pool& pool, bool token, size_t tasks, uint64_t interval) {
+  const auto producer = pool.template create_token_of<typename Pool::producer_token_t>();
+  probe_t<SIZE> probe;
+  std::memset(&probe, 0, sizeof(probe));
+  uint64_t start = thread::pool::steady_now();
+  for (size_t i = 0; i < tasks; ++i) {
+    if (interval > 0) {
+      // A producer which fell behind schedules right away, while
+      // its tasks keep the time they were meant to be enqueued at.
+      probe.intended = start + i * interval;
+      // Yielding while waiting, so that producers leave the
+      // CPU to the workers when there are more threads than CPUs.
+      while (thread::pool::steady_now() < probe.intended) {
+        std::this_thread::yield();
+      }
+      probe.enqueued = thread::pool::steady_now();
+    }
+    if (token) {
+      pool.schedule_and_forget(producer, probe);
+    } else {
+      pool.schedule_and_forget(probe);
+    }
+  }
+  return (thread::pool::steady_now() - start);
+}
+
+/**
+ * \brief Runs the producers of a phase, each of them scheduling `tasks`
+ * tasks, and waits for every task to have run.
+ * \return the mean time spent by the producers scheduling a task.
+ */
+template <size_t SIZE, typename Pool>
+double phase(Pool& pool, const config_t& config, size_t tasks, uint64_t interval) {
+  std::vector<std::thread> producers;
+  std::vector<uint64_t> elapsed(config.producers);
+  count = 0;
+  for (size_t i = 0; i < config.producers; ++i) {
+    producers.push_back(std::thread([&pool, &config, &elapsed, i, tasks, interval] () {
+      elapsed[i] = produce<SIZE>(pool, config.token, tasks, interval);
+    }));
+  }
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+  while (count.load(std::memory_order_relaxed) < tasks * config.producers) {
+    std::this_thread::yield();
+  }
+  uint64_t total = 0;
+  for (uint64_t value : elapsed) {
+    total += value;
+  }
+  return (static_cast<double>(total) / (tasks * config.producers));
+}
+
+/**
+ * \brief Measures the throughput of a configuration, and then the latency
+ * of its tasks at `load` times this throughput.
+ */
+template <size_t SIZE, size_t BULK>
+result_t measure(const config_t& config) {
+  using pool_t = thread::pool::parameterized_pool_t<BULK, 100>;
+  result_t result;
+  recorders.clear();
+  {
+    pool_t pool(config.consumers);
+    size_t per_producer = tasks / config.producers;
+    auto start = std::chrono::steady_clock::now();
+    result.enqueue_ns = phase<SIZE>(pool, config, per_producer, 0);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.throughput = per_producer * config.producers / elapsed.count();
+
+    // Spreading the target rate across the producers.
+    double rate = result.throughput * load / config.producers;
+    uint64_t interval = static_cast<uint64_t>(1e9 / rate) + 1;
+    size_t paced = static_cast<size_t>(rate * std::chrono::duration<double>(latency_phase).count()) + 1;
+    phase<SIZE>(pool, config, paced, interval);
+  }
+  for (const std::unique_ptr<recorder_t>& recorder : recorders) {
+    recorder->raw.merge_into(result.raw);
+    recorder->corrected.merge_into(result.corrected);
+  }
+  return (result);
+}
+
+/**
+ * \brief Dispatches a configuration to the matching instantiation.
+ */
+template <size_t SIZE>
+result_t measure_size(const config_t& config) {
+  return (config.bulk == thread::pool::WORK_PARTITIONING_LIGHT
+    ? measure<SIZE, thread::pool::WORK_PARTITIONING_LIGHT>(config)
+    : measure<SIZE, thread::pool::WORK_PARTITIONING_HEAVY>(config));
+}
+
+/**
+ * \brief Writes the percentiles of a latency histogram.
+ */
+static void write_latency(json_writer_t& json, const char* name, const thread::pool::histogram_snapshot_t& histogram) {
+  json.begin_object(name)
+    .value("count", histogram.count())
+    .value("p50", histogram.percentile(50))
+    .value("p99", histogram.percentile(99))
+    .value("p999", histogram.percentile(99.9))
+    .value("max", histogram.max())
+    .end_object();
+}
+
+/**
+ * \brief Application entry point, which runs every combination of the
+ * number of producers and consumers, the size of the tasks, the number
+ * of tasks dequeued at once and the use of producer tokens, and writes
+ * the results as JSON on the standard output.
+ */
+int main(int argc, char* argv[]) {
+  if (argc > 1) {
+    tasks = std::strtoul(argv[1], nullptr, 10);
+  }
+  if (argc > 2) {
+    load = std::strtod(argv[2], nullptr);
+  }
+  size_t threads = std::thread::hardware_concurrency();
+  threads = threads > 2 ? threads : 2;
+  const size_t counts[] = { 1, threads };
+  const size_t sizes[] = { 16, 64 };
+  const size_t bulks[] = { thread::pool::WORK_PARTITIONING_LIGHT, thread::pool::WORK_PARTITIONING_HEAVY };
+
+  json_writer_t json(std::cout);
+  json.begin_object()
+    .value("benchmark", "throughput_latency")
+    .value("hardware_concurrency", static_cast<uint64_t>(std::thread::hardware_concurrency()))
+    .value("tasks", static_cast<uint64_t>(tasks))
+    .value("load", load)
+    .value("inline_size", static_cast<uint64_t>(thread::pool::task_t::INLINE_SIZE));
+  json.begin_array("results");
+  for (size_t producers : counts) {
+    for (size_t consumers : counts) {
+      for (size_t size : sizes) {
+        for (size_t bulk : bulks) {
+          for (int token = 0; token < 2; ++token) {
+            config_t config{ producers, consumers, size, bulk, token != 0 };
+            result_t result = size == 16 ? measure_size<16>(config) : measure_size<64>(config);
+            json.begin_object()
+              .value("producers", static_cast<uint64_t>(producers))
+              .value("consumers", static_cast<uint64_t>(consumers))
+              .value("task_size", static_cast<uint64_t>(size))
+              .value("bulk_max_items", static_cast<uint64_t>(bulk))
+              .value("token", config.token)
+              .value("throughput", result.throughput)
+              .value("enqueue_ns", result.enqueue_ns);
+            write_latency(json, "latency_ns", result.corrected);
+            write_latency(json, "uncorrected_latency_ns", result.raw);
+            json.end_object();
+          }
+        }
+      }
+    }
+  }
+  json.end_array();
+  json.end_object();
+  json.finish();
+  return (0);
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <iomanip>
+#include "../../includes/thread_pool_typed.hpp"
+
+/**
+ * \brief The number of records to process.
+ */
+static const size_t records_count = 4 * 1000 * 1000;
+
+/**
+ * \brief The number of records scheduled at once.
+ */
+static const size_t chunk = 1000;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of processed records.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief A record to process.
+ */
+struct record_t {
+  size_t value;
+  size_t result;
+};
+
+/**
+ * \brief Processes a single record.
+ */
+static inline void process(record_t* record) {
+  record->result = record->value * 3 + 1;
+  count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * \brief The handler of the typed pool.
+ */
+struct process_t {
+  void operator()(record_t* record) const {
+    process(record);
+  }
+};
+
+/**
+ * \brief Waits for every record to have been processed, and
+ * reports the throughput since `start`.
+ */
+static void report(const char* name, std::chrono::high_resolution_clock::time_point start) {
+  while (count < records_count) {
+    std::this_thread::yield();
+  }
+  std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - start;
+  std::cout << std::left << std::setw(24) << name
+            << std::fixed << std::setprecision(2)
+            << count / diff.count() / 1e6 << std::endl;
+}
+
+/**
+ * \brief Schedules one `std::function` per record on the type-erased pool.
+ */
+static void run_functions(std::vector<record_t>& records) {
+  thread::pool::pool_t pool(std::thread::hardware_concurrency());
+  std::vector<thread::pool::consumer_t> functions(chunk);
+
+  count = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < records_count; i += chunk) {
+    for (size_t j = 0; j < chunk; ++j) {
+      record_t* record = &records[i + j];
+      functions[j] = [record] () { process(record); };
+    }
+    pool.schedule_bulk(functions.data(), chunk);
+  }
+  report("std::function", start);
+}
+
+/**
+ * \brief Schedules one lambda per record on the type-erased pool,
+ * which is stored inline within a task.
+ */
+static void run_lambdas(std::vector<record_t>& records) {
+  thread::pool::pool_t pool(std::thread::hardware_concurrency());
+
+  count = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < records_count; i += chunk) {
+    record_t* record = &records[i];
+    pool.schedule_bulk([&record] () {
+      record_t* current = record++;
+      return ([current] () { process(current); });
+    }, chunk);
+  }
+  report("inline lambda", start);
+}
+
+/**
+ * \brief Schedules the records themselves on a typed pool.
+ */
+static void run_typed(std::vector<record_t>& records) {
+  thread::pool::typed_pool_t<record_t*, process_t> pool(std::thread::hardware_concurrency());
+  std::vector<record_t*> pointers(records_count);
+  for (size_t i = 0; i < records_count; ++i) {
+    pointers[i] = &records[i];
+  }
+
+  count = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < records_count; i += chunk) {
+    pool.schedule_bulk(&pointers[i], chunk);
+  }
+  report("typed_pool_t", start);
+}
+
+/**
+ * \brief Application entry point.
+ */
+int main() {
+  std::vector<record_t> records(records_count);
+  for (size_t i = 0; i < records_count; ++i) {
+    records[i].value = i;
+  }
+  std::cout << std::left << std::setw(24) << "pool" << "Mrecords/s" << std::endl;
+  run_functions(records);
+  run_lambdas(records);
+  run_typed(records);
+  return (0);
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <iomanip>
+#include <sys/resource.h>
+#include "../../includes/thread_pool.hpp"
+#include "../../includes/blocking_concurrent_queue.hpp"
+
+/**
+ * \brief Concurrency level is calculated based on the CPU cores.
+ */
+static const size_t concurrency = std::thread::hardware_concurrency() + 1;
+
+/**
+ * \brief The number of bursts to schedule.
+ */
+static const size_t bursts = 2000;
+
+/**
+ * \brief The pause between two bursts, long enough
+ * for the workers to go back to sleep.
+ */
+static const std::chrono::microseconds idle_pause(500);
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed tasks.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief A reference pool reproducing the previous worker loop, where
+ * every worker blocks on the semaphore of a `BlockingConcurrentQueue`.
+ */
+struct semaphore_pool_t {
+
+  semaphore_pool_t(size_t concurrency)
+    : tasks_(concurrency), done_(false) {
+    while (concurrency--) {
+      threads_.push_back(std::thread(&semaphore_pool_t::worker, this));
+    }
+  }
+
+  ~semaphore_pool_t() {
+    done_.store(true);
+    for (std::thread& t : threads_) {
+      t.join();
+    }
+  }
+
+  bool schedule_bulk(const thread::pool::consumer_t array[], size_t size) {
+    return (tasks_.enqueue_bulk(array, size));
+  }
+
+private:
+
+  std::vector<std::thread> threads_;
+  moodycamel::BlockingConcurrentQueue<thread::pool::consumer_t> tasks_;
+  std::atomic<bool> done_;
+
+  void worker() {
+    moodycamel::ConsumerToken token(tasks_);
+    while (!done_) {
+      thread::pool::consumer_t runnable[thread::pool::WORK_PARTITIONING_HEAVY] = {};
+      auto available = tasks_.wait_dequeue_bulk_timed(token, runnable, thread::pool::WORK_PARTITIONING_HEAVY, std::chrono::milliseconds(100));
+      for (size_t i = 0; i < available; ++i) {
+        runnable[i]();
+      }
+    }
+  }
+};
+
+/**
+ * \return the number of voluntary and involuntary
+ * context switches of the process so far.
+ */
+static long context_switches() {
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_nvcsw + usage.ru_nivcsw);
+}
+
+/**
+ * \brief Schedules `bursts` batches of `burst_size` empty tasks on the
+ * given pool, waiting for each burst to complete and letting the
+ * workers park in between, and reports the context switches per task.
+ */
+template <typename Pool>
+void run(const char* name, size_t burst_size) {
+  Pool pool(concurrency);
+  std::vector<thread::pool::consumer_t> burst(burst_size, [] () { ++count; });
+
+  count = 0;
+  auto switches = context_switches();
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < bursts; ++i) {
+    pool.schedule_bulk(burst.data(), burst.size());
+    while (count < (i + 1) * burst_size) {
+      std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(idle_pause);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  switches = context_switches() - switches;
+
+  std::chrono::duration<double, std::milli> diff = end - start;
+  std::cout << std::left << std::setw(12) << name
+            << std::setw(8) << burst_size
+            << std::setw(24) << static_cast<double>(switches) / (bursts * burst_size)
+            << diff.count() << " ms" << std::endl;
+}
+
+/**
+ * \brief Application entry point.
+ */
+int main() {
+  std::cout << std::left << std::setw(12) << "pool" << std::setw(8) << "burst"
+            << std::setw(24) << "switches per task" << "elapsed" << std::endl;
+  for (size_t burst_size : { 1, 4, 16 }) {
+    run<semaphore_pool_t>("semaphore", burst_size);
+    run<thread::pool::pool_t>("targeted", burst_size);
+  }
+  return (0);
+}
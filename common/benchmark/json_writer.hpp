@@ -0,0 +1,162 @@
+#ifndef COMMON_BENCHMARK_JSON_WRITER_H_
+#define COMMON_BENCHMARK_JSON_WRITER_H_
+
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * \struct json_writer_t
+ * \brief A minimal streaming JSON writer used by the benchmarks to emit
+ * their results in a machine-readable form. Objects and arrays are opened
+ * and closed explicitly, and commas are inserted as needed.
+ */
+struct json_writer_t {
+
+  /**
+   * \constructor
+   * \brief Writes to the given stream.
+   */
+  explicit json_writer_t(std::ostream& stream)
+    : stream_(stream), first_(true) {}
+
+  /**
+   * \brief Opens an object, as a value or as the member `name`.
+   */
+  json_writer_t& begin_object(const char* name = nullptr) {
+    return (open(name, '{'));
+  }
+
+  /**
+   * \brief Closes the current object.
+   */
+  json_writer_t& end_object() {
+    return (close('}'));
+  }
+
+  /**
+   * \brief Opens an array, as a value or as the member `name`.
+   */
+  json_writer_t& begin_array(const char* name = nullptr) {
+    return (open(name, '['));
+  }
+
+  /**
+   * \brief Closes the current array.
+   */
+  json_writer_t& end_array() {
+    return (close(']'));
+  }
+
+  /**
+   * \brief Writes the member `name` of the current object.
+   */
+  json_writer_t& value(const char* name, const std::string& value) {
+    member(name);
+    write_string(value);
+    return (*this);
+  }
+
+  json_writer_t& value(const char* name, const char* value) {
+    return (this->value(name, std::string(value)));
+  }
+
+  json_writer_t& value(const char* name, bool value) {
+    member(name);
+    stream_ << (value ? "true" : "false");
+    return (*this);
+  }
+
+  json_writer_t& value(const char* name, uint64_t value) {
+    member(name);
+    stream_ << value;
+    return (*this);
+  }
+
+  json_writer_t& value(const char* name, int value) {
+    member(name);
+    stream_ << value;
+    return (*this);
+  }
+
+  json_writer_t& value(const char* name, double value) {
+    member(name);
+    if (std::isfinite(value)) {
+      stream_ << value;
+    } else {
+      stream_ << "null";
+    }
+    return (*this);
+  }
+
+  /**
+   * \brief Writes the member `name` as null.
+   */
+  json_writer_t& null(const char* name) {
+    member(name);
+    stream_ << "null";
+    return (*this);
+  }
+
+  /**
+   * \brief Ends the document with a new line.
+   */
+  void finish() {
+    stream_ << std::endl;
+  }
+
+private:
+
+  json_writer_t& open(const char* name, char bracket) {
+    member(name);
+    stream_ << bracket;
+    first_ = true;
+    return (*this);
+  }
+
+  json_writer_t& close(char bracket) {
+    stream_ << bracket;
+    first_ = false;
+    return (*this);
+  }
+
+  /**
+   * \brief Writes the separator preceding a value, and its name if any.
+   */
+  void member(const char* name) {
+    if (!first_) {
+      stream_ << ',';
+    }
+    first_ = false;
+    if (name != nullptr) {
+      write_string(name);
+      stream_ << ':';
+    }
+  }
+
+  void write_string(const std::string& value) {
+    stream_ << '"';
+    for (char c : value) {
+      if (c == '"' || c == '\\') {
+        stream_ << '\\' << c;
+      } else if (static_cast<unsigned char>(c) >= 0x20) {
+        stream_ << c;
+      }
+    }
+    stream_ << '"';
+  }
+
+  /**
+   * \brief The stream the document is written to.
+   */
+  std::ostream& stream_;
+
+  /**
+   * \brief Whether the next value is the first of its object or array.
+   */
+  bool first_;
+};
+
+#endif // COMMON_BENCHMARK_JSON_WRITER_H_
@@ -0,0 +1,189 @@
+#ifndef COMMON_BENCHMARK_PERF_COUNTERS_H_
+#define COMMON_BENCHMARK_PERF_COUNTERS_H_
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * \struct perf_counters_t
+ * \brief Counts hardware and scheduler events with `perf_event_open`
+ * over a region of a benchmark, across the calling thread and every
+ * thread it creates once the counters have been opened, such as the
+ * workers of a pool. The counts of a thread are only folded into the
+ * counters once the thread has exited, so that pools must be created
+ * and destroyed within the measured region.
+ *
+ * Each counter is opened on its own, so that the counters the kernel,
+ * the hardware or the permissions do not allow, which is common within
+ * virtual machines, are reported as unavailable while the others work.
+ */
+struct perf_counters_t {
+
+  /**
+   * \brief The events which are counted.
+   */
+  enum event_t {
+    CYCLES,
+    INSTRUCTIONS,
+    CACHE_MISSES,
+    CONTEXT_SWITCHES,
+    CPU_MIGRATIONS,
+    EVENTS
+  };
+
+  /**
+   * \return the name of the given event.
+   */
+  static const char* name(size_t event) {
+    static const char* names[EVENTS] = {
+      "cycles", "instructions", "cache_misses", "context_switches", "cpu_migrations"
+    };
+    return (names[event]);
+  }
+
+  /**
+   * \constructor
+   * \brief Opens the counters, which are stopped.
+   */
+  perf_counters_t() {
+    for (size_t i = 0; i < EVENTS; ++i) {
+      fds_[i] = open(static_cast<event_t>(i));
+      values_[i] = 0;
+    }
+  }
+
+  /**
+   * \destructor
+   * \brief Closes the counters.
+   */
+  ~perf_counters_t() {
+#if defined(__linux__)
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+#endif
+  }
+
+  /**
+   * \brief Counters are non-copyable.
+   */
+  perf_counters_t(const perf_counters_t&) = delete;
+
+  /**
+   * \brief Counters are non-copyable.
+   */
+  perf_counters_t& operator=(const perf_counters_t&) = delete;
+
+  /**
+   * \brief Resets and starts the counters.
+   */
+  void start() {
+#if defined(__linux__)
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+  }
+
+  /**
+   * \brief Stops the counters and reads their values.
+   */
+  void stop() {
+#if defined(__linux__)
+    for (size_t i = 0; i < EVENTS; ++i) {
+      values_[i] = 0;
+      if (fds_[i] >= 0) {
+        ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t value = 0;
+        if (read(fds_[i], &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value))) {
+          values_[i] = value;
+        }
+      }
+    }
+#endif
+  }
+
+  /**
+   * \return whether the given event could be counted.
+   */
+  bool available(size_t event) const {
+    return (fds_[event] >= 0);
+  }
+
+  /**
+   * \return the count of the given event, as of the last `stop()`.
+   */
+  uint64_t value(size_t event) const {
+    return (values_[event]);
+  }
+
+private:
+
+  /**
+   * \return a file descriptor counting the given event,
+   * or a negative value if it cannot be counted.
+   */
+  static int open(event_t event) {
+#if defined(__linux__)
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.inherit = 1;
+    switch (event) {
+      case CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+      case INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+      case CACHE_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+      case CONTEXT_SWITCHES:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+        break;
+      default:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_CPU_MIGRATIONS;
+        break;
+    }
+    // Hardware events are restricted to user space, which
+    // unprivileged processes are usually allowed to count.
+    attr.exclude_kernel = attr.type == PERF_TYPE_HARDWARE;
+    attr.exclude_hv = 1;
+    return (static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0)));
+#else
+    (void) event;
+    return (-1);
+#endif
+  }
+
+  /**
+   * \brief The file descriptor of each counter, negative if unavailable.
+   */
+  int fds_[EVENTS];
+
+  /**
+   * \brief The value of each counter, as of the last `stop()`.
+   */
+  uint64_t values_[EVENTS];
+};
+
+#endif // COMMON_BENCHMARK_PERF_COUNTERS_H_
@@ -0,0 +1,269 @@
+#ifndef COMMON_TESTING_ALLOCATION_COUNTER_H_
+#define COMMON_TESTING_ALLOCATION_COUNTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+/**
+ * Allocation counting
+ * -------------------
+ *
+ * This header replaces the global `operator new` and `operator delete`
+ * and, with glibc, interposes `malloc` and its siblings, so that every
+ * heap allocation made by the process is counted, both for the calling
+ * thread and for the whole process. Since it defines these functions, it
+ * must be included by exactly one translation unit of a test.
+ *
+ * Counters are plain thread-local integers, which need no initialization
+ * and can thus be used from within the allocator itself.
+ */
+
+#if defined(__GLIBC__)
+extern "C" {
+  void* __libc_malloc(size_t);
+  void* __libc_calloc(size_t, size_t);
+  void* __libc_realloc(void*, size_t);
+  void* __libc_memalign(size_t, size_t);
+  void __libc_free(void*);
+}
+#endif
+
+namespace testing {
+
+  /**
+   * \brief The number of allocations made by the calling thread.
+   */
+  static thread_local size_t local_allocations = 0;
+
+  /**
+   * \brief The number of allocations made by the process.
+   */
+  static std::atomic<size_t> process_allocations(0);
+
+  /**
+   * \brief Counts an allocation made by the calling thread.
+   */
+  inline void count_allocation() noexcept {
+    ++local_allocations;
+    process_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * \return the number of allocations made so far by the calling thread.
+   */
+  inline size_t thread_allocations() noexcept {
+    return (local_allocations);
+  }
+
+  /**
+   * \return the number of allocations made so far by the process.
+   */
+  inline size_t total_allocations() noexcept {
+    return (process_allocations.load(std::memory_order_relaxed));
+  }
+
+  /**
+   * \brief Allocates `size` bytes aligned on `alignment` bytes,
+   * without counting the allocation.
+   */
+  inline void* raw_allocate(size_t size, size_t alignment) noexcept {
+#if defined(__GLIBC__)
+    return (alignment > alignof(std::max_align_t) ? __libc_memalign(alignment, size) : __libc_malloc(size));
+#else
+    void* ptr = nullptr;
+    return (posix_memalign(&ptr, alignment > sizeof(void*) ? alignment : sizeof(void*), size) == 0 ? ptr : nullptr);
+#endif
+  }
+
+  /**
+   * \brief Releases memory returned by `raw_allocate`.
+   */
+  inline void raw_deallocate(void* ptr) noexcept {
+#if defined(__GLIBC__)
+    __libc_free(ptr);
+#else
+    free(ptr);
+#endif
+  }
+
+  /**
+   * \class allocation_scope_t
+   * \brief Counts the allocations made by the calling thread
+   * between its construction and a call to `.count()`.
+   */
+  class allocation_scope_t {
+  public:
+
+    allocation_scope_t() noexcept
+      : first_(thread_allocations()) {}
+
+    /**
+     * \return the number of allocations made by
+     * the calling thread within the scope.
+     */
+    size_t count() const noexcept {
+      return (thread_allocations() - first_);
+    }
+
+  private:
+    const size_t first_;
+  };
+
+  /**
+   * \struct allocation_hooks_t
+   * \brief A hook policy for `parameterized_pool_t` which adds the
+   * allocations made by the workers, including those of the worker loop
+   * itself, to a counter, each time a worker ends a task or goes idle.
+   */
+  struct allocation_hooks_t {
+
+    /**
+     * \brief The allocations made by the workers, shared
+     * by the copies of the policy.
+     */
+    std::shared_ptr<std::atomic<size_t>> allocations = std::make_shared<std::atomic<size_t>>(0);
+
+    void on_worker_start(size_t) noexcept {
+      published() = thread_allocations();
+    }
+
+    void on_worker_stop(size_t) noexcept {}
+
+    template <typename Task>
+    void before_task(size_t, const Task&) noexcept {}
+
+    template <typename Task>
+    void after_task(size_t, const Task&) noexcept {
+      publish();
+    }
+
+    void on_idle(size_t) noexcept {
+      publish();
+    }
+
+    /**
+     * \return the allocations made by the workers so far.
+     */
+    size_t count() const noexcept {
+      return (allocations->load(std::memory_order_acquire));
+    }
+
+  private:
+
+    /**
+     * \return the allocations of the calling worker already published.
+     */
+    static size_t& published() noexcept {
+      static thread_local size_t count = 0;
+      return (count);
+    }
+
+    void publish() noexcept {
+      size_t count = thread_allocations();
+      if (count != published()) {
+        allocations->fetch_add(count - published(), std::memory_order_release);
+        published() = count;
+      }
+    }
+  };
+};
+
+void* operator new(size_t size) {
+  void* ptr = testing::raw_allocate(size > 0 ? size : 1, alignof(std::max_align_t));
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  testing::count_allocation();
+  return (ptr);
+}
+
+void* operator new[](size_t size) {
+  return (operator new(size));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  void* ptr = testing::raw_allocate(size > 0 ? size : 1, alignof(std::max_align_t));
+  if (ptr != nullptr) {
+    testing::count_allocation();
+  }
+  return (ptr);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return (operator new(size, tag));
+}
+
+void operator delete(void* ptr) noexcept {
+  testing::raw_deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  testing::raw_deallocate(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  testing::raw_deallocate(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  testing::raw_deallocate(ptr);
+}
+
+#if defined(__GLIBC__)
+/**
+ * With glibc, the allocation functions of the C library are interposed
+ * as well, so that allocations bypassing `operator new` are counted.
+ */
+extern "C" {
+
+  void* malloc(size_t size) {
+    void* ptr = __libc_malloc(size);
+    if (ptr != nullptr) {
+      testing::count_allocation();
+    }
+    return (ptr);
+  }
+
+  void* calloc(size_t count, size_t size) {
+    void* ptr = __libc_calloc(count, size);
+    if (ptr != nullptr) {
+      testing::count_allocation();
+    }
+    return (ptr);
+  }
+
+  void* realloc(void* ptr, size_t size) {
+    void* result = __libc_realloc(ptr, size);
+    if (result != nullptr) {
+      testing::count_allocation();
+    }
+    return (result);
+  }
+
+  int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    *ptr = __libc_memalign(alignment, size);
+    if (*ptr == nullptr) {
+      return (ENOMEM);
+    }
+    testing::count_allocation();
+    return (0);
+  }
+
+  void* aligned_alloc(size_t alignment, size_t size) {
+    void* ptr = __libc_memalign(alignment, size);
+    if (ptr != nullptr) {
+      testing::count_allocation();
+    }
+    return (ptr);
+  }
+
+  void free(void* ptr) {
+    __libc_free(ptr);
+  }
+};
+#endif
+
+#endif // COMMON_TESTING_ALLOCATION_COUNTER_H_
@@ -27,10 +27,10 @@ int main() {
  // Filling our array with `iterations` amount of functions,
  // bound to the number `42`.
  std::fill_n(callables, iterations, std::bind(static_void_function, 42));
- // Scheduling the execution in bulk.
- auto result = pool.schedule_bulk(callables, iterations);
- // Log whether the insertion was successful.
- std::cout << "The insertion has " << (result ? "succeeded" : "failed") << std::endl;
- assert(result == true);
+ // Scheduling the execution in bulk, as a single batch.
+ auto batch = pool.schedule_batch(callables, callables + iterations);
+ // Waiting for every callable of the batch to complete.
+ batch.wait();
+ std::cout << "The batch of " << iterations << " callables has completed" << std::endl;
  return (0);
 }
\ No newline at end of file
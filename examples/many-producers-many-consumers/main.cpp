@@ -53,9 +53,11 @@ int main() {
   std::fill_n(producers, workers_to_spawn, std::bind(producer, &pool_of_consumers));
 
   // Scheduling the producers.
-  pool_of_producers.schedule_bulk(producers, workers_to_spawn);
+  auto batch = pool_of_producers.schedule_batch(producers, producers + workers_to_spawn);
 
-  // Waiting for the producers to complete.
+  // Waiting for the producers to complete, before stopping them,
+  // since stopping the pool drops the producers which did not run.
+  batch.wait();
   pool_of_producers.stop().await();
   
   // Waiting for the consumers to complete.
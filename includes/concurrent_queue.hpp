@@ -1311,6 +1311,87 @@ public:
 	}
 	
 	
+	// Releases the memory kept around after a burst back to the allocator, and
+	// returns the number of bytes which have been released. Explicit producers
+	// first hand the empty blocks ahead of their tail block over to the free
+	// list, and implicit producers whose elements have all been dequeued shrink
+	// their block index back to its initial capacity. The dynamically allocated
+	// blocks sitting on the free list are then released, while the blocks which
+	// are part of the initial block pool are kept on the free list.
+	// Not thread-safe with respect to enqueue operations, dequeue operations may
+	// run concurrently.
+	size_t trim()
+	{
+		size_t released = 0;
+		for (auto ptr = producerListTail.load(std::memory_order_acquire); ptr != nullptr; ptr = ptr->next_prod()) {
+			if (ptr->isExplicit) {
+				static_cast<ExplicitProducer*>(ptr)->release_empty_blocks();
+			}
+			else {
+				released += static_cast<ImplicitProducer*>(ptr)->trim_block_index();
+			}
+		}
+		Block* kept = nullptr;
+		for (auto block = freeList.try_get(); block != nullptr; block = freeList.try_get()) {
+			if (block->dynamicallyAllocated) {
+				destroy(block);
+				released += sizeof(Block);
+			}
+			else {
+				block->freeListNext.store(kept, std::memory_order_relaxed);
+				kept = block;
+			}
+		}
+		while (kept != nullptr) {
+			auto next = kept->freeListNext.load(std::memory_order_relaxed);
+			add_block_to_free_list(kept);
+			kept = next;
+		}
+		return released;
+	}
+	
+	
+	// Adds `blockCount` dynamically allocated blocks to the free list, and
+	// creates `implicitProducers` inactive implicit producers whose block index
+	// holds at least `blocksPerProducer` blocks, after having made room for them
+	// in the implicit producer hash. Threads enqueuing without a token for the
+	// first time recycle these producers rather than allocating their own, so
+	// that no allocation is needed afterwards as long as the reserved blocks
+	// suffice, which makes try_enqueue succeed. Reserved blocks and block
+	// indexes are released by trim() like any other spare memory.
+	// Returns false if an allocation failed.
+	// Thread-safe with respect to tokenless enqueue operations, which may have
+	// to wait for the hash to be swapped, and to dequeue operations.
+	bool reserve(size_t blockCount, size_t implicitProducers, size_t blocksPerProducer)
+	{
+		for (size_t i = 0; i != blockCount; ++i) {
+			auto block = create<Block>();
+			if (block == nullptr) {
+				return false;
+			}
+			add_block_to_free_list(block);
+		}
+		
+		MOODYCAMEL_CONSTEXPR_IF (INITIAL_IMPLICIT_PRODUCER_HASH_SIZE == 0) {
+			return true;
+		}
+		else {
+			if (implicitProducers == 0) {
+				return true;
+			}
+			
+			// Holding the resize flag keeps tokenless producers from growing
+			// the hash at the same time, which would lose one of the two hashes
+			while (implicitProducerHashResizeInProgress.test_and_set(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+			bool reserved = reserve_implicit_producers(implicitProducers, blocksPerProducer);
+			implicitProducerHashResizeInProgress.clear(std::memory_order_release);
+			return reserved;
+		}
+	}
+	
+	
 	// Returns true if the underlying atomic variables used by
 	// the queue are lock-free (they should be on most platforms).
 	// Thread-safe.
@@ -1345,7 +1426,7 @@ private:
 	template<AllocationMode canAlloc, typename U>
 	inline bool inner_enqueue(producer_token_t const& token, U&& element)
 	{
-		return static_cast<ExplicitProducer*>(token.producer)->ConcurrentQueue::ExplicitProducer::template enqueue<canAlloc>(std::forward<U>(element));
+		return token.producer == nullptr ? false : static_cast<ExplicitProducer*>(token.producer)->ConcurrentQueue::ExplicitProducer::template enqueue<canAlloc>(std::forward<U>(element));
 	}
 	
 	template<AllocationMode canAlloc, typename U>
@@ -1358,7 +1439,7 @@ private:
 	template<AllocationMode canAlloc, typename It>
 	inline bool inner_enqueue_bulk(producer_token_t const& token, It itemFirst, size_t count)
 	{
-		return static_cast<ExplicitProducer*>(token.producer)->ConcurrentQueue::ExplicitProducer::template enqueue_bulk<canAlloc>(itemFirst, count);
+		return token.producer == nullptr ? false : static_cast<ExplicitProducer*>(token.producer)->ConcurrentQueue::ExplicitProducer::template enqueue_bulk<canAlloc>(itemFirst, count);
 	}
 	
 	template<AllocationMode canAlloc, typename It>
@@ -1830,6 +1911,26 @@ private:
 			}
 		}
 		
+		// Hands the empty blocks ahead of the tail block over to the free list,
+		// starting from the oldest one. These blocks have been completely
+		// dequeued, so that no consumer uses them any more, and they only hold
+		// the oldest slots of the block index, which are simply left unused.
+		// Not thread-safe with respect to enqueue operations.
+		void release_empty_blocks()
+		{
+			if (this->tailBlock == nullptr) {
+				return;
+			}
+			auto block = this->tailBlock->next;
+			while (block != this->tailBlock && block->ConcurrentQueue::Block::template is_empty<explicit_context>()) {
+				auto next = block->next;
+				this->parent->add_block_to_free_list(block);
+				--pr_blockIndexSlotsUsed;
+				block = next;
+			}
+			this->tailBlock->next = block;
+		}
+		
 		template<AllocationMode allocMode, typename U>
 		inline bool enqueue(U&& element)
 		{
@@ -2413,6 +2514,85 @@ private:
 			new_block_index();
 		}
 		
+		// Grows the block index until it can hold `blockCount` blocks
+		bool reserve_block_index(size_t blockCount)
+		{
+			while (blockIndex.load(std::memory_order_relaxed)->capacity < blockCount) {
+				if (!new_block_index()) {
+					return false;
+				}
+			}
+			return true;
+		}
+		
+		// Replaces a grown block index, along with the indexes it was grown
+		// from, by an index of the initial capacity holding the last entry,
+		// and returns the number of bytes which have been released. This is
+		// only done once every element has been dequeued, and no consumer
+		// still uses the index: the entries of completely dequeued blocks are
+		// cleared last, and the block holding the tail is partially filled
+		// and has as many dequeued elements as it received.
+		// Not thread-safe with respect to enqueue operations.
+		size_t trim_block_index()
+		{
+			auto localBlockIndex = blockIndex.load(std::memory_order_relaxed);
+			if (localBlockIndex == nullptr || (localBlockIndex->prev == nullptr && localBlockIndex->capacity <= IMPLICIT_INITIAL_INDEX_SIZE)) {
+				return 0;
+			}
+			auto tail = this->tailIndex.load(std::memory_order_relaxed);
+			if (this->headIndex.load(std::memory_order_acquire) != tail) {
+				return 0;
+			}
+			auto tailEntry = localBlockIndex->index[localBlockIndex->tail.load(std::memory_order_relaxed)];
+			auto tailBase = tailEntry->key.load(std::memory_order_relaxed);
+			for (size_t i = 0; i != localBlockIndex->capacity; ++i) {
+				auto entry = localBlockIndex->index[i];
+				auto block = entry->value.load(std::memory_order_acquire);
+				if (block != nullptr && (entry != tailEntry || static_cast<size_t>(tail - tailBase) >= BLOCK_SIZE ||
+					block->elementsCompletelyDequeued.load(std::memory_order_acquire) != static_cast<size_t>(tail - tailBase))) {
+					return 0;
+				}
+			}
+			
+			auto capacity = static_cast<size_t>(IMPLICIT_INITIAL_INDEX_SIZE);
+			auto raw = static_cast<char*>((Traits::malloc)(block_index_bytes(capacity, capacity)));
+			if (raw == nullptr) {
+				return 0;
+			}
+			auto header = new (raw) BlockIndexHeader;
+			auto entries = reinterpret_cast<BlockIndexEntry*>(details::align_for<BlockIndexEntry>(raw + sizeof(BlockIndexHeader)));
+			auto index = reinterpret_cast<BlockIndexEntry**>(details::align_for<BlockIndexEntry*>(reinterpret_cast<char*>(entries) + sizeof(BlockIndexEntry) * capacity));
+			for (size_t i = 0; i != capacity; ++i) {
+				new (entries + i) BlockIndexEntry;
+				entries[i].key.store(INVALID_BLOCK_BASE, std::memory_order_relaxed);
+				entries[i].value.store(nullptr, std::memory_order_relaxed);
+				index[i] = entries + i;
+			}
+			entries[capacity - 1].key.store(tailBase, std::memory_order_relaxed);
+			entries[capacity - 1].value.store(tailEntry->value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			header->prev = nullptr;
+			header->entries = entries;
+			header->index = index;
+			header->capacity = capacity;
+			header->tail.store(capacity - 1, std::memory_order_relaxed);
+			
+			blockIndex.store(header, std::memory_order_release);
+			nextBlockIndexCapacity = capacity << 1;
+			
+			size_t released = 0;
+			for (size_t i = 0; i != localBlockIndex->capacity; ++i) {
+				localBlockIndex->index[i]->~BlockIndexEntry();
+			}
+			do {
+				auto prev = localBlockIndex->prev;
+				released += block_index_bytes(prev == nullptr ? localBlockIndex->capacity : localBlockIndex->capacity - prev->capacity, localBlockIndex->capacity);
+				localBlockIndex->~BlockIndexHeader();
+				(Traits::free)(localBlockIndex);
+				localBlockIndex = prev;
+			} while (localBlockIndex != nullptr);
+			return released - block_index_bytes(capacity, capacity);
+		}
+		
 		~ImplicitProducer()
 		{
 			// Note that since we're in the destructor we can assume that all enqueue/dequeue operations
@@ -2789,6 +2969,9 @@ private:
 					auto index = firstIndex;
 					BlockIndexHeader* localBlockIndex;
 					auto indexIndex = get_block_index_index_for_index(index, localBlockIndex);
+					// The index may be released by trim() once the last block is empty,
+					// so its capacity is not read past that point.
+					auto indexMask = localBlockIndex->capacity - 1;
 					do {
 						auto blockStartIndex = index;
 						index_t endIndex = (index & ~static_cast<index_t>(BLOCK_SIZE - 1)) + static_cast<index_t>(BLOCK_SIZE);
@@ -2829,7 +3012,7 @@ private:
 										entry->value.store(nullptr, std::memory_order_relaxed);
 										this->parent->add_block_to_free_list(block);
 									}
-									indexIndex = (indexIndex + 1) & (localBlockIndex->capacity - 1);
+									indexIndex = (indexIndex + 1) & indexMask;
 									
 									blockStartIndex = index;
 									endIndex = (index & ~static_cast<index_t>(BLOCK_SIZE - 1)) + static_cast<index_t>(BLOCK_SIZE);
@@ -2850,7 +3033,7 @@ private:
 							}
 							this->parent->add_block_to_free_list(block);		// releases the above store
 						}
-						indexIndex = (indexIndex + 1) & (localBlockIndex->capacity - 1);
+						indexIndex = (indexIndex + 1) & indexMask;
 					} while (index != firstIndex + actualCount);
 					
 					return actualCount;
@@ -2946,15 +3129,21 @@ private:
 			return idx;
 		}
 		
+		// The size of a block index holding `entryCount` entries of its own,
+		// and `capacity` entries overall
+		static size_t block_index_bytes(size_t entryCount, size_t capacity)
+		{
+			return sizeof(BlockIndexHeader) +
+				std::alignment_of<BlockIndexEntry>::value - 1 + sizeof(BlockIndexEntry) * entryCount +
+				std::alignment_of<BlockIndexEntry*>::value - 1 + sizeof(BlockIndexEntry*) * capacity;
+		}
+		
 		bool new_block_index()
 		{
 			auto prev = blockIndex.load(std::memory_order_relaxed);
 			size_t prevCapacity = prev == nullptr ? 0 : prev->capacity;
 			auto entryCount = prev == nullptr ? nextBlockIndexCapacity : prevCapacity;
-			auto raw = static_cast<char*>((Traits::malloc)(
-				sizeof(BlockIndexHeader) +
-				std::alignment_of<BlockIndexEntry>::value - 1 + sizeof(BlockIndexEntry) * entryCount +
-				std::alignment_of<BlockIndexEntry*>::value - 1 + sizeof(BlockIndexEntry*) * nextBlockIndexCapacity));
+			auto raw = static_cast<char*>((Traits::malloc)(block_index_bytes(entryCount, nextBlockIndexCapacity)));
 			if (raw == nullptr) {
 				return false;
 			}
@@ -3370,6 +3559,52 @@ private:
 		}
 	}
 	
+	// Grows the implicit producer hash and adds the inactive producers of
+	// reserve(), with implicitProducerHashResizeInProgress held
+	bool reserve_implicit_producers(size_t implicitProducers, size_t blocksPerProducer)
+	{
+		// Growing the hash the same way get_or_add_implicit_producer does, so that
+		// inserting the recycled producers never triggers a resize
+		auto count = implicitProducerHashCount.load(std::memory_order_relaxed) + implicitProducers;
+		auto mainHash = implicitProducerHash.load(std::memory_order_acquire);
+		if (count + 1 >= (mainHash->capacity >> 1)) {
+			auto newCapacity = mainHash->capacity << 1;
+			while (count + 1 >= (newCapacity >> 1)) {
+				newCapacity <<= 1;
+			}
+			auto raw = static_cast<char*>((Traits::malloc)(sizeof(ImplicitProducerHash) + std::alignment_of<ImplicitProducerKVP>::value - 1 + sizeof(ImplicitProducerKVP) * newCapacity));
+			if (raw == nullptr) {
+				return false;
+			}
+			
+			auto newHash = new (raw) ImplicitProducerHash;
+			newHash->capacity = static_cast<size_t>(newCapacity);
+			newHash->entries = reinterpret_cast<ImplicitProducerKVP*>(details::align_for<ImplicitProducerKVP>(raw + sizeof(ImplicitProducerHash)));
+			for (size_t i = 0; i != newCapacity; ++i) {
+				new (newHash->entries + i) ImplicitProducerKVP;
+				newHash->entries[i].key.store(details::invalid_thread_id, std::memory_order_relaxed);
+			}
+			newHash->prev = mainHash;
+			implicitProducerHash.store(newHash, std::memory_order_release);
+		}
+		
+		for (size_t i = 0; i != implicitProducers; ++i) {
+			auto producer = create<ImplicitProducer>(this);
+			if (producer == nullptr) {
+				return false;
+			}
+			if (!producer->reserve_block_index(blocksPerProducer)) {
+				destroy(producer);
+				return false;
+			}
+			// Recycled producers are assumed to be counted in the hash already
+			producer->inactive.store(true, std::memory_order_relaxed);
+			implicitProducerHashCount.fetch_add(1, std::memory_order_relaxed);
+			add_producer(producer);
+		}
+		return true;
+	}
+	
 	// Only fails (returns nullptr) if memory allocation fails
 	ImplicitProducer* get_or_add_implicit_producer()
 	{
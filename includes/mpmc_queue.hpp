@@ -0,0 +1,411 @@
+#ifndef MPMC_QUEUE_H_
+#define MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "thread_pool_memory.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \class mpmc_queue_t
+     * \brief A bounded lock-free ring buffer supporting multiple producers
+     * and multiple consumers, based on Dmitry Vyukov's algorithm. Every slot
+     * carries a sequence number telling whether it is free or holds an
+     * element for the current lap of the ring, which lets producers and
+     * consumers claim slots with a single compare-and-swap on the tail or
+     * the head of the ring.
+     *
+     * The storage is allocated once upon construction and the capacity is
+     * rounded up to a power of two, so that enqueue and dequeue operations
+     * never allocate memory and have a predictable latency.
+     *
+     * Bulk operations check that each slot of a range is ready before
+     * claiming the whole range with a single compare-and-swap, so that they
+     * never wait for another thread. A bulk enqueue fails when a slot of its
+     * range still holds an element or is still being read by a consumer of
+     * the previous lap, and a bulk dequeue only takes the leading elements
+     * which have been published, stopping at a slot still being written.
+     */
+    template <typename T>
+    class mpmc_queue_t {
+
+      /**
+       * \brief Size of a cache line, used to keep the head and the
+       * tail of the ring on different lines.
+       */
+      static const size_t CACHE_LINE_SIZE = 64;
+
+      /**
+       * \brief Bit set on the sequence number of a slot which has been
+       * claimed by a producer whose element could not be constructed.
+       * Consumers release such slots without dequeuing anything.
+       */
+      static const size_t HOLE = ~(~size_t(0) >> 1);
+
+      /**
+       * \struct cell_t
+       * \brief A slot of the ring.
+       */
+      struct cell_t {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+
+        T* item() {
+          return (reinterpret_cast<T*>(&storage));
+        }
+      };
+
+    public:
+
+      /**
+       * \struct token_t
+       * \brief The queue does not make use of tokens, this type only
+       * allows token based APIs to be used with the queue.
+       */
+      struct token_t {
+        explicit token_t(mpmc_queue_t&) {}
+      };
+
+      /**
+       * \brief Token types required by the queue concept.
+       */
+      using producer_token_t = token_t;
+      using consumer_token_t = token_t;
+
+      /**
+       * \brief The capacity used when none is provided.
+       */
+      static const size_t DEFAULT_CAPACITY = 1024;
+
+      /**
+       * \constructor
+       * \brief Creates a queue able to hold at least `capacity` elements.
+       */
+      explicit mpmc_queue_t(size_t capacity = DEFAULT_CAPACITY)
+        : mask_(round_up(capacity > 0 ? capacity : size_t(DEFAULT_CAPACITY)) - 1),
+          cells_(static_cast<cell_t*>(tagged_allocate(sizeof(cell_t) * (mask_ + 1)))),
+          tail_(0),
+          head_(0) {
+        for (size_t i = 0; i <= mask_; ++i) {
+          new (&cells_[i].sequence) std::atomic<size_t>(i);
+        }
+      }
+
+      /**
+       * \destructor
+       * \brief Destroys the elements which are still in the queue.
+       */
+      ~mpmc_queue_t() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        for (; head != tail; ++head) {
+          cell_t& cell = cells_[head & mask_];
+          if (cell.sequence.load(std::memory_order_relaxed) == head + 1) {
+            cell.item()->~T();
+          }
+        }
+      }
+
+      /**
+       * \brief A queue is non-copyable.
+       */
+      mpmc_queue_t(const mpmc_queue_t&) = delete;
+
+      /**
+       * \brief A queue is non-copyable.
+       */
+      mpmc_queue_t& operator=(const mpmc_queue_t&) = delete;
+
+      /**
+       * \brief Enqueues a single element.
+       * \return false if the queue is full.
+       */
+      template <typename U>
+      bool enqueue(U&& item) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        cell_t* cell;
+        for (;;) {
+          cell = &cells_[pos & mask_];
+          size_t sequence = cell->sequence.load(std::memory_order_acquire) & ~HOLE;
+          if (sequence == pos) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+              break;
+            }
+          } else if (sequence < pos) {
+            // The slot still holds an element from the previous lap.
+            return (false);
+          } else {
+            pos = tail_.load(std::memory_order_relaxed);
+          }
+        }
+        publish(*cell, pos, std::forward<U>(item));
+        return (true);
+      }
+
+      /**
+       * \brief Enqueues a single element.
+       * \return false if the queue is full.
+       */
+      template <typename U>
+      bool enqueue(const producer_token_t&, U&& item) {
+        return (enqueue(std::forward<U>(item)));
+      }
+
+      /**
+       * \brief Enqueues a single element, which never allocates
+       * memory since the storage is allocated upfront.
+       * \return false if the queue is full.
+       */
+      template <typename U>
+      bool try_enqueue(U&& item) {
+        return (enqueue(std::forward<U>(item)));
+      }
+
+      /**
+       * \brief Enqueues a single element, which never allocates
+       * memory since the storage is allocated upfront.
+       * \return false if the queue is full.
+       */
+      template <typename U>
+      bool try_enqueue(const producer_token_t&, U&& item) {
+        return (enqueue(std::forward<U>(item)));
+      }
+
+      /**
+       * \brief Enqueues `count` elements, or none of them if there is
+       * not enough room left in the queue. If the construction of an
+       * element throws, the elements preceding it remain enqueued.
+       */
+      template <typename It>
+      bool enqueue_bulk(It first, size_t count) {
+        if (count == 0) {
+          return (true);
+        }
+        if (count > mask_ + 1) {
+          return (false);
+        }
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+          // The cells are checked before being claimed, so that claiming
+          // them never has to wait for consumers of the previous lap. A
+          // free cell can only be taken by a producer moving the tail past
+          // `pos`, in which case the claim below fails.
+          size_t i = 0;
+          size_t sequence = pos;
+          for (; i < count; ++i) {
+            sequence = cells_[(pos + i) & mask_].sequence.load(std::memory_order_acquire) & ~HOLE;
+            if (sequence != pos + i) {
+              break;
+            }
+          }
+          if (i == count) {
+            if (tail_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+              break;
+            }
+          } else if (sequence < pos + i) {
+            // The cell still holds an element, or is being read.
+            return (false);
+          } else {
+            pos = tail_.load(std::memory_order_relaxed);
+          }
+        }
+        size_t i = 0;
+        try {
+          for (; i < count; ++i, ++first) {
+            publish(cells_[(pos + i) & mask_], pos + i, *first);
+          }
+        } catch (...) {
+          // The remaining claimed cells must still be handed over
+          // to consumers, they are published as holes.
+          while (++i < count) {
+            cells_[(pos + i) & mask_].sequence.store((pos + i + 1) | HOLE, std::memory_order_release);
+          }
+          throw;
+        }
+        return (true);
+      }
+
+      /**
+       * \brief Enqueues `count` elements, or none of them if there is
+       * not enough room left in the queue.
+       */
+      template <typename It>
+      bool enqueue_bulk(const producer_token_t&, It first, size_t count) {
+        return (enqueue_bulk(first, count));
+      }
+
+      /**
+       * \brief Dequeues a single element.
+       * \return false if the queue is empty.
+       */
+      template <typename U>
+      bool try_dequeue(U& item) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+          cell_t* cell = &cells_[pos & mask_];
+          size_t sequence = cell->sequence.load(std::memory_order_acquire);
+          if ((sequence & ~HOLE) == pos + 1) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+              U* out = &item;
+              if (consume(*cell, pos, out)) {
+                return (true);
+              }
+              pos = head_.load(std::memory_order_relaxed);
+            }
+          } else if ((sequence & ~HOLE) < pos + 1) {
+            return (false);
+          } else {
+            pos = head_.load(std::memory_order_relaxed);
+          }
+        }
+      }
+
+      /**
+       * \brief Dequeues up to `max` elements.
+       * \return the number of dequeued elements.
+       */
+      template <typename It>
+      size_t try_dequeue_bulk(consumer_token_t&, It out, size_t max) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        size_t count;
+        for (;;) {
+          // Only the cells whose element has been published are claimed, so
+          // that claiming them never has to wait for producers. A published
+          // cell can only be taken by a consumer moving the head past `pos`,
+          // in which case the claim below fails.
+          count = 0;
+          size_t sequence = pos + 1;
+          for (; count < max; ++count) {
+            sequence = cells_[(pos + count) & mask_].sequence.load(std::memory_order_acquire) & ~HOLE;
+            if (sequence != pos + count + 1) {
+              break;
+            }
+          }
+          if (count > 0) {
+            if (head_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+              break;
+            }
+          } else if (max == 0 || sequence < pos + 1) {
+            // The queue is empty, or its first element is being written.
+            return (0);
+          } else {
+            pos = head_.load(std::memory_order_relaxed);
+          }
+        }
+        size_t dequeued = 0;
+        for (size_t i = 0; i < count; ++i) {
+          if (consume(cells_[(pos + i) & mask_], pos + i, out)) {
+            ++dequeued;
+          }
+        }
+        return (dequeued);
+      }
+
+      /**
+       * \brief The storage is allocated upfront, this only tells
+       * whether the queue is able to hold `items` elements.
+       */
+      bool reserve(size_t items, size_t) const {
+        return (items <= mask_ + 1);
+      }
+
+      /**
+       * \return the approximate number of elements in the queue.
+       */
+      size_t size_approx() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_relaxed);
+        return (tail > head ? tail - head : 0);
+      }
+
+      /**
+       * \return the number of elements the queue can hold.
+       */
+      size_t capacity() const {
+        return (mask_ + 1);
+      }
+
+    private:
+
+      /**
+       * \return the smallest power of two above or equal to `value`.
+       */
+      static size_t round_up(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+          result <<= 1;
+        }
+        return (result);
+      }
+
+      /**
+       * \brief Constructs an element in a claimed cell and hands it over to
+       * consumers. If the construction throws, the cell is published as a
+       * hole so that the ring keeps going.
+       */
+      template <typename U>
+      static void publish(cell_t& cell, size_t pos, U&& item) {
+        try {
+          new (cell.item()) T(std::forward<U>(item));
+        } catch (...) {
+          cell.sequence.store((pos + 1) | HOLE, std::memory_order_release);
+          throw;
+        }
+        cell.sequence.store(pos + 1, std::memory_order_release);
+      }
+
+      /**
+       * \brief Moves the element of a claimed cell to `out`, advances it,
+       * and hands the cell over to the producers of the next lap.
+       * \return false if the cell was a hole.
+       */
+      template <typename It>
+      bool consume(cell_t& cell, size_t pos, It& out) {
+        bool hole = (cell.sequence.load(std::memory_order_relaxed) & HOLE) != 0;
+        if (!hole) {
+          *out = std::move(*cell.item());
+          ++out;
+          cell.item()->~T();
+        }
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return (!hole);
+      }
+
+      /**
+       * \brief Mask applied to the indexes to get a cell.
+       */
+      const size_t mask_;
+
+      /**
+       * \brief The ring storage, allocated from the current resource.
+       */
+      std::unique_ptr<cell_t[], tagged_deleter_t> cells_;
+
+      char tail_padding_[CACHE_LINE_SIZE];
+
+      /**
+       * \brief The next index to be claimed by a producer.
+       */
+      std::atomic<size_t> tail_;
+
+      char head_padding_[CACHE_LINE_SIZE];
+
+      /**
+       * \brief The next index to be claimed by a consumer.
+       */
+      std::atomic<size_t> head_;
+
+      char padding_[CACHE_LINE_SIZE];
+    };
+  };
+};
+
+#endif // MPMC_QUEUE_H_
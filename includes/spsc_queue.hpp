@@ -0,0 +1,276 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "thread_pool_memory.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \class spsc_queue_t
+     * \brief A bounded wait-free ring buffer supporting a single producer
+     * thread and a single consumer thread. The whole storage is allocated
+     * upon construction, and its capacity is rounded up to a power of two.
+     */
+    template <typename T>
+    class spsc_queue_t {
+
+      /**
+       * \brief Storage of a single element.
+       */
+      using slot_t = typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type;
+
+      /**
+       * \brief Size of a cache line, used to keep the indexes written
+       * by the producer and the consumer on different lines.
+       */
+      static const size_t CACHE_LINE_SIZE = 64;
+
+    public:
+
+      /**
+       * \struct token_t
+       * \brief The queue does not make use of tokens, this type only
+       * allows token based APIs to be used with the queue.
+       */
+      struct token_t {
+        explicit token_t(spsc_queue_t&) {}
+      };
+
+      /**
+       * \brief Token types required by the queue concept.
+       */
+      using producer_token_t = token_t;
+      using consumer_token_t = token_t;
+
+      /**
+       * \brief The queue supports a single consumer thread, and a
+       * single producer thread.
+       */
+      static const bool single_consumer = true;
+
+      /**
+       * \brief The capacity used when none is provided.
+       */
+      static const size_t DEFAULT_CAPACITY = 1024;
+
+      /**
+       * \constructor
+       * \brief Creates a queue able to hold at least `capacity` elements.
+       */
+      explicit spsc_queue_t(size_t capacity = DEFAULT_CAPACITY)
+        : mask_(round_up(capacity > 0 ? capacity : size_t(DEFAULT_CAPACITY)) - 1),
+          slots_(static_cast<slot_t*>(tagged_allocate(sizeof(slot_t) * (mask_ + 1)))),
+          head_(0), tail_cache_(0), tail_(0), head_cache_(0) {}
+
+      /**
+       * \destructor
+       * \brief Destroys the elements which are still in the queue.
+       */
+      ~spsc_queue_t() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        for (; head != tail; ++head) {
+          at(head)->~T();
+        }
+      }
+
+      /**
+       * \brief A queue is non-copyable.
+       */
+      spsc_queue_t(const spsc_queue_t&) = delete;
+
+      /**
+       * \brief A queue is non-copyable.
+       */
+      spsc_queue_t& operator=(const spsc_queue_t&) = delete;
+
+      /**
+       * \brief Enqueues a single element.
+       * \return false if the queue is full.
+       */
+      template <typename U>
+      bool enqueue(U&& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (!has_room(tail, 1)) {
+          return (false);
+        }
+        new (at(tail)) T(std::forward<U>(item));
+        tail_.store(tail + 1, std::memory_order_release);
+        return (true);
+      }
+
+      /**
+       * \brief Enqueues a single element.
+       * \return false if the queue is full.
+       */
+      template <typename U>
+      bool enqueue(const producer_token_t&, U&& item) {
+        return (enqueue(std::forward<U>(item)));
+      }
+
+      /**
+       * \brief Enqueues a single element, which never allocates
+       * memory since the storage is allocated upfront.
+       * \return false if the queue is full.
+       */
+      template <typename U>
+      bool try_enqueue(U&& item) {
+        return (enqueue(std::forward<U>(item)));
+      }
+
+      /**
+       * \brief Enqueues a single element, which never allocates
+       * memory since the storage is allocated upfront.
+       * \return false if the queue is full.
+       */
+      template <typename U>
+      bool try_enqueue(const producer_token_t&, U&& item) {
+        return (enqueue(std::forward<U>(item)));
+      }
+
+      /**
+       * \brief Enqueues `count` elements, or none of them if there is
+       * not enough room left in the queue.
+       */
+      template <typename It>
+      bool enqueue_bulk(It first, size_t count) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (!has_room(tail, count)) {
+          return (false);
+        }
+        size_t i = 0;
+        try {
+          for (; i < count; ++i, ++first) {
+            new (at(tail + i)) T(*first);
+          }
+        } catch (...) {
+          while (i--) {
+            at(tail + i)->~T();
+          }
+          throw;
+        }
+        tail_.store(tail + count, std::memory_order_release);
+        return (true);
+      }
+
+      /**
+       * \brief Enqueues `count` elements, or none of them if there is
+       * not enough room left in the queue.
+       */
+      template <typename It>
+      bool enqueue_bulk(const producer_token_t&, It first, size_t count) {
+        return (enqueue_bulk(first, count));
+      }
+
+      /**
+       * \brief Dequeues up to `max` elements.
+       * \return the number of dequeued elements.
+       */
+      template <typename It>
+      size_t try_dequeue_bulk(consumer_token_t&, It out, size_t max) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (tail_cache_ == head) {
+          tail_cache_ = tail_.load(std::memory_order_acquire);
+        }
+        size_t count = tail_cache_ - head < max ? tail_cache_ - head : max;
+        for (size_t i = 0; i < count; ++i, ++out) {
+          T* item = at(head + i);
+          *out = std::move(*item);
+          item->~T();
+        }
+        head_.store(head + count, std::memory_order_release);
+        return (count);
+      }
+
+      /**
+       * \brief The storage is allocated upfront, this only tells
+       * whether the queue is able to hold `items` elements.
+       */
+      bool reserve(size_t items, size_t) const {
+        return (items <= mask_ + 1);
+      }
+
+      /**
+       * \return the approximate number of elements in the queue.
+       */
+      size_t size_approx() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_relaxed);
+        return (tail > head ? tail - head : 0);
+      }
+
+    private:
+
+      /**
+       * \return the smallest power of two above or equal to `value`.
+       */
+      static size_t round_up(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+          result <<= 1;
+        }
+        return (result);
+      }
+
+      /**
+       * \return whether `count` elements can be enqueued at `tail`,
+       * only reading the consumer index when the cached one says no.
+       */
+      bool has_room(size_t tail, size_t count) {
+        if (tail - head_cache_ + count > mask_ + 1) {
+          head_cache_ = head_.load(std::memory_order_acquire);
+          return (tail - head_cache_ + count <= mask_ + 1);
+        }
+        return (true);
+      }
+
+      /**
+       * \return the element stored at the given index.
+       */
+      T* at(size_t index) {
+        return (reinterpret_cast<T*>(&slots_[index & mask_]));
+      }
+
+      /**
+       * \brief Mask applied to the indexes to get a slot.
+       */
+      const size_t mask_;
+
+      /**
+       * \brief The ring storage, allocated from the current resource.
+       */
+      std::unique_ptr<slot_t[], tagged_deleter_t> slots_;
+
+      char head_padding_[CACHE_LINE_SIZE];
+
+      /**
+       * \brief Consumer side, the next index to dequeue and the
+       * last value of `tail_` it has seen.
+       */
+      std::atomic<size_t> head_;
+      size_t tail_cache_;
+
+      char tail_padding_[CACHE_LINE_SIZE];
+
+      /**
+       * \brief Producer side, the next index to enqueue and the
+       * last value of `head_` it has seen.
+       */
+      std::atomic<size_t> tail_;
+      size_t head_cache_;
+
+      char padding_[CACHE_LINE_SIZE];
+    };
+  };
+};
+
+#endif // SPSC_QUEUE_H_
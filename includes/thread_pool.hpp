@@ -3,12 +3,18 @@
 
 #include <vector>
 #include <functional>
+#include <iterator>
 #include <thread>
 #include <future>
 #include <type_traits>
 #include <unordered_map>
+#include <memory>
 
-#include "blocking_concurrent_queue.hpp"
+#include "thread_pool_memory.hpp"
+#include "thread_pool_task.hpp"
+#include "thread_pool_invoke.hpp"
+#include "thread_pool_batch.hpp"
+#include "thread_pool_core.hpp"
 
 namespace thread {
 
@@ -49,11 +55,6 @@ namespace thread {
      */
     using consumer_t = std::function<void()>;
 
-    /**
-     * \brief Type referring to a time value expressed in milliseconds.
-     */
-    using milliseconds_t = std::chrono::milliseconds::rep;
-
     /**
      * \brief Alias type to a `moodycamel::ProducerToken`.
      */
@@ -64,84 +65,157 @@ namespace thread {
      */
     using consumer_token_t = moodycamel::ConsumerToken;
 
+    /**
+     * \struct run_task_t
+     * \brief The invoke step of a `parameterized_pool_t`, which runs
+     * the type-erased tasks through the metrics policy of the pool.
+     */
+    struct run_task_t {
+
+      template <typename Metrics>
+      static uint64_t run(Metrics& metrics, size_t worker, task_t& task, uint64_t start) {
+        return (metrics.run(worker, task, start));
+      }
+
+      static uint16_t label(const task_t& task) noexcept {
+        return (task.label());
+      }
+    };
+
     /**
      * \struct parameterized_pool_t
+     * \brief A thread pool running type-erased callables, whose workers
+     * are provided by a `pool_core_t` dequeuing `task_t` values.
      */
     template <
       size_t BULK_MAX_ITEMS = WORK_PARTITIONING_HEAVY,
-      milliseconds_t DEQUEUE_TIMEOUT = 1 * 1000
+      milliseconds_t DEQUEUE_TIMEOUT = 1 * 1000,
+      typename IdlePolicy = spin_yield_park_t<>,
+      template <typename> class Queue = moodycamel_queue_t,
+      typename Metrics = no_metrics_t,
+      typename Hooks = no_hooks_t
     >
-    struct parameterized_pool_t {
-      
+    struct parameterized_pool_t : public pool_core_t<task_t, run_task_t, BULK_MAX_ITEMS, DEQUEUE_TIMEOUT, IdlePolicy, Queue, Metrics, Hooks> {
+
       /**
-       * \constructor
-       * \brief Creates a new thread pool and allocates `concurrency`
-       * number of threads.
+       * \brief The core providing the workers of the pool.
        */
-      parameterized_pool_t(size_t concurrency)
-        : tasks_(concurrency),
-          done_(false) {
-        while (concurrency--) {
-          threads_.push_back(std::thread(&parameterized_pool_t<BULK_MAX_ITEMS, DEQUEUE_TIMEOUT>::worker, this));
-        }
-      }
+      using core_t = pool_core_t<task_t, run_task_t, BULK_MAX_ITEMS, DEQUEUE_TIMEOUT, IdlePolicy, Queue, Metrics, Hooks>;
 
       /**
-       * \destructor
-       * \brief Will stop the running threads and await for
-       * them to have completed. The destructor will catch
-       * potential exceptions arising from the fact that
-       * internal threads may have already been terminated.
+       * \brief The type of the queue used to dispatch work to the workers.
        */
-      ~parameterized_pool_t() noexcept {
-        try {
-          stop().await();
-        } catch (std::system_error&) {}
-      }
+      using queue_t = typename core_t::queue_t;
+
+      /**
+       * \brief The producer token type associated with the queue.
+       */
+      using producer_token_t = typename core_t::producer_token_t;
 
       /**
-       * \brief A thread pool object is non-copyable.
+       * \brief The consumer token type associated with the queue.
        */
-      parameterized_pool_t(const parameterized_pool_t<BULK_MAX_ITEMS, DEQUEUE_TIMEOUT>&) = delete;
+      using consumer_token_t = typename core_t::consumer_token_t;
 
       /**
-       * \brief A thread pool object is non-copyable.
+       * \constructor
+       * \brief Creates a new thread pool and allocates `concurrency`
+       * number of threads, which run `hooks` around their tasks. Queue
+       * backends supporting a single consumer, such as `spsc_queue_t`,
+       * require a single worker, and also require tasks to be scheduled
+       * by a single thread, whether with a token or not, which is up to
+       * the caller.
+       * \throw std::invalid_argument if the queue backend supports a single
+       * consumer and `concurrency` is not 1.
        */
-      parameterized_pool_t<BULK_MAX_ITEMS, DEQUEUE_TIMEOUT>& operator=(const parameterized_pool_t<BULK_MAX_ITEMS, DEQUEUE_TIMEOUT>&) = delete;
+      parameterized_pool_t(size_t concurrency, const pool_options_t& options = pool_options_t(), const Hooks& hooks = Hooks())
+        : core_t(concurrency, options, options.task_slabs || options.huge_pages, run_task_t(), hooks) {}
 
       /**
        * \brief Pushes data of type `Type_` on the internal
        * blocking queue used to dispatch work to the worker
-       * threads.
+       * threads. The callable and its arguments are moved, or
+       * copied if they are lvalues, into the task, and the
+       * arguments are passed to the callable as rvalues, which
+       * allows move-only callables and arguments to be used.
        */
       template<class F, class... Args>
-      std::future<typename std::result_of<F(Args...)>::type> schedule(const moodycamel::ProducerToken& token, F&& f, Args&&... args) {
-        using return_type = typename std::result_of<F(Args...)>::type;
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-          std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        std::future<return_type> future = task->get_future();
-        if (!tasks_.enqueue(token, [task] () { (*task)(); })) {
+      std::future<task_result_t<F, Args...>> schedule(const producer_token_t& token, F&& f, Args&&... args) {
+        using return_type = task_result_t<F, Args...>;
+        std::future<return_type> future;
+        task_t task = make_task(future, std::forward<F>(f), std::forward<Args>(args)...);
+        task.stamp(metrics_.now());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        if (!tasks_.enqueue(token, std::move(task))) {
           throw std::length_error("Couldn't enqueue the given callable object");
         }
+        wake(1);
         return (future);
       }
 
       /**
        * \brief Pushes data of type `Type_` on the internal
        * blocking queue used to dispatch work to the worker
-       * threads.
+       * threads. The callable and its arguments are moved, or
+       * copied if they are lvalues, into the task, and the
+       * arguments are passed to the callable as rvalues, which
+       * allows move-only callables and arguments to be used.
        */
       template<class F, class... Args>
-      std::future<typename std::result_of<F(Args...)>::type> schedule(F&& f, Args&&... args) {
-        using return_type = typename std::result_of<F(Args...)>::type;
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-          std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        std::future<return_type> future = task->get_future();
-        if (!tasks_.enqueue([task] () { (*task)(); })) {
+      std::future<task_result_t<F, Args...>> schedule(F&& f, Args&&... args) {
+        using return_type = task_result_t<F, Args...>;
+        std::future<return_type> future;
+        task_t task = make_task(future, std::forward<F>(f), std::forward<Args>(args)...);
+        task.stamp(metrics_.now());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        if (!tasks_.enqueue(std::move(task))) {
           throw std::length_error("Couldn't enqueue the given callable object");
         }
+        wake(1);
+        return (future);
+      }
+
+      /**
+       * \brief Same as `.schedule()`, except that the task is labeled with
+       * `label`, under which it is accounted for by the `labeled_metrics_t`
+       * policy, and shows up in traces.
+       */
+      template<class F, class... Args>
+      std::future<task_result_t<F, Args...>> schedule(const producer_token_t& token, task_label_t label, F&& f, Args&&... args) {
+        using return_type = task_result_t<F, Args...>;
+        std::future<return_type> future;
+        task_t task = make_task(future, std::forward<F>(f), std::forward<Args>(args)...);
+        task.stamp(metrics_.now());
+        task.label(label.id());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        if (!tasks_.enqueue(token, std::move(task))) {
+          throw std::length_error("Couldn't enqueue the given callable object");
+        }
+        wake(1);
+        return (future);
+      }
+
+      /**
+       * \brief Same as `.schedule()`, except that the task is labeled with
+       * `label`, under which it is accounted for by the `labeled_metrics_t`
+       * policy, and shows up in traces.
+       */
+      template<class F, class... Args>
+      std::future<task_result_t<F, Args...>> schedule(task_label_t label, F&& f, Args&&... args) {
+        using return_type = task_result_t<F, Args...>;
+        std::future<return_type> future;
+        task_t task = make_task(future, std::forward<F>(f), std::forward<Args>(args)...);
+        task.stamp(metrics_.now());
+        task.label(label.id());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        if (!tasks_.enqueue(std::move(task))) {
+          throw std::length_error("Couldn't enqueue the given callable object");
+        }
+        wake(1);
         return (future);
       }
 
@@ -152,10 +226,12 @@ namespace thread {
        * and you want to avoid the performance overhead of it.
        */
       template<class F, class... Args>
-      bool schedule_and_forget(const moodycamel::ProducerToken& token, F&& f, Args&&... args) noexcept {
-        using return_type = typename std::result_of<F(Args...)>::type;
-        std::function<return_type()> bound = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        return (tasks_.enqueue(token, bound));
+      bool schedule_and_forget(const producer_token_t& token, F&& f, Args&&... args) noexcept {
+        task_t task(task_resource(), bind_arguments(std::forward<F>(f), std::forward<Args>(args)...));
+        task.stamp(metrics_.now());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue(token, std::move(task)) && wake(1));
       }
 
       /**
@@ -166,9 +242,78 @@ namespace thread {
        */
       template<class F, class... Args>
       bool schedule_and_forget(F&& f, Args&&... args) noexcept {
-        using return_type = typename std::result_of<F(Args...)>::type;
-        std::function<return_type()> bound = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        return (tasks_.enqueue(bound));
+        task_t task(task_resource(), bind_arguments(std::forward<F>(f), std::forward<Args>(args)...));
+        task.stamp(metrics_.now());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue(std::move(task)) && wake(1));
+      }
+
+      /**
+       * \brief Same as `.schedule_and_forget()`, except that the task is
+       * labeled with `label`.
+       */
+      template<class F, class... Args>
+      bool schedule_and_forget(const producer_token_t& token, task_label_t label, F&& f, Args&&... args) noexcept {
+        task_t task(task_resource(), bind_arguments(std::forward<F>(f), std::forward<Args>(args)...));
+        task.stamp(metrics_.now());
+        task.label(label.id());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue(token, std::move(task)) && wake(1));
+      }
+
+      /**
+       * \brief Same as `.schedule_and_forget()`, except that the task is
+       * labeled with `label`.
+       */
+      template<class F, class... Args>
+      bool schedule_and_forget(task_label_t label, F&& f, Args&&... args) noexcept {
+        task_t task(task_resource(), bind_arguments(std::forward<F>(f), std::forward<Args>(args)...));
+        task.stamp(metrics_.now());
+        task.label(label.id());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue(std::move(task)) && wake(1));
+      }
+
+      /**
+       * Same as `.schedule_and_forget()`, except that this method does not
+       * allocate memory, and fails instead if the queue has no room left.
+       * The callable, once bound to its arguments, must fit inline within
+       * a task, and the queue backend must provide a `try_enqueue` method,
+       * both of which are checked at compile time.
+       * \return a true value if the callable has been scheduled, false otherwise.
+       */
+      template<class F, class... Args>
+      bool try_schedule(const producer_token_t& token, F&& f, Args&&... args) noexcept {
+        static_assert(task_t::is_inline<bound_type_t<F, Args...>>(), "try_schedule requires callables which fit inline within a task");
+        task_t task(task_resource(), bind_arguments(std::forward<F>(f), std::forward<Args>(args)...));
+        task.stamp(metrics_.now());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (try_enqueue_queue(tasks_, token, std::move(task), 0) && wake(1));
+      }
+
+      /**
+       * Same as `.schedule_and_forget()`, except that this method does not
+       * allocate memory once the calling thread owns the state the queue
+       * keeps for each producer without a token, which it either got on its
+       * first enqueue, or from those set aside by `.reserve()`. It fails
+       * instead if the queue has no room left. The callable, once bound to
+       * its arguments, must fit inline within a task, and the queue backend
+       * must provide a `try_enqueue` method, both of which are checked at
+       * compile time.
+       * \return a true value if the callable has been scheduled, false otherwise.
+       */
+      template<class F, class... Args>
+      bool try_schedule(F&& f, Args&&... args) noexcept {
+        static_assert(task_t::is_inline<bound_type_t<F, Args...>>(), "try_schedule requires callables which fit inline within a task");
+        task_t task(task_resource(), bind_arguments(std::forward<F>(f), std::forward<Args>(args)...));
+        task.stamp(metrics_.now());
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (try_enqueue_queue(tasks_, std::move(task), 0) && wake(1));
       }
 
       /**
@@ -177,8 +322,10 @@ namespace thread {
        * \return a true value if the schedule operation was
        * successful, false otherwise.
        */
-      bool schedule_bulk(const moodycamel::ProducerToken& token, const consumer_t array[], size_t size) noexcept {
-        return (tasks_.enqueue_bulk(token, array, size));
+      bool schedule_bulk(const producer_token_t& token, const consumer_t array[], size_t size) noexcept {
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue_bulk(token, task_iterator_t<const consumer_t*>(array, task_resource(), metrics_.now()), size) && wake(size));
       }
 
       /**
@@ -188,17 +335,333 @@ namespace thread {
        * successful, false otherwise.
        */
       bool schedule_bulk(const consumer_t array[], size_t size) noexcept {
-        return (tasks_.enqueue_bulk(array, size));
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue_bulk(task_iterator_t<const consumer_t*>(array, task_resource(), metrics_.now()), size) && wake(size));
+      }
+
+      /**
+       * \brief Schedules the execution of the callables in the range
+       * `[first, last)` amongst the available worker threads. Callables
+       * are moved into the tasks if the iterators yield rvalues, such as
+       * the iterators created by `std::make_move_iterator`, and are copied
+       * otherwise. The iterators must be forward iterators.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename It>
+      bool schedule_bulk(const producer_token_t& token, It first, It last) noexcept {
+        size_t size = static_cast<size_t>(std::distance(first, last));
+        return (enqueue_bulk(token, make_task_iterator(first, task_resource(), metrics_.now()), size));
+      }
+
+      /**
+       * \brief Schedules the execution of the callables in the range
+       * `[first, last)` amongst the available worker threads. Callables
+       * are moved into the tasks if the iterators yield rvalues, such as
+       * the iterators created by `std::make_move_iterator`, and are copied
+       * otherwise. The iterators must be forward iterators.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename It>
+      bool schedule_bulk(It first, It last) noexcept {
+        size_t size = static_cast<size_t>(std::distance(first, last));
+        return (enqueue_bulk(make_task_iterator(first, task_resource(), metrics_.now()), size));
+      }
+
+      /**
+       * \brief Schedules the execution of the callables held by a range,
+       * such as a container, amongst the available worker threads. The
+       * callables are moved out of ranges passed as rvalues, and are
+       * copied from ranges passed as lvalues.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename Range>
+      auto schedule_bulk(const producer_token_t& token, Range&& range) noexcept
+        -> decltype(std::begin(range), std::end(range), bool()) {
+        using moved_t = std::integral_constant<bool, !std::is_lvalue_reference<Range>::value>;
+        return (schedule_bulk(token, range_begin(range, moved_t()), range_end(range, moved_t())));
+      }
+
+      /**
+       * \brief Schedules the execution of the callables held by a range,
+       * such as a container, amongst the available worker threads. The
+       * callables are moved out of ranges passed as rvalues, and are
+       * copied from ranges passed as lvalues.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename Range>
+      auto schedule_bulk(Range&& range) noexcept
+        -> decltype(std::begin(range), std::end(range), bool()) {
+        using moved_t = std::integral_constant<bool, !std::is_lvalue_reference<Range>::value>;
+        return (schedule_bulk(range_begin(range, moved_t()), range_end(range, moved_t())));
+      }
+
+      /**
+       * \brief Schedules the execution of `size` callables returned by
+       * successive calls to `generator` amongst the available worker threads.
+       * The generator is called by the calling thread, while the callables
+       * are being enqueued, so they are never stored anywhere else.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename G>
+      auto schedule_bulk(const producer_token_t& token, G&& generator, size_t size) noexcept
+        -> decltype(generator(), bool()) {
+        using generator_t = typename std::remove_reference<G>::type;
+        return (enqueue_bulk(token, make_task_iterator(generator_iterator_t<generator_t>(generator), task_resource(), metrics_.now()), size));
+      }
+
+      /**
+       * \brief Schedules the execution of `size` callables returned by
+       * successive calls to `generator` amongst the available worker threads.
+       * The generator is called by the calling thread, while the callables
+       * are being enqueued, so they are never stored anywhere else.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename G>
+      auto schedule_bulk(G&& generator, size_t size) noexcept
+        -> decltype(generator(), bool()) {
+        using generator_t = typename std::remove_reference<G>::type;
+        return (enqueue_bulk(make_task_iterator(generator_iterator_t<generator_t>(generator), task_resource(), metrics_.now()), size));
+      }
+
+      /**
+       * \brief Schedules `size` invocations of `f`, which is called with
+       * each index in `[0, size)` amongst the available worker threads.
+       * A single copy of `f` is shared by the scheduled tasks, which only
+       * hold a reference to it along with their index and are stored inline,
+       * so that scheduling them does not allocate more than the blocks of
+       * the queue. Since `f` may be invoked from several workers at once,
+       * it is invoked as a const callable.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename F>
+      bool schedule_bulk_n(const producer_token_t& token, size_t size, F&& f) noexcept {
+        if (size == 0) {
+          return (true);
+        }
+        using function_t = typename std::decay<F>::type;
+        shared_callable_t<function_t>* shared = shared_callable_t<function_t>::create(task_resource(), std::forward<F>(f));
+        bool scheduled = enqueue_bulk(token, make_task_iterator(index_iterator_t<function_t>(shared, 0), task_resource(), metrics_.now()), size);
+        shared->release();
+        return (scheduled);
+      }
+
+      /**
+       * \brief Schedules `size` invocations of `f`, which is called with
+       * each index in `[0, size)` amongst the available worker threads.
+       * A single copy of `f` is shared by the scheduled tasks, which only
+       * hold a reference to it along with their index and are stored inline,
+       * so that scheduling them does not allocate more than the blocks of
+       * the queue. Since `f` may be invoked from several workers at once,
+       * it is invoked as a const callable.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename F>
+      bool schedule_bulk_n(size_t size, F&& f) noexcept {
+        if (size == 0) {
+          return (true);
+        }
+        using function_t = typename std::decay<F>::type;
+        shared_callable_t<function_t>* shared = shared_callable_t<function_t>::create(task_resource(), std::forward<F>(f));
+        bool scheduled = enqueue_bulk(make_task_iterator(index_iterator_t<function_t>(shared, 0), task_resource(), metrics_.now()), size);
+        shared->release();
+        return (scheduled);
+      }
+
+      /**
+       * \brief Schedules the execution of the callables in the range
+       * `[first, last)` amongst the available worker threads, in the same
+       * way `.schedule_bulk()` does, as a single batch.
+       * \return a handle to the batch, which completes once every callable
+       * has been invoked, and holds the first exception thrown by one of
+       * them. Whatever the size of the batch, its tasks share a single
+       * state allocated from the pool resource.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename It>
+      batch_t schedule_batch(const producer_token_t& token, It first, It last) {
+        return (enqueue_batch(token, first, static_cast<size_t>(std::distance(first, last))));
+      }
+
+      /**
+       * \brief Schedules the execution of the callables in the range
+       * `[first, last)` amongst the available worker threads, in the same
+       * way `.schedule_bulk()` does, as a single batch.
+       * \return a handle to the batch, which completes once every callable
+       * has been invoked, and holds the first exception thrown by one of
+       * them. Whatever the size of the batch, its tasks share a single
+       * state allocated from the pool resource.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename It>
+      batch_t schedule_batch(It first, It last) {
+        return (enqueue_batch(first, static_cast<size_t>(std::distance(first, last))));
+      }
+
+      /**
+       * \brief Schedules the execution of the callables held by a range
+       * as a single batch. The callables are moved out of ranges passed
+       * as rvalues, and are copied from ranges passed as lvalues.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename Range>
+      auto schedule_batch(const producer_token_t& token, Range&& range)
+        -> decltype(std::begin(range), std::end(range), batch_t()) {
+        using moved_t = std::integral_constant<bool, !std::is_lvalue_reference<Range>::value>;
+        return (schedule_batch(token, range_begin(range, moved_t()), range_end(range, moved_t())));
+      }
+
+      /**
+       * \brief Schedules the execution of the callables held by a range
+       * as a single batch. The callables are moved out of ranges passed
+       * as rvalues, and are copied from ranges passed as lvalues.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename Range>
+      auto schedule_batch(Range&& range)
+        -> decltype(std::begin(range), std::end(range), batch_t()) {
+        using moved_t = std::integral_constant<bool, !std::is_lvalue_reference<Range>::value>;
+        return (schedule_batch(range_begin(range, moved_t()), range_end(range, moved_t())));
+      }
+
+      /**
+       * \brief Schedules `size` invocations of `f` with each index in
+       * `[0, size)`, in the same way `.schedule_bulk_n()` does, as a
+       * single batch. Along with the shared copy of `f`, the batch only
+       * allocates its state, however many tasks it holds.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename F>
+      batch_t schedule_batch_n(const producer_token_t& token, size_t size, F&& f) {
+        using function_t = typename std::decay<F>::type;
+        shared_callable_t<function_t>* shared = shared_callable_t<function_t>::create(task_resource(), std::forward<F>(f));
+        batch_state_t* state = create_batch_state(shared);
+        bool scheduled = size == 0 || enqueue_bulk(token, make_task_iterator(make_batch_iterator(index_iterator_t<function_t>(shared, 0), state), task_resource(), metrics_.now()), size);
+        shared->release();
+        return (complete_batch(state, scheduled));
+      }
+
+      /**
+       * \brief Schedules `size` invocations of `f` with each index in
+       * `[0, size)`, in the same way `.schedule_bulk_n()` does, as a
+       * single batch. Along with the shared copy of `f`, the batch only
+       * allocates its state, however many tasks it holds.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename F>
+      batch_t schedule_batch_n(size_t size, F&& f) {
+        using function_t = typename std::decay<F>::type;
+        shared_callable_t<function_t>* shared = shared_callable_t<function_t>::create(task_resource(), std::forward<F>(f));
+        batch_state_t* state = create_batch_state(shared);
+        bool scheduled = size == 0 || enqueue_bulk(make_task_iterator(make_batch_iterator(index_iterator_t<function_t>(shared, 0), state), task_resource(), metrics_.now()), size);
+        shared->release();
+        return (complete_batch(state, scheduled));
+      }
+
+      /**
+       * \brief Schedules the execution of `f` with `args`, and stores its
+       * result into `slot` rather than into the shared state of a future.
+       * The callable and its arguments are bound in the same way as by
+       * `.schedule()`. `slot` must remain valid until the batch completes.
+       * \return a handle to a batch holding the task.
+       * \throw std::length_error if the callable could not be enqueued.
+       */
+      template <typename R, typename F, typename... Args>
+      batch_t schedule_into(const producer_token_t& token, R* slot, F&& f, Args&&... args) {
+        into_task_t<R, bound_type_t<F, Args...>> task(bind_arguments(std::forward<F>(f), std::forward<Args>(args)...), slot);
+        return (enqueue_batch(token, std::make_move_iterator(&task), 1));
+      }
+
+      /**
+       * \brief Schedules the execution of `f` with `args`, and stores its
+       * result into `slot` rather than into the shared state of a future.
+       * The callable and its arguments are bound in the same way as by
+       * `.schedule()`. `slot` must remain valid until the batch completes.
+       * \return a handle to a batch holding the task.
+       * \throw std::length_error if the callable could not be enqueued.
+       */
+      template <typename R, typename F, typename... Args>
+      batch_t schedule_into(R* slot, F&& f, Args&&... args) {
+        into_task_t<R, bound_type_t<F, Args...>> task(bind_arguments(std::forward<F>(f), std::forward<Args>(args)...), slot);
+        return (enqueue_batch(std::make_move_iterator(&task), 1));
+      }
+
+      /**
+       * \brief Schedules the execution of the callables in the range
+       * `[first, last)` as a single batch, and stores the result of the
+       * n-th callable into `results[n]`. Callables are moved or copied
+       * into the tasks in the same way as by `.schedule_bulk()`.
+       * `results` must remain valid until the batch completes.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename R, typename It>
+      batch_t schedule_bulk_into(const producer_token_t& token, R* results, It first, It last) {
+        return (enqueue_batch(token, into_iterator_t<It, R>(first, results), static_cast<size_t>(std::distance(first, last))));
+      }
+
+      /**
+       * \brief Schedules the execution of the callables in the range
+       * `[first, last)` as a single batch, and stores the result of the
+       * n-th callable into `results[n]`. Callables are moved or copied
+       * into the tasks in the same way as by `.schedule_bulk()`.
+       * `results` must remain valid until the batch completes.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename R, typename It>
+      batch_t schedule_bulk_into(R* results, It first, It last) {
+        return (enqueue_batch(into_iterator_t<It, R>(first, results), static_cast<size_t>(std::distance(first, last))));
+      }
+
+      /**
+       * \brief Schedules `size` invocations of `f` with each index in
+       * `[0, size)` as a single batch, and stores the result of `f(i)`
+       * into `results[i]`, so that results land in a contiguous array
+       * without any future. Tasks are scheduled in the same way as by
+       * `.schedule_bulk_n()`. `results` must remain valid until the
+       * batch completes.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename R, typename F>
+      batch_t schedule_bulk_into_n(const producer_token_t& token, R* results, size_t size, F&& f) {
+        return (schedule_batch_n(token, size, into_index_t<R, typename std::decay<F>::type>(std::forward<F>(f), results)));
+      }
+
+      /**
+       * \brief Schedules `size` invocations of `f` with each index in
+       * `[0, size)` as a single batch, and stores the result of `f(i)`
+       * into `results[i]`, so that results land in a contiguous array
+       * without any future. Tasks are scheduled in the same way as by
+       * `.schedule_bulk_n()`. `results` must remain valid until the
+       * batch completes.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
+       */
+      template <typename R, typename F>
+      batch_t schedule_bulk_into_n(R* results, size_t size, F&& f) {
+        return (schedule_batch_n(size, into_index_t<R, typename std::decay<F>::type>(std::forward<F>(f), results)));
       }
 
       /**
        * \brief Blocks until every threads in the thread pool
        * have been terminated.
        */
-      parameterized_pool_t<BULK_MAX_ITEMS, DEQUEUE_TIMEOUT>& await() {
-        for (std::thread& t : threads_) {
-          t.join();
-        }
+      parameterized_pool_t& await() {
+        core_t::join();
         return (*this);
       }
 
@@ -206,55 +669,169 @@ namespace thread {
        * \brief Stops the execution of the threads allocated
        * by the thread pool.
        */
-      parameterized_pool_t<BULK_MAX_ITEMS, DEQUEUE_TIMEOUT>& stop() noexcept {
-        done_.store(true);
+      parameterized_pool_t& stop() noexcept {
+        core_t::halt();
         return (*this);
       }
 
       /**
-       * \brief Creates a new producer token associated with
-       * the internal queue.
+       * \brief Pre-allocates the memory needed to hold `tasks` callables
+       * scheduled by `producers` threads without a token, so that a burst
+       * following this call does not allocate while traffic is flowing.
+       * This reserves the blocks of the queue and the state of its
+       * producers, and, when task slabs are enabled, slabs able to hold
+       * the callables of `task_size` bytes which do not fit inline. Workers
+       * also pre-fault `STACK_RESERVE` bytes of their stack the next time
+       * they are idle. The shared state of futures is still allocated by
+       * `.schedule()`, and producer tokens allocate their storage when they
+       * are created. Trimming the queue releases the reserved blocks.
+       * It may be called while tasks are being scheduled, but the reserved
+       * producers only go to threads enqueuing without a token for the first
+       * time, so it should be called before these threads start producing.
+       * \return false if the memory could not be allocated.
        */
-      template <typename T>
-      typename std::enable_if<
-        std::is_same<T, producer_token_t>::value || std::is_same<T, consumer_token_t>::value, T
-      >::type
-      create_token_of() {
-        return (T(tasks_));
+      bool reserve(size_t tasks, size_t producers = 1, size_t task_size = 2 * task_t::INLINE_SIZE) {
+        producers = producers > 0 ? producers : 1;
+        if (slabs_) {
+          size_t per_producer = (tasks + producers - 1) / producers;
+          slabs_->reserve(producers, per_producer * slab_resource_t::footprint(task_size));
+        }
+        return (core_t::reserve_elements(tasks, producers));
       }
 
     private:
 
+      using core_t::resource_;
+      using core_t::slabs_;
+      using core_t::tasks_;
+      using core_t::gate_;
+      using core_t::metrics_;
+      using core_t::wake;
+
+      /**
+       * \return the resource from which the callables which do not
+       * fit inline within a task are allocated.
+       */
+      memory_resource_t* task_resource() const noexcept {
+        return (slabs_ ? static_cast<memory_resource_t*>(slabs_.get()) : resource_.get());
+      }
+
+      /**
+       * \brief Creates a task delivering the result of the given callable
+       * to `future`. The shared state of the future is always allocated
+       * from the pool resource rather than from the slabs, since futures
+       * may outlive the pool.
+       */
+      template <class R, class F, class... Args>
+      task_t make_task(std::future<R>& future, F&& f, Args&&... args) {
+        promise_task_t<R, bound_type_t<F, Args...>> task{
+          bind_arguments(std::forward<F>(f), std::forward<Args>(args)...),
+          std::promise<R>(std::allocator_arg, resource_allocator_t<char>(resource_.get()))
+        };
+        future = task.promise.get_future();
+        return (task_t(task_resource(), std::move(task)));
+      }
+
+      /**
+       * \brief Enqueues `count` tasks read from `first`, and wakes
+       * up the workers needed to run them.
+       */
+      template <typename It>
+      bool enqueue_bulk(const producer_token_t& token, It first, size_t count) noexcept {
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue_bulk(token, first, count) && wake(count));
+      }
+
+      /**
+       * \brief Enqueues `count` tasks read from `first`, and wakes
+       * up the workers needed to run them.
+       */
+      template <typename It>
+      bool enqueue_bulk(It first, size_t count) noexcept {
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue_bulk(first, count) && wake(count));
+      }
+
       /**
-       * \brief Worker threads vector container.
+       * \brief Enqueues `size` callables read from `first` as a single batch.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
        */
-      std::vector<std::thread> threads_;
+      template <typename It>
+      batch_t enqueue_batch(const producer_token_t& token, It first, size_t size) {
+        batch_state_t* state = batch_state_t::create(resource_.get());
+        return (complete_batch(state, enqueue_bulk(token, make_task_iterator(make_batch_iterator(first, state), task_resource(), metrics_.now()), size)));
+      }
 
       /**
-       * \brief Blocking concurrent queue used to store and dispatch work
-       * amonst worker threads.
+       * \brief Enqueues `size` callables read from `first` as a single batch.
+       * \return a handle to the batch.
+       * \throw std::length_error if the callables could not be enqueued.
        */
-      moodycamel::BlockingConcurrentQueue<consumer_t> tasks_;
+      template <typename It>
+      batch_t enqueue_batch(It first, size_t size) {
+        batch_state_t* state = batch_state_t::create(resource_.get());
+        return (complete_batch(state, enqueue_bulk(make_task_iterator(make_batch_iterator(first, state), task_resource(), metrics_.now()), size)));
+      }
 
       /**
-       * \brief States whether the execution of worker threads
-       * should continue.
+       * \brief Creates the state of a batch sharing the callable `shared`,
+       * which is released if the state could not be allocated.
+       * \return the state of the batch.
        */
-      std::atomic<bool> done_;
+      template <typename Shared>
+      batch_state_t* create_batch_state(Shared* shared) {
+        try {
+          return (batch_state_t::create(resource_.get()));
+        } catch (...) {
+          shared->release();
+          throw;
+        }
+      }
 
       /**
-       * \brief Internal worker dispatching work to the given
-       * consumer worker implementation.
+       * \brief Completes the scheduling of a batch, by releasing the pending
+       * task standing for the scheduling thread.
+       * \return a handle to the batch.
+       * \throw std::length_error if the tasks could not be enqueued.
        */
-      void worker() {
-        auto token = create_token_of<thread::pool::consumer_token_t>();
-        while (!done_) {
-          consumer_t runnable[BULK_MAX_ITEMS] = {};
-          auto available = tasks_.wait_dequeue_bulk_timed(token, runnable, BULK_MAX_ITEMS, std::chrono::milliseconds(DEQUEUE_TIMEOUT));
-          for (size_t i = 0; i < available; ++i) {
-            runnable[i]();
-          }
+      static batch_t complete_batch(batch_state_t* state, bool scheduled) {
+        batch_t batch(state);
+        state->complete();
+        if (!scheduled) {
+          throw std::length_error("Couldn't enqueue the given callable objects");
         }
+        return (batch);
+      }
+
+      /**
+       * \return an iterator to the first element of a range, which
+       * moves the elements out of the range if it is an rvalue.
+       */
+      template <typename Range>
+      static auto range_begin(Range& range, std::true_type) -> decltype(std::make_move_iterator(std::begin(range))) {
+        return (std::make_move_iterator(std::begin(range)));
+      }
+
+      template <typename Range>
+      static auto range_begin(Range& range, std::false_type) -> decltype(std::begin(range)) {
+        return (std::begin(range));
+      }
+
+      /**
+       * \return an iterator past the last element of a range, which
+       * moves the elements out of the range if it is an rvalue.
+       */
+      template <typename Range>
+      static auto range_end(Range& range, std::true_type) -> decltype(std::make_move_iterator(std::end(range))) {
+        return (std::make_move_iterator(std::end(range)));
+      }
+
+      template <typename Range>
+      static auto range_end(Range& range, std::false_type) -> decltype(std::end(range)) {
+        return (std::end(range));
       }
     };
 
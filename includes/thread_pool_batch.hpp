@@ -0,0 +1,515 @@
+#ifndef THREAD_POOL_BATCH_H_
+#define THREAD_POOL_BATCH_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_pool_memory.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \class batch_state_t
+     * \brief The state shared by the tasks of a batch and the handles
+     * referring to it. It counts the tasks of the batch which have not
+     * completed yet, keeps the first exception thrown by one of them, and
+     * runs the continuations attached to the batch once the last task
+     * completes. The state is allocated from a resource, and is released
+     * once the last task and the last handle are gone.
+     */
+    class batch_state_t {
+    public:
+
+      /**
+       * \brief A callable invoked once every task of a batch has completed,
+       * with the first exception thrown by a task, or a null pointer.
+       */
+      using continuation_t = std::function<void(std::exception_ptr)>;
+
+      /**
+       * \return a new state, referenced once by its creator and once by
+       * the tasks of the batch. The state has a single pending task,
+       * which stands for the creator while tasks are being scheduled.
+       */
+      static batch_state_t* create(memory_resource_t* resource) {
+        void* memory = resource->allocate(sizeof(batch_state_t), alignof(batch_state_t));
+        return (new (memory) batch_state_t(resource));
+      }
+
+      void acquire() noexcept {
+        references_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      void release() noexcept {
+        if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          memory_resource_t* resource = resource_;
+          this->~batch_state_t();
+          resource->deallocate(this, sizeof(batch_state_t), alignof(batch_state_t));
+        }
+      }
+
+      /**
+       * \brief Registers a new pending task.
+       */
+      void add() noexcept {
+        pending_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      /**
+       * \brief Records `exception` if it is the first one.
+       */
+      void fail(std::exception_ptr exception) noexcept {
+        bool expected = false;
+        if (failed_.compare_exchange_strong(expected, true, std::memory_order_relaxed)) {
+          exception_ = exception;
+        }
+      }
+
+      /**
+       * \brief Signals the completion of a pending task, which completes
+       * the batch if it was the last one.
+       */
+      void complete() noexcept {
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          finish();
+        }
+      }
+
+      /**
+       * \return whether every task of the batch has completed.
+       */
+      bool ready() const noexcept {
+        return (pending_.load(std::memory_order_acquire) == 0);
+      }
+
+      /**
+       * \brief Blocks until every task of the batch has completed.
+       */
+      void wait() {
+        if (ready()) {
+          return;
+        }
+        std::unique_lock<std::mutex> lock(lock_);
+        done_.wait(lock, [this] () { return (finished_); });
+      }
+
+      /**
+       * \brief Blocks until every task of the batch has completed,
+       * or until `timeout` has elapsed.
+       * \return whether every task of the batch has completed.
+       */
+      template <typename Rep, typename Period>
+      bool wait_for(const std::chrono::duration<Rep, Period>& timeout) {
+        if (ready()) {
+          return (true);
+        }
+        std::unique_lock<std::mutex> lock(lock_);
+        return (done_.wait_for(lock, timeout, [this] () { return (finished_); }));
+      }
+
+      /**
+       * \return the first exception thrown by a task of the batch, which
+       * is only meaningful once the batch has completed.
+       */
+      std::exception_ptr exception() const noexcept {
+        return (failed_.load(std::memory_order_acquire) ? exception_ : nullptr);
+      }
+
+      /**
+       * \brief Attaches a continuation to the batch, which is invoked by
+       * the thread completing the last task of the batch, or right away
+       * by the calling thread if the batch has already completed.
+       */
+      void then(continuation_t continuation) {
+        {
+          std::lock_guard<std::mutex> lock(lock_);
+          if (!finished_) {
+            continuations_.push_back(std::move(continuation));
+            return;
+          }
+        }
+        continuation(exception());
+      }
+
+    private:
+
+      explicit batch_state_t(memory_resource_t* resource)
+        : pending_(1), references_(2), failed_(false), finished_(false), resource_(resource) {}
+
+      /**
+       * \brief Wakes up the waiting threads and runs the continuations,
+       * once the last task of the batch has completed.
+       */
+      void finish() noexcept {
+        std::vector<continuation_t> continuations;
+        {
+          std::lock_guard<std::mutex> lock(lock_);
+          finished_ = true;
+          continuations.swap(continuations_);
+        }
+        done_.notify_all();
+        for (continuation_t& continuation : continuations) {
+          try {
+            continuation(exception());
+          } catch (...) {}
+        }
+        // Releasing the reference held by the tasks.
+        release();
+      }
+
+      /**
+       * \brief The number of tasks which have not completed yet.
+       */
+      std::atomic<size_t> pending_;
+
+      /**
+       * \brief The number of references to the state.
+       */
+      std::atomic<size_t> references_;
+
+      /**
+       * \brief Whether an exception has been recorded.
+       */
+      std::atomic<bool> failed_;
+
+      /**
+       * \brief The first exception thrown by a task.
+       */
+      std::exception_ptr exception_;
+
+      /**
+       * \brief Lock guarding the completion of the
+       * batch and the list of continuations.
+       */
+      std::mutex lock_;
+
+      /**
+       * \brief Signaled once the batch has completed.
+       */
+      std::condition_variable done_;
+
+      /**
+       * \brief Whether the batch has completed.
+       */
+      bool finished_;
+
+      /**
+       * \brief The continuations attached to the batch.
+       */
+      std::vector<continuation_t> continuations_;
+
+      /**
+       * \brief The resource the state has been allocated from.
+       */
+      memory_resource_t* resource_;
+    };
+
+    /**
+     * \class batch_t
+     * \brief A handle to a batch of tasks scheduled at once, which is
+     * backed by a single shared state whatever the size of the batch,
+     * rather than by one future per task.
+     */
+    class batch_t {
+    public:
+
+      /**
+       * \constructor
+       * \brief Creates a handle referring to no batch.
+       */
+      batch_t() noexcept
+        : state_(nullptr) {}
+
+      /**
+       * \constructor
+       * \brief Takes over a reference to `state`.
+       */
+      explicit batch_t(batch_state_t* state) noexcept
+        : state_(state) {}
+
+      batch_t(const batch_t& other) noexcept
+        : state_(other.state_) {
+        if (state_ != nullptr) {
+          state_->acquire();
+        }
+      }
+
+      batch_t(batch_t&& other) noexcept
+        : state_(other.state_) {
+        other.state_ = nullptr;
+      }
+
+      batch_t& operator=(batch_t other) noexcept {
+        std::swap(state_, other.state_);
+        return (*this);
+      }
+
+      ~batch_t() {
+        if (state_ != nullptr) {
+          state_->release();
+        }
+      }
+
+      /**
+       * \return whether the handle refers to a batch.
+       */
+      bool valid() const noexcept {
+        return (state_ != nullptr);
+      }
+
+      /**
+       * \return whether every task of the batch has completed.
+       */
+      bool ready() const noexcept {
+        return (state_->ready());
+      }
+
+      /**
+       * \brief Blocks until every task of the batch has completed.
+       */
+      void wait() const {
+        state_->wait();
+      }
+
+      /**
+       * \brief Blocks until every task of the batch has completed,
+       * or until `timeout` has elapsed.
+       * \return `std::future_status::ready` if every task of the batch
+       * has completed, `std::future_status::timeout` otherwise.
+       */
+      template <typename Rep, typename Period>
+      std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+        return (state_->wait_for(timeout) ? std::future_status::ready : std::future_status::timeout);
+      }
+
+      /**
+       * \brief Blocks until every task of the batch has completed, and
+       * rethrows the first exception thrown by one of them, if any.
+       */
+      void get() const {
+        state_->wait();
+        std::exception_ptr exception = state_->exception();
+        if (exception) {
+          std::rethrow_exception(exception);
+        }
+      }
+
+      /**
+       * \return the first exception thrown by a task of the batch,
+       * or a null pointer, once the batch has completed.
+       */
+      std::exception_ptr exception() const noexcept {
+        return (state_->exception());
+      }
+
+      /**
+       * \brief Attaches a continuation to the batch, invoked with the first
+       * exception thrown by a task of the batch, or a null pointer, by the
+       * thread completing the last task of the batch, or right away by the
+       * calling thread if the batch has already completed. Exceptions thrown
+       * by continuations invoked by a worker are ignored.
+       */
+      template <typename F>
+      void then(F&& continuation) const {
+        state_->then(batch_state_t::continuation_t(std::forward<F>(continuation)));
+      }
+
+    private:
+
+      batch_state_t* state_;
+    };
+
+    /**
+     * \class batch_task_t
+     * \brief A callable belonging to a batch, which signals its completion,
+     * and the exception it may throw, to the state of the batch. A task
+     * destroyed without having been invoked, for instance because it could
+     * not be enqueued, completes with a `std::future_error`.
+     */
+    template <typename F>
+    class batch_task_t {
+    public:
+
+      template <typename G>
+      batch_task_t(G&& function, batch_state_t* state)
+        : function_(std::forward<G>(function)), state_(state) {
+        state_->add();
+      }
+
+      batch_task_t(batch_task_t&& other) noexcept(std::is_nothrow_move_constructible<F>::value)
+        : function_(std::move(other.function_)), state_(other.state_) {
+        other.state_ = nullptr;
+      }
+
+      ~batch_task_t() {
+        if (state_ != nullptr) {
+          state_->fail(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+          state_->complete();
+        }
+      }
+
+      batch_task_t(const batch_task_t&) = delete;
+      batch_task_t& operator=(const batch_task_t&) = delete;
+
+      void operator()() {
+        try {
+          function_();
+        } catch (...) {
+          state_->fail(std::current_exception());
+        }
+        batch_state_t* state = state_;
+        state_ = nullptr;
+        state->complete();
+      }
+
+    private:
+
+      F function_;
+      batch_state_t* state_;
+    };
+
+    /**
+     * \class batch_iterator_t
+     * \brief An iterator adaptor making the callables read
+     * from `It` part of a batch.
+     */
+    template <typename It>
+    class batch_iterator_t {
+    public:
+
+      /**
+       * \brief The type of the callables read from `It`.
+       */
+      using callable_t = typename std::decay<decltype(*std::declval<It&>())>::type;
+
+      batch_iterator_t(It it, batch_state_t* state)
+        : it_(it), state_(state) {}
+
+      batch_task_t<callable_t> operator*() const {
+        return (batch_task_t<callable_t>(*it_, state_));
+      }
+
+      batch_iterator_t& operator++() {
+        ++it_;
+        return (*this);
+      }
+
+      batch_iterator_t operator++(int) {
+        batch_iterator_t previous(*this);
+        ++it_;
+        return (previous);
+      }
+
+    private:
+
+      It it_;
+      batch_state_t* state_;
+    };
+
+    /**
+     * \return an iterator making the callables read from `it` part of a batch.
+     */
+    template <typename It>
+    batch_iterator_t<It> make_batch_iterator(It it, batch_state_t* state) {
+      return (batch_iterator_t<It>(it, state));
+    }
+
+    /**
+     * \class into_task_t
+     * \brief A callable storing the result of a callable into
+     * storage provided by the caller, rather than into a future.
+     */
+    template <typename R, typename F>
+    class into_task_t {
+    public:
+
+      template <typename G>
+      into_task_t(G&& function, R* slot)
+        : function_(std::forward<G>(function)), slot_(slot) {}
+
+      void operator()() {
+        *slot_ = function_();
+      }
+
+    private:
+
+      F function_;
+      R* slot_;
+    };
+
+    /**
+     * \class into_index_t
+     * \brief A callable storing the result of a callable invoked
+     * with an index at that index of an array provided by the caller.
+     */
+    template <typename R, typename F>
+    class into_index_t {
+    public:
+
+      template <typename G>
+      into_index_t(G&& function, R* results)
+        : function_(std::forward<G>(function)), results_(results) {}
+
+      void operator()(size_t index) const {
+        results_[index] = function_(index);
+      }
+
+    private:
+
+      F function_;
+      R* results_;
+    };
+
+    /**
+     * \class into_iterator_t
+     * \brief An iterator adaptor storing the results of the callables
+     * read from `It` into successive elements of an array.
+     */
+    template <typename It, typename R>
+    class into_iterator_t {
+    public:
+
+      /**
+       * \brief The type of the callables read from `It`.
+       */
+      using callable_t = typename std::decay<decltype(*std::declval<It&>())>::type;
+
+      into_iterator_t(It it, R* results)
+        : it_(it), results_(results) {}
+
+      into_task_t<R, callable_t> operator*() const {
+        return (into_task_t<R, callable_t>(*it_, results_));
+      }
+
+      into_iterator_t& operator++() {
+        ++it_;
+        ++results_;
+        return (*this);
+      }
+
+      into_iterator_t operator++(int) {
+        into_iterator_t previous(*this);
+        ++(*this);
+        return (previous);
+      }
+
+    private:
+
+      It it_;
+      R* results_;
+    };
+  };
+};
+
+#endif // THREAD_POOL_BATCH_H_
@@ -0,0 +1,357 @@
+#ifndef THREAD_POOL_BATCH_POOL_H_
+#define THREAD_POOL_BATCH_POOL_H_
+
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "thread_pool.hpp"
+#include "blocking_concurrent_queue.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \struct batch_options_t
+     * \brief Runtime options of a batch pool, passed to its constructor.
+     */
+    struct batch_options_t {
+
+      /**
+       * \brief The maximum number of items handed to the handler at once.
+       */
+      size_t max_batch;
+
+      /**
+       * \brief The number of items a worker waits for, during at most
+       * `linger`, before handing a batch to the handler.
+       */
+      size_t min_batch;
+
+      /**
+       * \brief How long a worker which dequeued fewer than `min_batch`
+       * items waits for more items to arrive, which trades the latency
+       * of the first items of a batch for fuller batches.
+       */
+      std::chrono::microseconds linger;
+
+      /**
+       * \brief The capacity of the queue, which is a hint. A zero
+       * capacity lets the queue pick its own default.
+       */
+      size_t capacity;
+
+      /**
+       * \brief The resource from which the blocks of the queue are
+       * allocated. A null resource stands for the global heap.
+       */
+      memory_resource_t* resource;
+
+      /**
+       * \constructor
+       * \brief By default, workers hand whatever they could dequeue
+       * to the handler right away, up to 256 items at once.
+       */
+      batch_options_t(size_t max_batch = 256, size_t min_batch = 1, std::chrono::microseconds linger = std::chrono::microseconds(0))
+        : max_batch(max_batch),
+          min_batch(min_batch),
+          linger(linger),
+          capacity(0),
+          resource(nullptr) {}
+    };
+
+    /**
+     * \struct batch_pool_t
+     * \brief A thread pool consuming data items rather than callables.
+     * Producers enqueue `T` values, and workers hand them to an instance
+     * of `Handler` in batches of up to `max_batch` items, so that handlers
+     * can process them as a whole, for instance to write them at once.
+     *
+     * A worker blocks on the `moodycamel::BlockingConcurrentQueue` holding
+     * the items until at least one item is available, and takes as many of
+     * them as it can. If it got fewer than `min_batch` items, it keeps on
+     * waiting for more during at most `linger`, in the same way as Kafka's
+     * `linger.ms`, before handing them to the handler.
+     *
+     * The handler is invoked as a const callable taking a pointer to the
+     * first item of a batch and the number of items, from several workers
+     * at once, and must not throw. It may move the items out of the batch.
+     * Workers check whether the pool has been stopped at least every
+     * `DEQUEUE_TIMEOUT` milliseconds, and items which are still queued
+     * once the pool is stopped are dropped.
+     */
+    template <
+      typename T,
+      typename Handler,
+      milliseconds_t DEQUEUE_TIMEOUT = 100
+    >
+    struct batch_pool_t {
+
+      static_assert(std::is_default_constructible<T>::value, "batch pools require default constructible items");
+      static_assert(std::is_move_assignable<T>::value, "batch pools require move assignable items");
+
+      /**
+       * \brief The type of the items consumed by the pool.
+       */
+      using value_type = T;
+
+      /**
+       * \brief The type of the queue holding the items.
+       */
+      using queue_t = moodycamel::BlockingConcurrentQueue<T, resource_queue_traits_t>;
+
+      /**
+       * \brief The producer token type associated with the queue.
+       */
+      using producer_token_t = typename queue_t::producer_token_t;
+
+      /**
+       * \constructor
+       * \brief Creates a new batch pool and allocates `concurrency`
+       * number of threads, which hand the items to `handler`.
+       */
+      batch_pool_t(size_t concurrency, const batch_options_t& options = batch_options_t(), const Handler& handler = Handler())
+        : options_(normalize(options)),
+          handler_(handler),
+          resource_(new counting_resource_t(options.resource != nullptr ? options.resource : new_delete_resource())),
+          // The queue allocates its initial storage from the pool resource.
+          items_((resource_scope_t(resource_.get()), options.capacity > 0 ? options.capacity : 6 * queue_t::BLOCK_SIZE)),
+          done_(false) {
+        for (size_t i = 0; i < concurrency; ++i) {
+          threads_.push_back(std::thread(&batch_pool_t::worker, this));
+        }
+      }
+
+      /**
+       * \destructor
+       * \brief Will stop the running threads and await for
+       * them to have completed.
+       */
+      ~batch_pool_t() noexcept {
+        try {
+          stop().await();
+        } catch (std::system_error&) {}
+      }
+
+      /**
+       * \brief A thread pool object is non-copyable.
+       */
+      batch_pool_t(const batch_pool_t&) = delete;
+
+      /**
+       * \brief A thread pool object is non-copyable.
+       */
+      batch_pool_t& operator=(const batch_pool_t&) = delete;
+
+      /**
+       * \brief Enqueues an item, which is moved or copied into the queue.
+       * \return a true value if the item has been enqueued, false otherwise.
+       */
+      template <typename U>
+      bool schedule(const producer_token_t& token, U&& item) noexcept {
+        resource_scope_t resource(resource_.get());
+        return (items_.enqueue(token, std::forward<U>(item)));
+      }
+
+      /**
+       * \brief Enqueues an item, which is moved or copied into the queue.
+       * \return a true value if the item has been enqueued, false otherwise.
+       */
+      template <typename U>
+      bool schedule(U&& item) noexcept {
+        resource_scope_t resource(resource_.get());
+        return (items_.enqueue(std::forward<U>(item)));
+      }
+
+      /**
+       * \brief Enqueues an array of items, which are copied into the queue.
+       * \return a true value if the items have been enqueued, false otherwise.
+       */
+      bool schedule_bulk(const producer_token_t& token, const T array[], size_t size) noexcept {
+        resource_scope_t resource(resource_.get());
+        return (items_.enqueue_bulk(token, array, size));
+      }
+
+      /**
+       * \brief Enqueues an array of items, which are copied into the queue.
+       * \return a true value if the items have been enqueued, false otherwise.
+       */
+      bool schedule_bulk(const T array[], size_t size) noexcept {
+        resource_scope_t resource(resource_.get());
+        return (items_.enqueue_bulk(array, size));
+      }
+
+      /**
+       * \brief Enqueues the items in the range `[first, last)`, which are
+       * moved into the queue if the iterators yield rvalues, and are copied
+       * otherwise. The iterators must be forward iterators.
+       * \return a true value if the items have been enqueued, false otherwise.
+       */
+      template <typename It>
+      bool schedule_bulk(const producer_token_t& token, It first, It last) noexcept {
+        resource_scope_t resource(resource_.get());
+        return (items_.enqueue_bulk(token, first, static_cast<size_t>(std::distance(first, last))));
+      }
+
+      /**
+       * \brief Enqueues the items in the range `[first, last)`, which are
+       * moved into the queue if the iterators yield rvalues, and are copied
+       * otherwise. The iterators must be forward iterators.
+       * \return a true value if the items have been enqueued, false otherwise.
+       */
+      template <typename It>
+      bool schedule_bulk(It first, It last) noexcept {
+        resource_scope_t resource(resource_.get());
+        return (items_.enqueue_bulk(first, static_cast<size_t>(std::distance(first, last))));
+      }
+
+      /**
+       * \brief Blocks until every threads in the thread pool
+       * have been terminated.
+       */
+      batch_pool_t& await() {
+        for (std::thread& t : threads_) {
+          t.join();
+        }
+        return (*this);
+      }
+
+      /**
+       * \brief Stops the execution of the threads allocated by the thread
+       * pool, which hand the items they already dequeued to the handler,
+       * and exit within `DEQUEUE_TIMEOUT` milliseconds.
+       */
+      batch_pool_t& stop() noexcept {
+        done_.store(true);
+        return (*this);
+      }
+
+      /**
+       * \brief Creates a new producer token associated with
+       * the internal queue.
+       */
+      template <typename U>
+      typename std::enable_if<std::is_same<U, producer_token_t>::value, U>::type
+      create_token_of() {
+        resource_scope_t resource(resource_.get());
+        return (U(items_));
+      }
+
+      /**
+       * \return the approximate number of queued items.
+       */
+      size_t size_approx() const {
+        return (items_.size_approx());
+      }
+
+      /**
+       * \return a snapshot of the allocations made by the pool
+       * from its memory resource.
+       */
+      allocation_stats_t allocation_stats() const noexcept {
+        return (resource_->stats());
+      }
+
+      /**
+       * \return the handler the items are given to.
+       */
+      const Handler& handler() const noexcept {
+        return (handler_);
+      }
+
+      /**
+       * \return the options the pool has been created with, where
+       * `min_batch` is bounded by `max_batch`.
+       */
+      const batch_options_t& options() const noexcept {
+        return (options_);
+      }
+
+    private:
+
+      /**
+       * \brief The options the pool has been created with.
+       */
+      const batch_options_t options_;
+
+      /**
+       * \brief The handler the items are given to.
+       */
+      const Handler handler_;
+
+      /**
+       * \brief Worker threads vector container.
+       */
+      std::vector<std::thread> threads_;
+
+      /**
+       * \brief The resource the queue allocates its blocks from.
+       */
+      std::unique_ptr<counting_resource_t, counting_resource_t::releaser_t> resource_;
+
+      /**
+       * \brief The blocking queue holding the items.
+       */
+      queue_t items_;
+
+      /**
+       * \brief States whether the execution of worker threads
+       * should continue.
+       */
+      std::atomic<bool> done_;
+
+      /**
+       * \return the given options, where the batch sizes are
+       * bounded by one another.
+       */
+      static batch_options_t normalize(batch_options_t options) {
+        options.max_batch = options.max_batch > 0 ? options.max_batch : 1;
+        options.min_batch = options.min_batch < options.max_batch ? options.min_batch : options.max_batch;
+        return (options);
+      }
+
+      /**
+       * \brief Waits until `min_batch` items have been dequeued into
+       * `batch`, which already holds `count` items, or until the linger
+       * time has elapsed.
+       * \return the number of items held by `batch`.
+       */
+      size_t linger(typename queue_t::consumer_token_t& token, T* batch, size_t count) {
+        auto deadline = std::chrono::steady_clock::now() + options_.linger;
+        while (count < options_.min_batch && !done_.load(std::memory_order_relaxed)) {
+          auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+          if (remaining.count() <= 0) {
+            break;
+          }
+          count += items_.wait_dequeue_bulk_timed(token, batch + count, options_.max_batch - count, remaining.count());
+        }
+        return (count);
+      }
+
+      /**
+       * \brief Internal worker handing batches of items to the handler.
+       */
+      void worker() {
+        typename queue_t::consumer_token_t token(items_);
+        std::vector<T> batch(options_.max_batch);
+        while (!done_.load(std::memory_order_relaxed)) {
+          size_t count = items_.wait_dequeue_bulk_timed(token, batch.data(), options_.max_batch, DEQUEUE_TIMEOUT * 1000);
+          if (count == 0) {
+            continue;
+          }
+          if (count < options_.min_batch && options_.linger.count() > 0) {
+            count = linger(token, batch.data(), count);
+          }
+          handler_(batch.data(), count);
+        }
+      }
+    };
+  };
+};
+
+#endif // THREAD_POOL_BATCH_POOL_H_
@@ -0,0 +1,623 @@
+#ifndef THREAD_POOL_CORE_H_
+#define THREAD_POOL_CORE_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "thread_pool_memory.hpp"
+#include "thread_pool_slab.hpp"
+#include "thread_pool_huge_pages.hpp"
+#include "thread_pool_queue.hpp"
+#include "thread_pool_parking.hpp"
+#include "thread_pool_idle.hpp"
+#include "thread_pool_trim.hpp"
+#include "thread_pool_metrics.hpp"
+#include "thread_pool_trace.hpp"
+#include "thread_pool_label.hpp"
+#include "thread_pool_watchdog.hpp"
+#include "thread_pool_hooks.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \brief Type referring to a time value expressed in milliseconds.
+     */
+    using milliseconds_t = std::chrono::milliseconds::rep;
+
+    /**
+     * \struct pool_options_t
+     * \brief Runtime options of a thread pool, passed to its constructor.
+     */
+    struct pool_options_t {
+
+      /**
+       * \brief The capacity of the queue, which is a hint for unbounded
+       * queues and a hard limit for bounded ones. A zero capacity lets
+       * the queue pick its own default.
+       */
+      size_t capacity;
+
+      /**
+       * \brief Whether workers should release the memory kept by the
+       * queue after a burst, once they have been idle for a whole
+       * `DEQUEUE_TIMEOUT` and the queue holds no more than
+       * `trim_watermark` callables.
+       */
+      bool auto_trim;
+
+      /**
+       * \brief The queue depth at or below which an idle worker
+       * trims the queue when `auto_trim` is enabled.
+       */
+      size_t trim_watermark;
+
+      /**
+       * \brief The resource from which the blocks of the queue, the tasks
+       * which cannot be stored inline and the shared state of futures are
+       * allocated. It must outlive the pool and the futures it returns.
+       * A null resource stands for the global heap.
+       */
+      memory_resource_t* resource;
+
+      /**
+       * \brief Whether the callables which do not fit inline within a task
+       * should be allocated from per-thread slabs owned by the pool, rather
+       * than directly from `resource`. The slabs are allocated from the
+       * resource, and are only released when the pool is destroyed.
+       */
+      bool task_slabs;
+
+      /**
+       * \brief Whether the blocks of the queue and the task slabs should be
+       * allocated from regions backed by huge pages, which implies the use
+       * of task slabs. Smaller allocations, such as the shared state of
+       * futures, are still made from `resource`. The regions are only
+       * unmapped when the pool is destroyed, so that `trim()` hands the
+       * memory it releases back to the free lists of the regions, where
+       * the pool reuses it, rather than to the system.
+       */
+      bool huge_pages;
+
+      /**
+       * \brief The number of bytes backed by huge pages which are mapped
+       * and pre-faulted when the pool is created, if `huge_pages` is set.
+       */
+      size_t huge_pages_reserve;
+
+      /**
+       * \brief The number of events each thread keeps in its trace ring,
+       * beyond which the oldest events are overwritten. Tracing is only
+       * enabled when this number is not zero.
+       */
+      size_t trace_events;
+
+      /**
+       * \brief The period at which a watchdog thread samples the workers and
+       * the queue, looking for slow tasks and stalls. The watchdog is only
+       * started when this period is not zero.
+       */
+      std::chrono::milliseconds watchdog_period;
+
+      /**
+       * \brief The time beyond which a running task is reported as slow
+       * by the watchdog. A zero threshold disables the check.
+       */
+      std::chrono::milliseconds slow_task_threshold;
+
+      /**
+       * \brief The time beyond which the pool is reported as stalled by the
+       * watchdog, when every worker has been running the same task for that
+       * long while tasks are queued. A zero threshold disables the check.
+       */
+      std::chrono::milliseconds stall_threshold;
+
+      /**
+       * \brief The callback the watchdog reports problems to, from its own
+       * thread. A null callback logs them to the standard error.
+       */
+      watchdog_callback_t watchdog;
+
+      /**
+       * \constructor
+       * \brief Options can be implicitly created from a queue capacity.
+       */
+      pool_options_t(size_t capacity = 0)
+        : capacity(capacity),
+          auto_trim(false),
+          trim_watermark(0),
+          resource(nullptr),
+          task_slabs(false),
+          huge_pages(false),
+          huge_pages_reserve(8 * huge_page_resource_t::HUGE_PAGE_SIZE),
+          trace_events(0),
+          watchdog_period(0),
+          slow_task_threshold(1000),
+          stall_threshold(1000) {}
+    };
+
+    /**
+     * \return the resource of a pool created with the given options,
+     * which keeps track of the allocations made by the pool.
+     */
+    inline counting_resource_t* make_pool_resource(const pool_options_t& options) {
+      memory_resource_t* upstream = options.resource != nullptr ? options.resource : new_delete_resource();
+      if (options.huge_pages) {
+        // The regions live as long as the futures allocated from them.
+        return (new counting_resource_t(std::unique_ptr<memory_resource_t>(
+          new huge_page_resource_t(options.huge_pages_reserve, 16 * huge_page_resource_t::HUGE_PAGE_SIZE, upstream)
+        )));
+      }
+      return (new counting_resource_t(upstream));
+    }
+
+    /**
+     * Invoke steps
+     * ------------
+     *
+     * The way the workers of a `pool_core_t` run the elements they dequeue
+     * is given as an `Invoke` step, which must provide the following :
+     *
+     *  - `uint64_t run(Metrics& metrics, size_t worker, Element& element,
+     *    uint64_t start)` - Runs an element through `metrics.run()`, and
+     *    returns the time at which it ended.
+     *  - `uint16_t label(const Element& element)` - The label of an element,
+     *    or zero, reported to the watchdog and recorded in traces.
+     */
+
+    /**
+     * \class pool_core_t
+     * \brief The workers of a thread pool, along with the queue they dequeue
+     * `Element` values from, and everything they share regardless of what
+     * the elements are : their parking and wakeup, the idle policy, the
+     * trimming and reservation of the queue, the pre-faulting of their
+     * stack, the metrics, the hooks, the tracer and the watchdog. The
+     * workers hand every dequeued element to the `Invoke` step.
+     *
+     * The pools derive from the core, and implement the scheduling of their
+     * own kind of elements on top of its queue and of `wake()`. The workers
+     * are started by the constructor of the core, and stopped and joined by
+     * its destructor, so that they never use the members of a pool which
+     * has not been constructed yet or which has already been destroyed.
+     */
+    template <
+      typename Element,
+      typename Invoke,
+      size_t BULK_MAX_ITEMS,
+      milliseconds_t DEQUEUE_TIMEOUT,
+      typename IdlePolicy,
+      template <typename> class Queue,
+      typename Metrics,
+      typename Hooks
+    >
+    class pool_core_t {
+    public:
+
+      /**
+       * \brief The type of the queue used to dispatch work to the workers.
+       */
+      using queue_t = Queue<Element>;
+
+      /**
+       * \brief The producer token type associated with the queue.
+       */
+      using producer_token_t = typename queue_t::producer_token_t;
+
+      /**
+       * \brief The consumer token type associated with the queue.
+       */
+      using consumer_token_t = typename queue_t::consumer_token_t;
+
+      /**
+       * \brief A core is non-copyable.
+       */
+      pool_core_t(const pool_core_t&) = delete;
+
+      /**
+       * \brief A core is non-copyable.
+       */
+      pool_core_t& operator=(const pool_core_t&) = delete;
+
+      /**
+       * \brief Releases the memory the queue keeps around after a burst
+       * of callables back to the allocator. Unless `auto_trim` is enabled,
+       * this must not be called while other threads are scheduling
+       * callables on the pool. When `auto_trim` is enabled, this method
+       * does nothing if callables are being scheduled concurrently.
+       * \return the number of bytes which have been released.
+       */
+      size_t trim() {
+        // Shrinking the block indexes of the queue allocates a smaller one.
+        resource_scope_t resource(resource_.get());
+        if (!gate_.enabled()) {
+          return (trim_queue(tasks_, 0));
+        }
+        return (gate_.try_trim([this] () { return (trim_queue(tasks_, 0)); }));
+      }
+
+      /**
+       * \brief Creates a new producer token associated with
+       * the internal queue.
+       */
+      template <typename T>
+      typename std::enable_if<
+        std::is_same<T, producer_token_t>::value || std::is_same<T, consumer_token_t>::value, T
+      >::type
+      create_token_of() {
+        resource_scope_t resource(resource_.get());
+        return (T(tasks_));
+      }
+
+      /**
+       * \return a snapshot of the allocations made by the pool from its
+       * memory resource, including the queue, the tasks and the shared
+       * state of the futures it returned.
+       */
+      allocation_stats_t allocation_stats() const noexcept {
+        return (resource_->stats());
+      }
+
+      /**
+       * \return a snapshot of the metrics collected by the pool, aggregated
+       * across its workers. Unless the pool collects metrics through its
+       * `Metrics` policy, only the queue depth is filled.
+       */
+      metrics_snapshot_t snapshot() const {
+        metrics_snapshot_t snapshot;
+        snapshot.queue_depth = tasks_.size_approx();
+        metrics_.snapshot(snapshot);
+        return (snapshot);
+      }
+
+      /**
+       * \return the hooks run by the workers around their tasks.
+       */
+      Hooks& hooks() noexcept {
+        return (hooks_);
+      }
+
+      /**
+       * \return the events currently held by the trace rings
+       * of the pool, which is empty unless tracing is enabled.
+       */
+      std::vector<trace_event_t> trace() const {
+        return (tracer_ ? tracer_->events() : std::vector<trace_event_t>());
+      }
+
+      /**
+       * \brief Writes the events currently held by the trace rings of the
+       * pool as a Chrome Trace Event JSON document, which can be opened
+       * with `chrome://tracing` or the Perfetto UI.
+       * \return false if tracing is not enabled.
+       */
+      bool write_trace(std::ostream& stream) const {
+        if (!tracer_) {
+          return (false);
+        }
+        tracer_->write_chrome_trace(stream);
+        return (true);
+      }
+
+      /**
+       * \brief The number of bytes of their stack workers
+       * pre-fault once `.reserve()` has been called.
+       */
+      static const size_t STACK_RESERVE = 256 * 1024;
+
+    protected:
+
+      /**
+       * \constructor
+       * \brief Creates the queue and starts `concurrency` workers, which
+       * run the elements through `invoke` and `hooks`. Slabs serving the
+       * tasks which do not fit inline are only created if `slabs` is set.
+       * \throw std::invalid_argument if the queue backend supports a single
+       * consumer and `concurrency` is not 1.
+       */
+      pool_core_t(size_t concurrency, const pool_options_t& options, bool slabs, const Invoke& invoke, const Hooks& hooks)
+        : options_(options),
+          parkers_(new parker_t[check_concurrency<queue_t>(concurrency)]),
+          resource_(make_pool_resource(options)),
+          slabs_(slabs ? new slab_resource_t(resource_.get()) : nullptr),
+          // The queue allocates its initial storage from the pool resource.
+          tasks_((resource_scope_t(resource_.get()), options.capacity)),
+          gate_(options.auto_trim),
+          done_(false),
+          stack_reserve_(0),
+          metrics_(concurrency),
+          hooks_(hooks),
+          invoke_(invoke),
+          tracer_(options.trace_events > 0 ? new tracer_t(options.trace_events) : nullptr),
+          watchdog_(options.watchdog_period.count() > 0 ? make_watchdog(concurrency, options) : nullptr) {
+        for (size_t i = 0; i < concurrency; ++i) {
+          threads_.push_back(std::thread(&pool_core_t::worker, this, std::ref(parkers_[i])));
+        }
+      }
+
+      /**
+       * \destructor
+       * \brief Will stop the running threads and await for
+       * them to have completed. The destructor will catch
+       * potential exceptions arising from the fact that
+       * internal threads may have already been terminated.
+       */
+      ~pool_core_t() noexcept {
+        try {
+          halt();
+          join();
+        } catch (std::system_error&) {}
+      }
+
+      /**
+       * \brief Blocks until every worker has been terminated.
+       */
+      void join() {
+        for (std::thread& t : threads_) {
+          t.join();
+        }
+      }
+
+      /**
+       * \brief Asks the workers to stop.
+       */
+      void halt() noexcept {
+        done_.store(true);
+        idle_.notify_all();
+      }
+
+      /**
+       * \brief Pre-allocates the blocks of the queue and the state of its
+       * producers needed to hold `elements` elements enqueued by `producers`
+       * threads without a token, and has the workers pre-fault
+       * `STACK_RESERVE` bytes of their stack the next time they are idle.
+       * \return false if the memory could not be allocated.
+       */
+      bool reserve_elements(size_t elements, size_t producers) {
+        bool reserved = true;
+        {
+          trim_gate_t::scope_t scope(gate_);
+          resource_scope_t resource(resource_.get());
+          reserved = reserve_queue(tasks_, elements, producers, 0);
+        }
+        stack_reserve_.store(STACK_RESERVE, std::memory_order_relaxed);
+        idle_.notify_all();
+        return (reserved);
+      }
+
+      /**
+       * \brief Wakes just enough parked workers to dequeue `count`
+       * newly enqueued elements, given that each worker dequeues
+       * up to `BULK_MAX_ITEMS` elements at once.
+       */
+      bool wake(size_t count) noexcept {
+        metrics_.on_enqueue(count);
+        if (tracer_) {
+          tracer_->record(trace_event_type_t::ENQUEUE, static_cast<uint32_t>(count));
+        }
+        idle_.notify((count + BULK_MAX_ITEMS - 1) / BULK_MAX_ITEMS);
+        return (true);
+      }
+
+      /**
+       * \brief The options the pool has been created with.
+       */
+      const pool_options_t options_;
+
+      /**
+       * \brief Worker threads vector container.
+       */
+      std::vector<std::thread> threads_;
+
+      /**
+       * \brief Parking slots of the worker threads, one per worker.
+       */
+      std::unique_ptr<parker_t[]> parkers_;
+
+      /**
+       * \brief Stack of the workers which are currently parked.
+       */
+      idle_stack_t idle_;
+
+      /**
+       * \brief The resource used by the pool, counting the allocations
+       * made from the resource given in the options. It is released
+       * after the queue, and lives on until the last future has
+       * released its shared state.
+       */
+      std::unique_ptr<counting_resource_t, counting_resource_t::releaser_t> resource_;
+
+      /**
+       * \brief The slabs tasks are allocated from, if enabled.
+       */
+      std::unique_ptr<slab_resource_t> slabs_;
+
+      /**
+       * \brief Concurrent queue used to store and dispatch work
+       * amonst worker threads.
+       */
+      queue_t tasks_;
+
+      /**
+       * \brief Keeps producers out while the queue is being trimmed.
+       */
+      trim_gate_t gate_;
+
+      /**
+       * \brief States whether the execution of worker threads
+       * should continue.
+       */
+      std::atomic<bool> done_;
+
+      /**
+       * \brief The number of bytes of their stack workers should pre-fault.
+       */
+      std::atomic<size_t> stack_reserve_;
+
+      /**
+       * \brief The metrics collected by the pool.
+       */
+      Metrics metrics_;
+
+      /**
+       * \brief The hooks run by the workers around their tasks.
+       */
+      Hooks hooks_;
+
+      /**
+       * \brief The step running the dequeued elements.
+       */
+      const Invoke invoke_;
+
+      /**
+       * \brief The tracer recording the timeline of the pool, if enabled.
+       */
+      std::unique_ptr<tracer_t> tracer_;
+
+      /**
+       * \brief The watchdog sampling the workers, if enabled, which is
+       * destroyed first since it samples the queue.
+       */
+      std::unique_ptr<watchdog_t> watchdog_;
+
+    private:
+
+      /**
+       * \return a watchdog sampling the workers and the queue.
+       */
+      watchdog_t* make_watchdog(size_t concurrency, const pool_options_t& options) {
+        return (new watchdog_t(concurrency, options.watchdog_period, options.slow_task_threshold,
+          options.stall_threshold, options.watchdog, [this] () { return (tasks_.size_approx()); }));
+      }
+
+      /**
+       * \brief Touches `bytes` bytes of the stack of the calling thread,
+       * one page at a time, so that tasks do not fault on it later on.
+       */
+      static void prefault_stack(size_t bytes) {
+        volatile char page[4096];
+        page[0] = 0;
+        if (bytes > sizeof(page)) {
+          prefault_stack(bytes - sizeof(page));
+        }
+        // Writing after the call keeps it from being turned into a jump.
+        page[sizeof(page) - 1] = 0;
+      }
+
+      /**
+       * \brief Called by a worker which found the queue empty. The worker
+       * polls the queue as dictated by the `IdlePolicy`, and then registers
+       * itself on the idle stack and parks on its own word until a producer
+       * wakes it up, or until `DEQUEUE_TIMEOUT` has elapsed.
+       */
+      void idle(parker_t& parker) {
+        auto ready = [this] () {
+          return (tasks_.size_approx() > 0 || done_.load(std::memory_order_relaxed));
+        };
+        size_t worker = &parker - parkers_.get();
+        uint64_t begin = metrics_.now();
+        bool woken = IdlePolicy::wait(ready);
+        uint64_t parked = metrics_.now();
+        metrics_.on_idle(worker, begin, parked);
+        if (woken) {
+          return;
+        }
+        // Handing the tasks released by this worker back to their
+        // producers before going to sleep.
+        if (slabs_) {
+          slabs_->flush();
+        }
+        idle_.push(parker);
+        // Checking the queue once more after having been registered, since a
+        // producer may have enqueued work before it could see this worker.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool notified = ready() || parker.park_for(std::chrono::milliseconds(DEQUEUE_TIMEOUT));
+        idle_.remove(parker);
+        metrics_.on_parked(worker, parked, metrics_.now());
+        // A worker which has not been woken up for a whole timeout
+        // releases the memory kept by the queue since the last burst.
+        if (!notified && options_.auto_trim && tasks_.size_approx() <= options_.trim_watermark) {
+          trim();
+        }
+      }
+
+      /**
+       * \brief Internal worker handing the dequeued elements
+       * to the invoke step.
+       */
+      void worker(parker_t& parker) {
+        consumer_token_t token(tasks_);
+        size_t index = &parker - parkers_.get();
+        trace_ring_t* ring = tracer_ ? &tracer_->worker_ring(index) : nullptr;
+        heartbeat_t* beat = watchdog_ ? &watchdog_->heartbeat(index) : nullptr;
+        size_t stack = 0;
+        hooks_.on_worker_start(index);
+        while (!done_) {
+          Element runnable[BULK_MAX_ITEMS];
+          auto available = tasks_.try_dequeue_bulk(token, runnable, BULK_MAX_ITEMS);
+          if (available == 0) {
+            if (stack < stack_reserve_.load(std::memory_order_relaxed)) {
+              stack = stack_reserve_.load(std::memory_order_relaxed);
+              prefault_stack(stack);
+            }
+            hooks_.on_idle(index);
+            idle(parker);
+            continue;
+          }
+          metrics_.on_dequeue(index, available);
+          if (ring != nullptr) {
+            run_traced(*ring, beat, index, runnable, available);
+            continue;
+          }
+          // Each task starts when the previous one ended.
+          uint64_t time = metrics_.now();
+          for (size_t i = 0; i < available; ++i) {
+            hooks_.before_task(index, runnable[i]);
+            if (beat != nullptr) {
+              beat->start(invoke_.label(runnable[i]));
+            }
+            time = invoke_.run(metrics_, index, runnable[i], time);
+            if (beat != nullptr) {
+              beat->end();
+            }
+            hooks_.after_task(index, runnable[i]);
+          }
+        }
+        hooks_.on_worker_stop(index);
+      }
+
+      /**
+       * \brief Runs the dequeued elements while recording
+       * their timeline on the ring of the worker.
+       */
+      void run_traced(trace_ring_t& ring, heartbeat_t* beat, size_t index, Element* runnable, size_t available) {
+        uint64_t trace = tracer_->now();
+        ring.record(trace, trace_event_type_t::DEQUEUE, static_cast<uint32_t>(available));
+        uint64_t time = metrics_.now();
+        for (size_t i = 0; i < available; ++i) {
+          uint16_t label = invoke_.label(runnable[i]);
+          ring.record(trace, trace_event_type_t::START, 0, label != 0 ? label_registry_t::instance().name(label) : nullptr);
+          hooks_.before_task(index, runnable[i]);
+          if (beat != nullptr) {
+            beat->start(label);
+          }
+          time = invoke_.run(metrics_, index, runnable[i], time);
+          if (beat != nullptr) {
+            beat->end();
+          }
+          hooks_.after_task(index, runnable[i]);
+          trace = tracer_->now();
+          ring.record(trace, trace_event_type_t::END, 0);
+        }
+      }
+    };
+  };
+};
+
+#endif // THREAD_POOL_CORE_H_
@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_HOOKS_H_
+#define THREAD_POOL_HOOKS_H_
+
+#include <cstddef>
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * Hook policies
+     * -------------
+     *
+     * The code run by the workers of a `parameterized_pool_t` around their
+     * tasks is given as a `Hooks` policy. The pool holds an instance of it,
+     * which is called from every worker at once, and must provide the
+     * following, none of which may throw :
+     *
+     *  - `void on_worker_start(size_t worker)` - Called by each worker once
+     *    it started, before it runs any task, so that it can set up its
+     *    thread-local state.
+     *  - `void on_worker_stop(size_t worker)` - Called by each worker right
+     *    before it exits, so that it can tear its thread-local state down.
+     *  - `void before_task(size_t worker, const Task& task)` and
+     *    `void after_task(size_t worker, const Task& task)` - Called around
+     *    each task run by a worker. The label of the task is given by
+     *    `task.label()`.
+     *  - `void on_idle(size_t worker)` - Called by a worker which found the
+     *    queue empty, before it polls the queue and parks.
+     *
+     * Hooks are resolved at compile time, and the empty functions of the
+     * default policy are inlined away, so that workers run exactly the
+     * same loop as without hooks.
+     */
+
+    /**
+     * \struct no_hooks_t
+     * \brief The default hook policy, which does nothing.
+     */
+    struct no_hooks_t {
+
+      static void on_worker_start(size_t) noexcept {}
+
+      static void on_worker_stop(size_t) noexcept {}
+
+      template <typename Task>
+      static void before_task(size_t, const Task&) noexcept {}
+
+      template <typename Task>
+      static void after_task(size_t, const Task&) noexcept {}
+
+      static void on_idle(size_t) noexcept {}
+    };
+  };
+};
+
+#endif // THREAD_POOL_HOOKS_H_
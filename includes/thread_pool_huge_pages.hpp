@@ -0,0 +1,421 @@
+#ifndef THREAD_POOL_HUGE_PAGES_H_
+#define THREAD_POOL_HUGE_PAGES_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "thread_pool_memory.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \class huge_page_resource_t
+     * \brief A resource carving large allocations, such as the blocks of a
+     * queue or the chunks of task slabs, out of regions backed by 2 MB huge
+     * pages, which lowers the number of TLB misses when walking through
+     * millions of queued tasks.
+     *
+     * On Linux, regions are first requested as explicit huge pages using
+     * `MAP_HUGETLB`, which requires huge pages to have been reserved by the
+     * system. When none are available, regions are aligned on 2 MB and
+     * marked with `MADV_HUGEPAGE` so that transparent huge pages back them.
+     * Regions are pre-faulted when they are mapped so that no page fault
+     * happens later on, and are only unmapped when the resource is destroyed.
+     * On other platforms, regions are allocated from the upstream resource.
+     *
+     * Allocations smaller than `min_size`, such as the shared state of
+     * futures, are forwarded to the upstream resource. Released memory is
+     * kept on free lists and reused by allocations of the same size, and is
+     * never given back to the system before the resource is destroyed. The
+     * free lists of the first `SIZE_CLASSES` sizes are lock-free stacks
+     * linked through the released blocks themselves, so that neither
+     * releasing nor reusing a block takes a lock or allocates memory. The
+     * lock is only taken to carve new blocks out of the current region, and
+     * to reuse blocks of the sizes beyond these classes.
+     */
+    class huge_page_resource_t : public memory_resource_t {
+
+      /**
+       * \brief A region of memory.
+       */
+      struct region_t {
+        char* base;
+        size_t size;
+        bool mapped;
+      };
+
+      /**
+       * \brief The link stored within a released block.
+       */
+      struct free_block_t {
+        std::atomic<uint64_t> next;
+        free_block_t* overflow;
+        size_t size;
+      };
+
+      /**
+       * \brief The free list of a size, whose head packs the address of
+       * the first block divided by `CACHE_LINE_SIZE` in its `LINK_BITS`
+       * lower bits, and a tag bumped by every update in its upper bits,
+       * so that a stale head cannot be swapped back in.
+       */
+      struct size_class_t {
+        std::atomic<size_t> size;
+        std::atomic<uint64_t> head;
+      };
+
+      /**
+       * \brief The number of bits of the head of a free list
+       * holding the address of a block, which covers 48-bit
+       * addresses once divided by `CACHE_LINE_SIZE`.
+       */
+      static const unsigned LINK_BITS = 42;
+      static const uint64_t LINK_MASK = (uint64_t(1) << LINK_BITS) - 1;
+      static const uint64_t TAG_ONE = uint64_t(1) << LINK_BITS;
+
+    public:
+
+      /**
+       * \brief The size of a huge page.
+       */
+      static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+      /**
+       * \brief The alignment of the allocations made from regions.
+       */
+      static const size_t CACHE_LINE_SIZE = 64;
+
+      static_assert(sizeof(free_block_t) <= CACHE_LINE_SIZE, "released blocks must hold their link");
+
+      /**
+       * \brief The size of the allocations forwarded to the
+       * upstream resource when none is provided.
+       */
+      static const size_t DEFAULT_MIN_SIZE = 1024;
+
+      /**
+       * \brief The number of sizes whose free lists are lock-free.
+       */
+      static const size_t SIZE_CLASSES = 64;
+
+      /**
+       * \constructor
+       * \brief Maps and pre-faults a first region of at least `reserve`
+       * bytes, and then maps regions of at least `region_size` bytes
+       * when the current one is exhausted.
+       */
+      explicit huge_page_resource_t(
+        size_t reserve,
+        size_t region_size = 16 * HUGE_PAGE_SIZE,
+        memory_resource_t* upstream = new_delete_resource(),
+        size_t min_size = DEFAULT_MIN_SIZE)
+        : upstream_(upstream),
+          region_size_(round_up(region_size > 0 ? region_size : size_t(HUGE_PAGE_SIZE), HUGE_PAGE_SIZE)),
+          min_size_(min_size),
+          cursor_(nullptr),
+          end_(nullptr),
+          overflow_(nullptr),
+          explicit_pages_(0) {
+        for (size_class_t& size_class : classes_) {
+          size_class.size.store(0, std::memory_order_relaxed);
+          size_class.head.store(0, std::memory_order_relaxed);
+        }
+        if (reserve > 0) {
+          grow(reserve);
+        }
+      }
+
+      /**
+       * \destructor
+       * \brief Unmaps every region.
+       */
+      ~huge_page_resource_t() {
+        for (const region_t& region : regions_) {
+          unmap(region);
+        }
+      }
+
+      /**
+       * \brief A resource is non-copyable.
+       */
+      huge_page_resource_t(const huge_page_resource_t&) = delete;
+
+      /**
+       * \brief A resource is non-copyable.
+       */
+      huge_page_resource_t& operator=(const huge_page_resource_t&) = delete;
+
+      /**
+       * \return the number of bytes of the regions which are
+       * backed by explicit huge pages.
+       */
+      size_t explicit_huge_pages() const {
+        std::lock_guard<std::mutex> lock(lock_);
+        return (explicit_pages_);
+      }
+
+      /**
+       * \return the number of bytes of all regions.
+       */
+      size_t reserved() const {
+        std::lock_guard<std::mutex> lock(lock_);
+        size_t size = 0;
+        for (const region_t& region : regions_) {
+          size += region.size;
+        }
+        return (size);
+      }
+
+    protected:
+
+      void* do_allocate(size_t bytes, size_t alignment) override {
+        if (bytes < min_size_ || alignment > CACHE_LINE_SIZE) {
+          return (upstream_->allocate(bytes, alignment));
+        }
+        bytes = round_up(bytes > 0 ? bytes : 1, CACHE_LINE_SIZE);
+        size_class_t* size_class = find(bytes, false);
+        if (size_class != nullptr) {
+          void* ptr = pop(*size_class);
+          if (ptr != nullptr) {
+            return (ptr);
+          }
+        }
+        std::lock_guard<std::mutex> lock(lock_);
+        for (free_block_t** it = &overflow_; *it != nullptr; it = &(*it)->overflow) {
+          if ((*it)->size == bytes) {
+            free_block_t* block = *it;
+            *it = block->overflow;
+            return (block);
+          }
+        }
+        if (cursor_ == nullptr || static_cast<size_t>(end_ - cursor_) < bytes) {
+          grow(bytes);
+        }
+        void* ptr = cursor_;
+        cursor_ += bytes;
+        return (ptr);
+      }
+
+      void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (bytes < min_size_ || alignment > CACHE_LINE_SIZE) {
+          upstream_->deallocate(ptr, bytes, alignment);
+          return;
+        }
+        bytes = round_up(bytes > 0 ? bytes : 1, CACHE_LINE_SIZE);
+        free_block_t* block = new (ptr) free_block_t;
+        block->size = bytes;
+        size_class_t* size_class = find(bytes, true);
+        if (size_class != nullptr) {
+          push(*size_class, block);
+          return;
+        }
+        std::lock_guard<std::mutex> lock(lock_);
+        block->overflow = overflow_;
+        overflow_ = block;
+      }
+
+      bool do_is_equal(const memory_resource_t& other) const noexcept override {
+        return (this == &other);
+      }
+
+    private:
+
+      static size_t round_up(size_t value, size_t multiple) {
+        return ((value + multiple - 1) / multiple * multiple);
+      }
+
+      /**
+       * \return the class of `bytes`, which is claimed if none is found
+       * and `claim` is set, or `nullptr` if there is no such class.
+       * Classes are never released, so that the probing can stop at the
+       * first unclaimed class.
+       */
+      size_class_t* find(size_t bytes, bool claim) noexcept {
+        size_t start = bytes / CACHE_LINE_SIZE;
+        for (size_t i = 0; i < SIZE_CLASSES; ++i) {
+          size_class_t& size_class = classes_[(start + i) % SIZE_CLASSES];
+          size_t size = size_class.size.load(std::memory_order_acquire);
+          if (size == 0) {
+            if (!claim) {
+              return (nullptr);
+            }
+            if (size_class.size.compare_exchange_strong(size, bytes, std::memory_order_acq_rel)) {
+              return (&size_class);
+            }
+          }
+          if (size == bytes) {
+            return (&size_class);
+          }
+        }
+        return (nullptr);
+      }
+
+      /**
+       * \brief Pushes a released block on the free list of its class.
+       */
+      static void push(size_class_t& size_class, free_block_t* block) noexcept {
+        uint64_t link = reinterpret_cast<uintptr_t>(block) / CACHE_LINE_SIZE;
+        uint64_t head = size_class.head.load(std::memory_order_relaxed);
+        do {
+          block->next.store(head & LINK_MASK, std::memory_order_relaxed);
+        } while (!size_class.head.compare_exchange_weak(head, link | ((head + TAG_ONE) & ~LINK_MASK),
+          std::memory_order_release, std::memory_order_relaxed));
+      }
+
+      /**
+       * \brief Pops a block from the free list of a class. The link of a
+       * block popped by another thread meanwhile may be read, which is
+       * harmless since regions stay mapped, and the tag of the head then
+       * makes the exchange fail.
+       * \return `nullptr` if the free list is empty.
+       */
+      static void* pop(size_class_t& size_class) noexcept {
+        uint64_t head = size_class.head.load(std::memory_order_acquire);
+        while ((head & LINK_MASK) != 0) {
+          free_block_t* block = reinterpret_cast<free_block_t*>(uintptr_t((head & LINK_MASK) * CACHE_LINE_SIZE));
+          uint64_t next = block->next.load(std::memory_order_relaxed);
+          if (size_class.head.compare_exchange_weak(head, next | ((head + TAG_ONE) & ~LINK_MASK),
+            std::memory_order_acquire, std::memory_order_acquire)) {
+            return (block);
+          }
+        }
+        return (nullptr);
+      }
+
+      /**
+       * \brief Maps a new region able to hold `bytes` bytes, and makes it
+       * the current one, which must be called with the lock held.
+       */
+      void grow(size_t bytes) {
+        size_t size = round_up(bytes > region_size_ ? bytes : region_size_, HUGE_PAGE_SIZE);
+        regions_.reserve(regions_.size() + 1);
+        region_t region = map(size);
+        regions_.push_back(region);
+        cursor_ = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(region.base), CACHE_LINE_SIZE));
+        end_ = region.base + region.size;
+      }
+
+      /**
+       * \brief Maps and pre-faults a region of `size` bytes.
+       */
+      region_t map(size_t size) {
+#if defined(__linux__)
+#if defined(MAP_HUGETLB)
+        void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (ptr != MAP_FAILED) {
+          explicit_pages_ += size;
+          return (region_t{ static_cast<char*>(ptr), size, true });
+        }
+#endif
+        // Over-allocating to align the region on a huge page,
+        // and giving the unaligned head and tail back.
+        void* raw = ::mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+          throw std::bad_alloc();
+        }
+        char* base = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(raw), HUGE_PAGE_SIZE));
+        size_t head = base - static_cast<char*>(raw);
+        if (head > 0) {
+          ::munmap(raw, head);
+        }
+        ::munmap(base + size, HUGE_PAGE_SIZE - head);
+#if defined(MADV_HUGEPAGE)
+        ::madvise(base, size, MADV_HUGEPAGE);
+#endif
+        prefault(base, size);
+        return (region_t{ base, size, true });
+#else
+        // Leaving room to align the blocks on a cache line.
+        size += CACHE_LINE_SIZE;
+        char* base = static_cast<char*>(upstream_->allocate(size));
+        prefault(base, size);
+        return (region_t{ base, size, false });
+#endif
+      }
+
+      /**
+       * \brief Releases a region.
+       */
+      void unmap(const region_t& region) {
+#if defined(__linux__)
+        if (region.mapped) {
+          ::munmap(region.base, region.size);
+          return;
+        }
+#endif
+        upstream_->deallocate(region.base, region.size);
+      }
+
+      /**
+       * \brief Touches every page of a region, so that they are backed by
+       * memory right away, even if huge pages could not be obtained.
+       */
+      static void prefault(char* base, size_t size) {
+        for (size_t offset = 0; offset < size; offset += 4096) {
+          static_cast<volatile char*>(base)[offset] = 0;
+        }
+      }
+
+      /**
+       * \brief The resource small allocations are forwarded to.
+       */
+      memory_resource_t* upstream_;
+
+      /**
+       * \brief The minimum size of the regions.
+       */
+      const size_t region_size_;
+
+      /**
+       * \brief The size under which allocations are forwarded upstream.
+       */
+      const size_t min_size_;
+
+      /**
+       * \brief Lock guarding the regions, the current
+       * region and the overflow list.
+       */
+      mutable std::mutex lock_;
+
+      /**
+       * \brief Every region of the resource.
+       */
+      std::vector<region_t> regions_;
+
+      /**
+       * \brief The lock-free free lists, by size.
+       */
+      size_class_t classes_[SIZE_CLASSES];
+
+      /**
+       * \brief The unused part of the current region.
+       */
+      char* cursor_;
+      char* end_;
+
+      /**
+       * \brief Released blocks whose size has no class.
+       */
+      free_block_t* overflow_;
+
+      /**
+       * \brief The number of bytes backed by explicit huge pages.
+       */
+      size_t explicit_pages_;
+    };
+  };
+};
+
+#endif // THREAD_POOL_HUGE_PAGES_H_
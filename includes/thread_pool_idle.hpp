@@ -0,0 +1,138 @@
+#ifndef THREAD_POOL_IDLE_H_
+#define THREAD_POOL_IDLE_H_
+
+#include <chrono>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \brief Type referring to a time value expressed in microseconds.
+     */
+    using microseconds_t = std::chrono::microseconds::rep;
+
+    /**
+     * \brief Hints the processor that the calling thread is
+     * busy-waiting, which lowers the power consumption of the
+     * spin loop and frees resources for a sibling hyper-thread.
+     */
+    inline void cpu_relax() noexcept {
+#if defined(__i386__) || defined(__x86_64__)
+      __builtin_ia32_pause();
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+      _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+      __asm__ __volatile__("yield");
+#endif
+    }
+
+    /**
+     * \brief Spins on `ready` with an exponential backoff between two
+     * checks until it returns true or until `duration` has elapsed.
+     * \return whether `ready` returned true.
+     */
+    template <typename Predicate>
+    bool spin_for(Predicate& ready, std::chrono::microseconds duration) {
+      auto deadline = std::chrono::steady_clock::now() + duration;
+      unsigned backoff = 1;
+      do {
+        for (unsigned i = 0; i < backoff; ++i) {
+          cpu_relax();
+        }
+        if (ready()) {
+          return (true);
+        }
+        if (backoff < 64) {
+          backoff <<= 1;
+        }
+      } while (std::chrono::steady_clock::now() < deadline);
+      return (false);
+    }
+
+    /**
+     * \brief Yields the processor between two checks of `ready` until
+     * it returns true or until `duration` has elapsed.
+     * \return whether `ready` returned true.
+     */
+    template <typename Predicate>
+    bool yield_for(Predicate& ready, std::chrono::microseconds duration) {
+      auto deadline = std::chrono::steady_clock::now() + duration;
+      do {
+        std::this_thread::yield();
+        if (ready()) {
+          return (true);
+        }
+      } while (std::chrono::steady_clock::now() < deadline);
+      return (false);
+    }
+
+    /**
+     * \struct spin_yield_park_t
+     * \brief Idle policy under which a worker which found the queue
+     * empty busy-polls it for `SPIN_US` microseconds, then yields
+     * the processor between two polls for `YIELD_US` microseconds,
+     * and finally parks until a producer wakes it up.
+     */
+    template <
+      microseconds_t SPIN_US = 20,
+      microseconds_t YIELD_US = 20
+    >
+    struct spin_yield_park_t {
+
+      /**
+       * \brief Polls `ready` before the worker parks.
+       * \return true if `ready` returned true, false if the
+       * worker should park.
+       */
+      template <typename Predicate>
+      static bool wait(Predicate& ready) {
+        return ((SPIN_US > 0 && spin_for(ready, std::chrono::microseconds(SPIN_US)))
+          || (YIELD_US > 0 && yield_for(ready, std::chrono::microseconds(YIELD_US))));
+      }
+    };
+
+    /**
+     * \struct busy_poll_t
+     * \brief Idle policy under which workers never park and keep
+     * polling the queue, with a bounded backoff between two polls.
+     * This provides the lowest wakeup latency at the expense of
+     * keeping every worker on a processor.
+     */
+    struct busy_poll_t {
+
+      /**
+       * \brief Polls `ready` until it returns true.
+       */
+      template <typename Predicate>
+      static bool wait(Predicate& ready) {
+        while (!spin_for(ready, std::chrono::microseconds(1000))) {}
+        return (true);
+      }
+    };
+
+    /**
+     * \struct park_immediately_t
+     * \brief Idle policy under which workers park as soon as they find
+     * the queue empty, which saves processor time on pools where
+     * wakeup latency does not matter.
+     */
+    struct park_immediately_t {
+
+      /**
+       * \brief Does not poll `ready`, the worker parks right away.
+       */
+      template <typename Predicate>
+      static bool wait(Predicate&) {
+        return (false);
+      }
+    };
+  };
+};
+
+#endif // THREAD_POOL_IDLE_H_
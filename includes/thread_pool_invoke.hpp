@@ -0,0 +1,173 @@
+#ifndef THREAD_POOL_INVOKE_H_
+#define THREAD_POOL_INVOKE_H_
+
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \brief Invokes a callable object, a pointer to function
+     * or a reference to function with the given arguments.
+     */
+    template <typename F, typename... Args>
+    auto invoke(F&& f, Args&&... args)
+      -> decltype(std::forward<F>(f)(std::forward<Args>(args)...)) {
+      return (std::forward<F>(f)(std::forward<Args>(args)...));
+    }
+
+    /**
+     * \brief Invokes a pointer to member function on an object,
+     * or on a reference to an object.
+     */
+    template <typename M, typename C, typename T, typename... Args, typename = typename std::enable_if<std::is_function<M>::value>::type>
+    auto invoke(M C::* f, T&& object, Args&&... args)
+      -> decltype((std::forward<T>(object).*f)(std::forward<Args>(args)...)) {
+      return ((std::forward<T>(object).*f)(std::forward<Args>(args)...));
+    }
+
+    /**
+     * \brief Invokes a pointer to member function on an object held
+     * by a `std::reference_wrapper`.
+     */
+    template <typename M, typename C, typename T, typename... Args, typename = typename std::enable_if<std::is_function<M>::value>::type>
+    auto invoke(M C::* f, std::reference_wrapper<T> object, Args&&... args)
+      -> decltype((object.get().*f)(std::forward<Args>(args)...)) {
+      return ((object.get().*f)(std::forward<Args>(args)...));
+    }
+
+    /**
+     * \brief Invokes a pointer to member function on an object pointed
+     * to by a pointer or a smart pointer.
+     */
+    template <typename M, typename C, typename T, typename... Args, typename = typename std::enable_if<std::is_function<M>::value>::type>
+    auto invoke(M C::* f, T&& pointer, Args&&... args)
+      -> decltype(((*std::forward<T>(pointer)).*f)(std::forward<Args>(args)...)) {
+      return (((*std::forward<T>(pointer)).*f)(std::forward<Args>(args)...));
+    }
+
+    /**
+     * \brief Reads a data member of an object, or of a reference to an object.
+     */
+    template <typename M, typename C, typename T, typename = typename std::enable_if<!std::is_function<M>::value>::type>
+    auto invoke(M C::* member, T&& object)
+      -> decltype(std::forward<T>(object).*member) {
+      return (std::forward<T>(object).*member);
+    }
+
+    /**
+     * \brief Reads a data member of an object pointed to
+     * by a pointer or a smart pointer.
+     */
+    template <typename M, typename C, typename T, typename = typename std::enable_if<!std::is_function<M>::value>::type>
+    auto invoke(M C::* member, T&& pointer)
+      -> decltype((*std::forward<T>(pointer)).*member) {
+      return ((*std::forward<T>(pointer)).*member);
+    }
+
+    /**
+     * \brief A compile-time sequence of indices.
+     */
+    template <size_t... I>
+    struct indices_t {};
+
+    /**
+     * \brief Builds the sequence of indices from 0 to `N` excluded.
+     */
+    template <size_t N, size_t... I>
+    struct make_indices_t : make_indices_t<N - 1, N - 1, I...> {};
+
+    template <size_t... I>
+    struct make_indices_t<0, I...> {
+      using type = indices_t<I...>;
+    };
+
+    /**
+     * \class bound_t
+     * \brief A callable storing a callable and the arguments it is invoked
+     * with. Both are moved into it rather than copied, which allows move-only
+     * types to be scheduled, and the arguments are passed to the callable as
+     * rvalues, in the same way `std::thread` and `std::async` do. Since the
+     * arguments are moved when the callable is invoked, it can only be
+     * invoked once.
+     */
+    template <typename F, typename... Args>
+    class bound_t {
+    public:
+
+      /**
+       * \brief The type of the value returned by the callable.
+       */
+      using result_type = typename std::result_of<F(Args...)>::type;
+
+      /**
+       * \constructor
+       */
+      template <typename G, typename... A>
+      explicit bound_t(G&& f, A&&... args)
+        : members_(std::forward<G>(f), std::forward<A>(args)...) {}
+
+      /**
+       * \brief Invokes the callable with the stored arguments.
+       */
+      result_type operator()() {
+        return (call(typename make_indices_t<sizeof...(Args)>::type()));
+      }
+
+    private:
+
+      template <size_t... I>
+      result_type call(indices_t<I...>) {
+        return (thread::pool::invoke(std::move(std::get<0>(members_)), std::move(std::get<I + 1>(members_))...));
+      }
+
+      /**
+       * \brief The callable followed by its arguments, in a single tuple
+       * so that an empty callable does not take any room.
+       */
+      std::tuple<F, Args...> members_;
+    };
+
+    /**
+     * \brief A callable taking no argument is stored as is.
+     */
+    template <typename F>
+    typename std::decay<F>::type bind_arguments(F&& f) {
+      return (std::forward<F>(f));
+    }
+
+    /**
+     * \return a callable invoking `f` with `args`, into which
+     * `f` and `args` are moved or copied.
+     */
+    template <typename F, typename Arg, typename... Args>
+    bound_t<typename std::decay<F>::type, typename std::decay<Arg>::type, typename std::decay<Args>::type...>
+    bind_arguments(F&& f, Arg&& arg, Args&&... args) {
+      return (bound_t<typename std::decay<F>::type, typename std::decay<Arg>::type, typename std::decay<Args>::type...>(
+        std::forward<F>(f), std::forward<Arg>(arg), std::forward<Args>(args)...
+      ));
+    }
+
+    /**
+     * \brief The type of the callable returned by `bind_arguments`.
+     */
+    template <typename F, typename... Args>
+    using bound_type_t = decltype(bind_arguments(std::declval<F>(), std::declval<Args>()...));
+
+    /**
+     * \brief The type of the value returned by `f(args...)`, once
+     * `f` and `args` have been moved into a task.
+     */
+    template <typename F, typename... Args>
+    using task_result_t = typename std::result_of<
+      typename std::decay<F>::type(typename std::decay<Args>::type...)
+    >::type;
+  };
+};
+
+#endif // THREAD_POOL_INVOKE_H_
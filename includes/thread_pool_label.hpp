@@ -0,0 +1,426 @@
+#ifndef THREAD_POOL_LABEL_H_
+#define THREAD_POOL_LABEL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#endif
+
+#include "thread_pool_metrics.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \return the CPU time consumed by the calling thread, in nanoseconds,
+     * or zero on platforms which do not provide a per-thread CPU clock.
+     */
+    inline uint64_t thread_cpu_now() noexcept {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+      struct timespec now;
+      if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0) {
+        return (uint64_t(now.tv_sec) * 1000 * 1000 * 1000 + uint64_t(now.tv_nsec));
+      }
+#endif
+      return (0);
+    }
+
+    /**
+     * \class label_registry_t
+     * \brief The process-wide registry of task labels, which interns each
+     * label name into a 16 bits identifier, small enough to be stored in
+     * the padding of a task. Interning a name takes a lock, while looking
+     * up the name of an identifier is lock-free. The identifier zero
+     * stands for unlabeled tasks.
+     */
+    class label_registry_t {
+
+      /**
+       * \brief The number of names held by each chunk of the table.
+       */
+      static const size_t CHUNK_SIZE = 256;
+
+    public:
+
+      /**
+       * \brief The maximum number of labels, including the unlabeled one.
+       */
+      static const size_t MAX_LABELS = 1 << 16;
+
+      /**
+       * \return the registry, which is never destroyed, so that
+       * labels can be used until the process exits.
+       */
+      static label_registry_t& instance() {
+        static label_registry_t* registry = new label_registry_t();
+        return (*registry);
+      }
+
+      /**
+       * \return the identifier of the label with the given name, which
+       * is registered if needed. Once `MAX_LABELS` labels have been
+       * registered, new names are mapped to the unlabeled identifier.
+       */
+      uint16_t intern(const char* name) {
+        std::lock_guard<std::mutex> lock(lock_);
+        return (intern_locked(name));
+      }
+
+      /**
+       * \return the name of the label with the given identifier, which
+       * may be read from any thread, or `unlabeled` if the identifier
+       * has not been registered.
+       */
+      const char* name(uint16_t id) const noexcept {
+        const std::atomic<const char*>* chunk = chunks_[id / CHUNK_SIZE].load(std::memory_order_acquire);
+        const char* name = chunk != nullptr ? chunk[id % CHUNK_SIZE].load(std::memory_order_acquire) : nullptr;
+        return (name != nullptr ? name : "unlabeled");
+      }
+
+      /**
+       * \return the number of registered labels, whose
+       * identifiers range from zero to this number.
+       */
+      size_t size() const noexcept {
+        return (size_.load(std::memory_order_acquire));
+      }
+
+    private:
+
+      label_registry_t()
+        : size_(0) {
+        for (std::atomic<std::atomic<const char*>*>& chunk : chunks_) {
+          chunk.store(nullptr, std::memory_order_relaxed);
+        }
+        intern_locked("unlabeled");
+      }
+
+      uint16_t intern_locked(const char* name) {
+        auto it = ids_.find(name);
+        if (it != ids_.end()) {
+          return (it->second);
+        }
+        size_t id = size_.load(std::memory_order_relaxed);
+        if (id >= MAX_LABELS) {
+          return (0);
+        }
+        if (id % CHUNK_SIZE == 0) {
+          std::atomic<const char*>* chunk = new std::atomic<const char*>[CHUNK_SIZE];
+          for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+            chunk[i].store(nullptr, std::memory_order_relaxed);
+          }
+          chunks_[id / CHUNK_SIZE].store(chunk, std::memory_order_release);
+        }
+        names_.push_back(name);
+        chunks_[id / CHUNK_SIZE].load(std::memory_order_relaxed)[id % CHUNK_SIZE].store(names_.back().c_str(), std::memory_order_release);
+        ids_.emplace(names_.back(), static_cast<uint16_t>(id));
+        // Publishing the name to the threads enumerating the labels.
+        size_.store(id + 1, std::memory_order_release);
+        return (static_cast<uint16_t>(id));
+      }
+
+      /**
+       * \brief Lock guarding the registration of labels.
+       */
+      std::mutex lock_;
+
+      /**
+       * \brief The names of the labels, which never move.
+       */
+      std::deque<std::string> names_;
+
+      /**
+       * \brief The identifier of each name.
+       */
+      std::unordered_map<std::string, uint16_t> ids_;
+
+      /**
+       * \brief The names of the labels, by identifier, which
+       * are never released, as the registry itself.
+       */
+      std::atomic<std::atomic<const char*>*> chunks_[MAX_LABELS / CHUNK_SIZE];
+
+      /**
+       * \brief The number of registered labels.
+       */
+      std::atomic<size_t> size_;
+    };
+
+    /**
+     * \class task_label_t
+     * \brief A label attached to tasks, so that the tasks sharing a label
+     * can be told apart in metrics and traces. Creating a label from a name
+     * registers it, which takes a lock, so that labels are meant to be
+     * created once and kept around, for instance as static variables, or
+     * through `task_label_t::of<Tag>()` which does so for a tag type.
+     */
+    class task_label_t {
+    public:
+
+      /**
+       * \constructor
+       * \brief Creates the label of unlabeled tasks.
+       */
+      task_label_t() noexcept
+        : id_(0) {}
+
+      /**
+       * \constructor
+       * \brief Creates the label with the given name.
+       */
+      explicit task_label_t(const char* name)
+        : id_(label_registry_t::instance().intern(name)) {}
+
+      /**
+       * \return the label of the tag type `Tag`, whose static `name()`
+       * function returns the name of the label. The label is only
+       * registered the first time this function is called.
+       */
+      template <typename Tag>
+      static task_label_t of() {
+        static const task_label_t label(Tag::name());
+        return (label);
+      }
+
+      /**
+       * \return the identifier of the label.
+       */
+      uint16_t id() const noexcept {
+        return (id_);
+      }
+
+      /**
+       * \return the name of the label.
+       */
+      const char* name() const noexcept {
+        return (label_registry_t::instance().name(id_));
+      }
+
+    private:
+
+      /**
+       * \brief The identifier of the label.
+       */
+      uint16_t id_;
+    };
+
+    /**
+     * \class labeled_metrics_t
+     * \brief A metrics policy collecting everything `pool_metrics_t` does,
+     * and accounting for the tasks of each label separately: their count,
+     * the wall and CPU time spent running them, and their queue wait.
+     *
+     * Each worker keeps counters of its own for each label it ran, which
+     * are allocated the first time it runs a task with that label, and are
+     * only aggregated when a snapshot is requested, so that the accounting
+     * of labels involves no lock and no contended write. The CPU time is
+     * read from the per-thread CPU clock, once per task, since the end of
+     * a task is the start of the next one run by the same worker.
+     */
+    class labeled_metrics_t {
+
+      /**
+       * \brief The counters of a single label, written by a single worker.
+       */
+      struct label_counters_t {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> wall_time;
+        std::atomic<uint64_t> cpu_time;
+        log_histogram_t queue_wait;
+
+        label_counters_t()
+          : count(0), wall_time(0), cpu_time(0) {}
+      };
+
+      /**
+       * \brief The number of labels held by each chunk of counters.
+       */
+      static const size_t CHUNK_SIZE = 256;
+
+      /**
+       * \brief A chunk of the counters of a worker.
+       */
+      struct chunk_t {
+        std::atomic<label_counters_t*> counters[CHUNK_SIZE];
+
+        chunk_t() {
+          for (std::atomic<label_counters_t*>& entry : counters) {
+            entry.store(nullptr, std::memory_order_relaxed);
+          }
+        }
+
+        ~chunk_t() {
+          for (std::atomic<label_counters_t*>& entry : counters) {
+            delete entry.load(std::memory_order_relaxed);
+          }
+        }
+      };
+
+      /**
+       * \brief The counters of the labels run by a single worker.
+       */
+      struct worker_t {
+        std::atomic<chunk_t*> chunks[label_registry_t::MAX_LABELS / CHUNK_SIZE];
+
+        /**
+         * \brief The end of the last task run by the worker, and the CPU
+         * time of the worker at that point, which are only used by the
+         * worker itself.
+         */
+        uint64_t last_end;
+        uint64_t last_cpu;
+
+        /**
+         * \brief Keeps the counters of two workers from sharing a cache line.
+         */
+        char padding_[64];
+
+        worker_t()
+          : last_end(0), last_cpu(0) {
+          for (std::atomic<chunk_t*>& chunk : chunks) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+          }
+        }
+
+        ~worker_t() {
+          for (std::atomic<chunk_t*>& chunk : chunks) {
+            delete chunk.load(std::memory_order_relaxed);
+          }
+        }
+
+        /**
+         * \return the counters of the given label, which are allocated
+         * if needed, or a null pointer if they cannot be allocated.
+         */
+        label_counters_t* counters(uint16_t label) noexcept {
+          std::atomic<chunk_t*>& slot = chunks[label / CHUNK_SIZE];
+          chunk_t* chunk = slot.load(std::memory_order_relaxed);
+          if (chunk == nullptr) {
+            chunk = new (std::nothrow) chunk_t();
+            if (chunk == nullptr) {
+              return (nullptr);
+            }
+            slot.store(chunk, std::memory_order_release);
+          }
+          std::atomic<label_counters_t*>& entry = chunk->counters[label % CHUNK_SIZE];
+          label_counters_t* counters = entry.load(std::memory_order_relaxed);
+          if (counters == nullptr) {
+            counters = new (std::nothrow) label_counters_t();
+            entry.store(counters, std::memory_order_release);
+          }
+          return (counters);
+        }
+
+        /**
+         * \return the counters of the given label, if the
+         * worker has run a task with that label.
+         */
+        const label_counters_t* find(size_t label) const noexcept {
+          const chunk_t* chunk = chunks[label / CHUNK_SIZE].load(std::memory_order_acquire);
+          return (chunk != nullptr ? chunk->counters[label % CHUNK_SIZE].load(std::memory_order_acquire) : nullptr);
+        }
+      };
+
+    public:
+
+      static const bool enabled = true;
+
+      explicit labeled_metrics_t(size_t workers)
+        : metrics_(workers), count_(workers), workers_(new worker_t[workers > 0 ? workers : 1]) {}
+
+      static uint64_t now() noexcept {
+        return (pool_metrics_t::now());
+      }
+
+      void on_enqueue(size_t count) noexcept {
+        metrics_.on_enqueue(count);
+      }
+
+      void on_dequeue(size_t worker, size_t count) noexcept {
+        metrics_.on_dequeue(worker, count);
+      }
+
+      template <typename Task>
+      uint64_t run(size_t worker, Task& task, uint64_t start) {
+        worker_t& state = workers_[worker];
+        // The CPU clock is only read anew when the worker did not
+        // run a task right before this one.
+        uint64_t cpu = start == state.last_end ? state.last_cpu : thread_cpu_now();
+        uint16_t label = task.label();
+        uint64_t stamp = task.stamp();
+        uint64_t end = metrics_.run(worker, task, start);
+        state.last_end = end;
+        state.last_cpu = thread_cpu_now();
+        label_counters_t* counters = state.counters(label);
+        if (counters != nullptr) {
+          add_relaxed(counters->count, 1);
+          add_relaxed(counters->wall_time, end - start);
+          add_relaxed(counters->cpu_time, state.last_cpu - cpu);
+          if (stamp != 0) {
+            counters->queue_wait.record((start - stamp) & Task::STAMP_MASK);
+          }
+        }
+        return (end);
+      }
+
+      void on_idle(size_t worker, uint64_t begin, uint64_t end) noexcept {
+        metrics_.on_idle(worker, begin, end);
+      }
+
+      void on_parked(size_t worker, uint64_t begin, uint64_t end) noexcept {
+        metrics_.on_parked(worker, begin, end);
+      }
+
+      void snapshot(metrics_snapshot_t& snapshot) const {
+        metrics_.snapshot(snapshot);
+        const label_registry_t& registry = label_registry_t::instance();
+        size_t labels = registry.size();
+        for (size_t label = 0; label < labels; ++label) {
+          label_snapshot_t entry{ registry.name(static_cast<uint16_t>(label)), 0,
+            std::chrono::nanoseconds(0), std::chrono::nanoseconds(0), histogram_snapshot_t() };
+          for (size_t i = 0; i < count_; ++i) {
+            const label_counters_t* counters = workers_[i].find(label);
+            if (counters != nullptr) {
+              entry.count += counters->count.load(std::memory_order_relaxed);
+              entry.wall_time += std::chrono::nanoseconds(counters->wall_time.load(std::memory_order_relaxed));
+              entry.cpu_time += std::chrono::nanoseconds(counters->cpu_time.load(std::memory_order_relaxed));
+              counters->queue_wait.merge_into(entry.queue_wait);
+            }
+          }
+          if (entry.count > 0) {
+            snapshot.labels.push_back(entry);
+          }
+        }
+      }
+
+    private:
+
+      /**
+       * \brief The metrics which are not broken down by label.
+       */
+      pool_metrics_t metrics_;
+
+      /**
+       * \brief The number of workers.
+       */
+      const size_t count_;
+
+      /**
+       * \brief The counters of each worker.
+       */
+      std::unique_ptr<worker_t[]> workers_;
+    };
+  };
+};
+
+#endif // THREAD_POOL_LABEL_H_
@@ -0,0 +1,424 @@
+#ifndef THREAD_POOL_MEMORY_H_
+#define THREAD_POOL_MEMORY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \class memory_resource_t
+     * \brief An abstract source of memory, modeled after the C++17
+     * `std::pmr::memory_resource`, from which a thread pool allocates
+     * the blocks of its queue, the storage of its tasks and the shared
+     * state of the futures it returns. Implementations must be
+     * thread-safe, and must outlive the pool as well as every
+     * future returned by the pool.
+     */
+    class memory_resource_t {
+    public:
+
+      /**
+       * \brief The alignment used when none is provided.
+       */
+      static const size_t DEFAULT_ALIGNMENT = alignof(std::max_align_t);
+
+      virtual ~memory_resource_t() {}
+
+      /**
+       * \brief Allocates `bytes` bytes aligned on `alignment`.
+       * \throw std::bad_alloc if the memory cannot be allocated.
+       */
+      void* allocate(size_t bytes, size_t alignment = DEFAULT_ALIGNMENT) {
+        return (do_allocate(bytes, alignment));
+      }
+
+      /**
+       * \brief Releases memory previously returned by `allocate`
+       * with the same `bytes` and `alignment`.
+       */
+      void deallocate(void* ptr, size_t bytes, size_t alignment = DEFAULT_ALIGNMENT) {
+        do_deallocate(ptr, bytes, alignment);
+      }
+
+      /**
+       * \return whether memory allocated by this resource
+       * can be released by `other`, and vice-versa.
+       */
+      bool is_equal(const memory_resource_t& other) const noexcept {
+        return (do_is_equal(other));
+      }
+
+    protected:
+
+      virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+      virtual void do_deallocate(void* ptr, size_t bytes, size_t alignment) = 0;
+      virtual bool do_is_equal(const memory_resource_t& other) const noexcept = 0;
+    };
+
+    /**
+     * \class new_delete_resource_t
+     * \brief A resource allocating memory through the global
+     * `operator new` and `operator delete`.
+     */
+    class new_delete_resource_t : public memory_resource_t {
+    protected:
+
+      void* do_allocate(size_t bytes, size_t) override {
+        return (::operator new(bytes));
+      }
+
+      void do_deallocate(void* ptr, size_t, size_t) override {
+        ::operator delete(ptr);
+      }
+
+      bool do_is_equal(const memory_resource_t& other) const noexcept override {
+        return (dynamic_cast<const new_delete_resource_t*>(&other) != nullptr);
+      }
+    };
+
+    /**
+     * \return the process-wide resource using the global heap, which
+     * is used by thread pools created without a memory resource.
+     */
+    inline memory_resource_t* new_delete_resource() noexcept {
+      static new_delete_resource_t resource;
+      return (&resource);
+    }
+
+#if __cplusplus >= 201703L
+    /**
+     * \class pmr_resource_t
+     * \brief Adapts a `std::pmr::memory_resource`, such as a
+     * `std::pmr::monotonic_buffer_resource`, to a thread pool.
+     */
+    class pmr_resource_t : public memory_resource_t {
+    public:
+
+      explicit pmr_resource_t(std::pmr::memory_resource* upstream)
+        : upstream_(upstream) {}
+
+    protected:
+
+      void* do_allocate(size_t bytes, size_t alignment) override {
+        return (upstream_->allocate(bytes, alignment));
+      }
+
+      void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(ptr, bytes, alignment);
+      }
+
+      bool do_is_equal(const memory_resource_t& other) const noexcept override {
+        const pmr_resource_t* pmr = dynamic_cast<const pmr_resource_t*>(&other);
+        return (pmr != nullptr && upstream_->is_equal(*pmr->upstream_));
+      }
+
+    private:
+
+      std::pmr::memory_resource* upstream_;
+    };
+#endif
+
+    /**
+     * \struct allocation_stats_t
+     * \brief A snapshot of the allocations made by a thread pool.
+     */
+    struct allocation_stats_t {
+
+      /**
+       * \brief The number of allocations made since the pool was created.
+       */
+      size_t allocations;
+
+      /**
+       * \brief The number of deallocations made since the pool was created.
+       */
+      size_t deallocations;
+
+      /**
+       * \brief The number of bytes allocated since the pool was created.
+       */
+      size_t bytes_allocated;
+
+      /**
+       * \brief The number of bytes currently allocated.
+       */
+      size_t bytes_in_use;
+
+      /**
+       * \brief The highest number of bytes allocated at once.
+       */
+      size_t peak_bytes_in_use;
+    };
+
+    /**
+     * \class counting_resource_t
+     * \brief A resource forwarding allocations to an upstream resource,
+     * which keeps track of allocation statistics. Since the futures
+     * returned by a pool may release their shared state after the pool
+     * is gone, the resource is reference counted by its owner and by
+     * every allocation it made, and deletes itself once both its owner
+     * has released it and every allocation has been released. It must
+     * therefore be created using `new`. The resource can also own its
+     * upstream resource, which then lives as long as the resource.
+     */
+    class counting_resource_t : public memory_resource_t {
+    public:
+
+      /**
+       * \struct releaser_t
+       * \brief Deleter releasing the owner reference of a resource.
+       */
+      struct releaser_t {
+        void operator()(counting_resource_t* resource) const {
+          resource->release();
+        }
+      };
+
+      /**
+       * \constructor
+       */
+      explicit counting_resource_t(memory_resource_t* upstream)
+        : upstream_(upstream),
+          references_(1),
+          allocations_(0),
+          deallocations_(0),
+          bytes_allocated_(0),
+          bytes_in_use_(0),
+          peak_bytes_in_use_(0) {}
+
+      /**
+       * \constructor
+       * \brief Creates a resource owning its upstream resource.
+       */
+      explicit counting_resource_t(std::unique_ptr<memory_resource_t> upstream)
+        : owned_upstream_(std::move(upstream)),
+          upstream_(owned_upstream_.get()),
+          references_(1),
+          allocations_(0),
+          deallocations_(0),
+          bytes_allocated_(0),
+          bytes_in_use_(0),
+          peak_bytes_in_use_(0) {}
+
+      /**
+       * \return the upstream resource.
+       */
+      memory_resource_t* upstream() const noexcept {
+        return (upstream_);
+      }
+
+      /**
+       * \return a snapshot of the allocation statistics.
+       */
+      allocation_stats_t stats() const noexcept {
+        allocation_stats_t stats;
+        stats.allocations = allocations_.load(std::memory_order_relaxed);
+        stats.deallocations = deallocations_.load(std::memory_order_relaxed);
+        stats.bytes_allocated = bytes_allocated_.load(std::memory_order_relaxed);
+        stats.bytes_in_use = bytes_in_use_.load(std::memory_order_relaxed);
+        stats.peak_bytes_in_use = peak_bytes_in_use_.load(std::memory_order_relaxed);
+        return (stats);
+      }
+
+      /**
+       * \brief Releases the owner reference of the resource.
+       */
+      void release() noexcept {
+        unref();
+      }
+
+    protected:
+
+      void* do_allocate(size_t bytes, size_t alignment) override {
+        void* ptr = upstream_->allocate(bytes, alignment);
+        references_.fetch_add(1, std::memory_order_relaxed);
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        bytes_allocated_.fetch_add(bytes, std::memory_order_relaxed);
+        size_t in_use = bytes_in_use_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peak_bytes_in_use_.load(std::memory_order_relaxed);
+        while (in_use > peak && !peak_bytes_in_use_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {}
+        return (ptr);
+      }
+
+      void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(ptr, bytes, alignment);
+        deallocations_.fetch_add(1, std::memory_order_relaxed);
+        bytes_in_use_.fetch_sub(bytes, std::memory_order_relaxed);
+        unref();
+      }
+
+      bool do_is_equal(const memory_resource_t& other) const noexcept override {
+        return (this == &other);
+      }
+
+    private:
+
+      /**
+       * \brief Drops a reference, deleting the resource with the last one.
+       */
+      void unref() noexcept {
+        if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          delete this;
+        }
+      }
+
+      std::unique_ptr<memory_resource_t> owned_upstream_;
+      memory_resource_t* upstream_;
+      std::atomic<size_t> references_;
+      std::atomic<size_t> allocations_;
+      std::atomic<size_t> deallocations_;
+      std::atomic<size_t> bytes_allocated_;
+      std::atomic<size_t> bytes_in_use_;
+      std::atomic<size_t> peak_bytes_in_use_;
+    };
+
+    /**
+     * \class resource_allocator_t
+     * \brief A standard allocator drawing its memory from a resource,
+     * used to allocate the shared state of futures.
+     */
+    template <typename T>
+    class resource_allocator_t {
+    public:
+
+      using value_type = T;
+
+      explicit resource_allocator_t(memory_resource_t* resource) noexcept
+        : resource_(resource) {}
+
+      template <typename U>
+      resource_allocator_t(const resource_allocator_t<U>& other) noexcept
+        : resource_(other.resource()) {}
+
+      T* allocate(size_t count) {
+        return (static_cast<T*>(resource_->allocate(count * sizeof(T), alignof(T))));
+      }
+
+      void deallocate(T* ptr, size_t count) noexcept {
+        resource_->deallocate(ptr, count * sizeof(T), alignof(T));
+      }
+
+      memory_resource_t* resource() const noexcept {
+        return (resource_);
+      }
+
+    private:
+
+      memory_resource_t* resource_;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const resource_allocator_t<T>& lhs, const resource_allocator_t<U>& rhs) noexcept {
+      return (lhs.resource() == rhs.resource() || lhs.resource()->is_equal(*rhs.resource()));
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const resource_allocator_t<T>& lhs, const resource_allocator_t<U>& rhs) noexcept {
+      return (!(lhs == rhs));
+    }
+
+    /**
+     * \brief Queues only know about a size when they allocate and release
+     * their storage, so a thread pool selects the resource used by its
+     * queue through a thread-local variable set while the queue is being
+     * constructed or written to.
+     * \return a reference to the resource selected on the calling thread.
+     */
+    inline memory_resource_t*& current_resource_slot() noexcept {
+      static thread_local memory_resource_t* resource = nullptr;
+      return (resource);
+    }
+
+    /**
+     * \return the resource selected on the calling thread, or the
+     * global heap if no resource has been selected.
+     */
+    inline memory_resource_t* current_resource() noexcept {
+      memory_resource_t* resource = current_resource_slot();
+      return (resource != nullptr ? resource : new_delete_resource());
+    }
+
+    /**
+     * \class resource_scope_t
+     * \brief Selects a resource on the calling thread during its lifetime.
+     */
+    class resource_scope_t {
+    public:
+
+      explicit resource_scope_t(memory_resource_t* resource) noexcept
+        : previous_(current_resource_slot()) {
+        current_resource_slot() = resource;
+      }
+
+      ~resource_scope_t() {
+        current_resource_slot() = previous_;
+      }
+
+      resource_scope_t(const resource_scope_t&) = delete;
+      resource_scope_t& operator=(const resource_scope_t&) = delete;
+
+    private:
+
+      memory_resource_t* previous_;
+    };
+
+    /**
+     * \brief Header preceding the memory returned by `tagged_allocate`,
+     * recording where it comes from so that it can be released from
+     * anywhere, padded to keep the memory following it aligned.
+     */
+    union allocation_header_t {
+      struct {
+        memory_resource_t* resource;
+        size_t bytes;
+      } tag;
+      std::max_align_t alignment;
+    };
+
+    /**
+     * \brief Allocates `bytes` bytes from the resource selected on the
+     * calling thread, using the default alignment.
+     * \throw std::bad_alloc if the memory cannot be allocated.
+     */
+    inline void* tagged_allocate(size_t bytes) {
+      memory_resource_t* resource = current_resource();
+      size_t total = sizeof(allocation_header_t) + bytes;
+      allocation_header_t* header = static_cast<allocation_header_t*>(resource->allocate(total));
+      header->tag.resource = resource;
+      header->tag.bytes = total;
+      return (header + 1);
+    }
+
+    /**
+     * \brief Releases memory returned by `tagged_allocate` to
+     * the resource it was allocated from.
+     */
+    inline void tagged_deallocate(void* ptr) noexcept {
+      if (ptr != nullptr) {
+        allocation_header_t* header = static_cast<allocation_header_t*>(ptr) - 1;
+        header->tag.resource->deallocate(header, header->tag.bytes);
+      }
+    }
+
+    /**
+     * \struct tagged_deleter_t
+     * \brief Deleter releasing memory returned by `tagged_allocate`.
+     */
+    struct tagged_deleter_t {
+      void operator()(void* ptr) const noexcept {
+        tagged_deallocate(ptr);
+      }
+    };
+  };
+};
+
+#endif // THREAD_POOL_MEMORY_H_
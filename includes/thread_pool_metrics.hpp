@@ -0,0 +1,531 @@
+#ifndef THREAD_POOL_METRICS_H_
+#define THREAD_POOL_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \return the current time of the steady clock, in nanoseconds.
+     */
+    inline uint64_t steady_now() noexcept {
+      return (static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+      ).count()));
+    }
+
+    /**
+     * \brief Adds `value` to a counter which is only ever written by the
+     * calling thread, using a plain load and store rather than an atomic
+     * read-modify-write, while other threads may read it at any time.
+     */
+    inline void add_relaxed(std::atomic<uint64_t>& counter, uint64_t value) noexcept {
+      counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /**
+     * \class histogram_snapshot_t
+     * \brief A copy of the buckets of one or several log histograms.
+     */
+    class histogram_snapshot_t {
+    public:
+
+      /**
+       * \brief The number of sub-buckets of each power of two, as a
+       * power of two, which bounds the relative error of a recorded
+       * value to 1 / 2^SUB_BITS.
+       */
+      static const unsigned SUB_BITS = 3;
+
+      /**
+       * \brief The number of sub-buckets of each power of two.
+       */
+      static const uint64_t SUB_COUNT = uint64_t(1) << SUB_BITS;
+
+      /**
+       * \brief The number of buckets, covering every 64-bit value.
+       */
+      static const size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+      /**
+       * \constructor
+       */
+      histogram_snapshot_t()
+        : buckets_(BUCKETS, 0), count_(0), sum_(0), max_(0) {}
+
+      /**
+       * \return the index of the most significant bit set in `value`,
+       * which must not be zero.
+       */
+      static unsigned most_significant_bit(uint64_t value) noexcept {
+#if defined(__GNUC__)
+        return (63 - static_cast<unsigned>(__builtin_clzll(value)));
+#else
+        unsigned bit = 0;
+        while (value >>= 1) {
+          ++bit;
+        }
+        return (bit);
+#endif
+      }
+
+      /**
+       * \return the bucket holding `value`. Values lower than `SUB_COUNT`
+       * have a bucket of their own, while greater values are spread over
+       * `SUB_COUNT` buckets per power of two.
+       */
+      static size_t bucket_of(uint64_t value) noexcept {
+        if (value < SUB_COUNT) {
+          return (static_cast<size_t>(value));
+        }
+        unsigned shift = most_significant_bit(value) - SUB_BITS;
+        return (static_cast<size_t>((shift + 1) * SUB_COUNT + ((value >> shift) - SUB_COUNT)));
+      }
+
+      /**
+       * \return the highest value held by `bucket`.
+       */
+      static uint64_t upper_bound_of(size_t bucket) noexcept {
+        if (bucket < SUB_COUNT) {
+          return (bucket);
+        }
+        uint64_t shift = bucket / SUB_COUNT - 1;
+        uint64_t mantissa = bucket % SUB_COUNT + SUB_COUNT;
+        return (((mantissa + 1) << shift) - 1);
+      }
+
+      /**
+       * \brief Adds `count` occurrences to `bucket`.
+       */
+      void add(size_t bucket, uint64_t count) {
+        buckets_[bucket] += count;
+        count_ += count;
+      }
+
+      /**
+       * \brief Accounts for the sum and the maximum of recorded values.
+       */
+      void merge_totals(uint64_t sum, uint64_t max) {
+        sum_ += sum;
+        max_ = max > max_ ? max : max_;
+      }
+
+      /**
+       * \return the number of recorded values.
+       */
+      uint64_t count() const noexcept {
+        return (count_);
+      }
+
+      /**
+       * \return the greatest recorded value.
+       */
+      uint64_t max() const noexcept {
+        return (max_);
+      }
+
+      /**
+       * \return the mean of the recorded values.
+       */
+      double mean() const noexcept {
+        return (count_ > 0 ? static_cast<double>(sum_) / count_ : 0.0);
+      }
+
+      /**
+       * \return the value below which `percentile` percent of the
+       * recorded values are, rounded up to the bound of its bucket.
+       */
+      uint64_t percentile(double percentile) const noexcept {
+        if (count_ == 0) {
+          return (0);
+        }
+        uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * count_ + 0.5);
+        rank = rank > 0 ? rank : 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+          seen += buckets_[i];
+          if (seen >= rank) {
+            uint64_t bound = upper_bound_of(i);
+            return (bound < max_ ? bound : max_);
+          }
+        }
+        return (max_);
+      }
+
+    private:
+
+      std::vector<uint64_t> buckets_;
+      uint64_t count_;
+      uint64_t sum_;
+      uint64_t max_;
+    };
+
+    /**
+     * \class log_histogram_t
+     * \brief A histogram of durations in nanoseconds, with logarithmic
+     * buckets in the same way as HDR histograms, which is written by
+     * a single thread and can be read by any thread at any time.
+     */
+    class log_histogram_t {
+    public:
+
+      log_histogram_t()
+        : sum_(0), max_(0) {
+        for (std::atomic<uint64_t>& bucket : buckets_) {
+          bucket.store(0, std::memory_order_relaxed);
+        }
+      }
+
+      /**
+       * \brief Records `value`, which must be called by the owning thread.
+       */
+      void record(uint64_t value) noexcept {
+        add_relaxed(buckets_[histogram_snapshot_t::bucket_of(value)], 1);
+        add_relaxed(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed)) {
+          max_.store(value, std::memory_order_relaxed);
+        }
+      }
+
+      /**
+       * \brief Adds the recorded values to `snapshot`.
+       */
+      void merge_into(histogram_snapshot_t& snapshot) const {
+        for (size_t i = 0; i < histogram_snapshot_t::BUCKETS; ++i) {
+          uint64_t count = buckets_[i].load(std::memory_order_relaxed);
+          if (count > 0) {
+            snapshot.add(i, count);
+          }
+        }
+        snapshot.merge_totals(sum_.load(std::memory_order_relaxed), max_.load(std::memory_order_relaxed));
+      }
+
+    private:
+
+      std::atomic<uint64_t> buckets_[histogram_snapshot_t::BUCKETS];
+      std::atomic<uint64_t> sum_;
+      std::atomic<uint64_t> max_;
+    };
+
+    /**
+     * \struct worker_snapshot_t
+     * \brief The time spent by a worker in each of its states.
+     */
+    struct worker_snapshot_t {
+
+      /**
+       * \brief The time spent running tasks.
+       */
+      std::chrono::nanoseconds busy;
+
+      /**
+       * \brief The time spent polling the queue as
+       * dictated by the idle policy.
+       */
+      std::chrono::nanoseconds idle;
+
+      /**
+       * \brief The time spent parked.
+       */
+      std::chrono::nanoseconds parked;
+
+      /**
+       * \brief The number of tasks run by the worker.
+       */
+      uint64_t completed;
+    };
+
+    /**
+     * \struct label_snapshot_t
+     * \brief The metrics of the tasks sharing a label,
+     * aggregated across the workers of a pool.
+     */
+    struct label_snapshot_t {
+
+      /**
+       * \brief The name of the label.
+       */
+      const char* name;
+
+      /**
+       * \brief The number of tasks run.
+       */
+      uint64_t count;
+
+      /**
+       * \brief The total time spent running the tasks.
+       */
+      std::chrono::nanoseconds wall_time;
+
+      /**
+       * \brief The total CPU time consumed by the workers while running
+       * the tasks, which excludes the time they were blocked or preempted.
+       */
+      std::chrono::nanoseconds cpu_time;
+
+      /**
+       * \brief The time spent by the tasks in the queue, in nanoseconds.
+       */
+      histogram_snapshot_t queue_wait;
+    };
+
+    /**
+     * \struct metrics_snapshot_t
+     * \brief The metrics of a pool, aggregated across its workers.
+     */
+    struct metrics_snapshot_t {
+
+      /**
+       * \brief Whether metrics are collected by the pool, every other
+       * field but `queue_depth` being zero otherwise.
+       */
+      bool enabled;
+
+      /**
+       * \brief The number of tasks enqueued, dequeued and run.
+       */
+      uint64_t enqueued;
+      uint64_t dequeued;
+      uint64_t completed;
+
+      /**
+       * \brief The approximate number of queued tasks.
+       */
+      size_t queue_depth;
+
+      /**
+       * \brief The time spent by tasks in the queue,
+       * from their enqueue to their start, in nanoseconds.
+       */
+      histogram_snapshot_t queue_wait;
+
+      /**
+       * \brief The time spent running tasks, in nanoseconds.
+       */
+      histogram_snapshot_t run_time;
+
+      /**
+       * \brief The time spent by each worker in each of its states.
+       */
+      std::vector<worker_snapshot_t> workers;
+
+      /**
+       * \brief The metrics of each label tasks have been run with,
+       * which are only collected by the `labeled_metrics_t` policy.
+       */
+      std::vector<label_snapshot_t> labels;
+
+      metrics_snapshot_t()
+        : enabled(false), enqueued(0), dequeued(0), completed(0), queue_depth(0) {}
+    };
+
+    /**
+     * Metrics policies
+     * ----------------
+     *
+     * The metrics collected by a `parameterized_pool_t` are given as a
+     * `Metrics` policy, created with the number of workers of the pool,
+     * which must provide the following :
+     *
+     *  - `static const bool enabled` - Whether metrics are collected.
+     *  - `uint64_t now()` - The current time, stored in tasks as they are
+     *    enqueued, and passed back to the policy when they start.
+     *  - `void on_enqueue(size_t count)` - Called by producers.
+     *  - `void on_dequeue(size_t worker, size_t count)` - Called by workers.
+     *  - `uint64_t run(size_t worker, Task& task, uint64_t start)` - Runs a
+     *    task dequeued by a worker, whose enqueue time truncated to
+     *    `Task::STAMP_BITS` bits is `task.stamp()`, and which starts at
+     *    `start`. Returns the time at which it ended, which is the start
+     *    of the next task run by the worker.
+     *  - `void on_idle(size_t worker, uint64_t begin, uint64_t end)` and
+     *    `void on_parked(size_t worker, uint64_t begin, uint64_t end)` -
+     *    Account for the time spent by a worker waiting for tasks.
+     *  - `void snapshot(metrics_snapshot_t&) const` - Fills a snapshot.
+     */
+
+    /**
+     * \struct no_metrics_t
+     * \brief The default metrics policy, which collects nothing
+     * and compiles down to nothing.
+     */
+    struct no_metrics_t {
+
+      static const bool enabled = false;
+
+      explicit no_metrics_t(size_t) noexcept {}
+
+      static uint64_t now() noexcept {
+        return (0);
+      }
+
+      static void on_enqueue(size_t) noexcept {}
+
+      static void on_dequeue(size_t, size_t) noexcept {}
+
+      template <typename Task>
+      static uint64_t run(size_t, Task& task, uint64_t) {
+        task();
+        return (0);
+      }
+
+      static void on_idle(size_t, uint64_t, uint64_t) noexcept {}
+
+      static void on_parked(size_t, uint64_t, uint64_t) noexcept {}
+
+      static void snapshot(metrics_snapshot_t&) noexcept {}
+    };
+
+    /**
+     * \class pool_metrics_t
+     * \brief A metrics policy counting the tasks going through a pool,
+     * recording their queue wait and run time in log histograms, and
+     * accounting for the time spent by each worker running tasks, polling
+     * the queue and parked. Workers write to counters of their own, on
+     * separate cache lines, and producers to a striped counter, so that
+     * collecting metrics involves no contended write. Counters are only
+     * aggregated when a snapshot is requested.
+     */
+    class pool_metrics_t {
+
+      /**
+       * \brief The counters of a single worker.
+       */
+      struct worker_t {
+        std::atomic<uint64_t> dequeued;
+        std::atomic<uint64_t> completed;
+        std::atomic<uint64_t> busy;
+        std::atomic<uint64_t> idle;
+        std::atomic<uint64_t> parked;
+        log_histogram_t queue_wait;
+        log_histogram_t run_time;
+
+        /**
+         * \brief Keeps the counters of two workers from sharing a cache line.
+         */
+        char padding_[64];
+
+        worker_t()
+          : dequeued(0), completed(0), busy(0), idle(0), parked(0) {}
+      };
+
+      /**
+       * \brief A stripe of the counter of enqueued tasks.
+       */
+      struct stripe_t {
+        std::atomic<uint64_t> count;
+
+        /**
+         * \brief Keeps two stripes from sharing a cache line.
+         */
+        char padding_[64 - sizeof(std::atomic<uint64_t>)];
+
+        stripe_t()
+          : count(0) {}
+      };
+
+      /**
+       * \brief The number of stripes of the counter of enqueued tasks.
+       */
+      static const size_t STRIPES = 16;
+
+    public:
+
+      static const bool enabled = true;
+
+      explicit pool_metrics_t(size_t workers)
+        : count_(workers), workers_(new worker_t[workers > 0 ? workers : 1]) {}
+
+      static uint64_t now() noexcept {
+        return (steady_now());
+      }
+
+      void on_enqueue(size_t count) noexcept {
+        stripes_[stripe()].count.fetch_add(count, std::memory_order_relaxed);
+      }
+
+      void on_dequeue(size_t worker, size_t count) noexcept {
+        add_relaxed(workers_[worker].dequeued, count);
+      }
+
+      template <typename Task>
+      uint64_t run(size_t worker, Task& task, uint64_t start) {
+        worker_t& counters = workers_[worker];
+        uint64_t stamp = task.stamp();
+        if (stamp != 0) {
+          counters.queue_wait.record((start - stamp) & Task::STAMP_MASK);
+        }
+        task();
+        uint64_t end = steady_now();
+        counters.run_time.record(end - start);
+        add_relaxed(counters.busy, end - start);
+        add_relaxed(counters.completed, 1);
+        return (end);
+      }
+
+      void on_idle(size_t worker, uint64_t begin, uint64_t end) noexcept {
+        add_relaxed(workers_[worker].idle, end - begin);
+      }
+
+      void on_parked(size_t worker, uint64_t begin, uint64_t end) noexcept {
+        add_relaxed(workers_[worker].parked, end - begin);
+      }
+
+      void snapshot(metrics_snapshot_t& snapshot) const {
+        snapshot.enabled = true;
+        for (const stripe_t& stripe : stripes_) {
+          snapshot.enqueued += stripe.count.load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < count_; ++i) {
+          const worker_t& counters = workers_[i];
+          snapshot.dequeued += counters.dequeued.load(std::memory_order_relaxed);
+          snapshot.completed += counters.completed.load(std::memory_order_relaxed);
+          counters.queue_wait.merge_into(snapshot.queue_wait);
+          counters.run_time.merge_into(snapshot.run_time);
+          snapshot.workers.push_back(worker_snapshot_t{
+            std::chrono::nanoseconds(counters.busy.load(std::memory_order_relaxed)),
+            std::chrono::nanoseconds(counters.idle.load(std::memory_order_relaxed)),
+            std::chrono::nanoseconds(counters.parked.load(std::memory_order_relaxed)),
+            counters.completed.load(std::memory_order_relaxed)
+          });
+        }
+      }
+
+    private:
+
+      /**
+       * \return the stripe of the counter of enqueued
+       * tasks used by the calling thread.
+       */
+      static size_t stripe() noexcept {
+        static thread_local size_t index = std::hash<std::thread::id>()(std::this_thread::get_id()) % STRIPES;
+        return (index);
+      }
+
+      /**
+       * \brief The number of workers.
+       */
+      const size_t count_;
+
+      /**
+       * \brief The counters of each worker.
+       */
+      std::unique_ptr<worker_t[]> workers_;
+
+      /**
+       * \brief The counter of enqueued tasks.
+       */
+      stripe_t stripes_[STRIPES];
+    };
+  };
+};
+
+#endif // THREAD_POOL_METRICS_H_
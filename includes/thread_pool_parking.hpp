@@ -0,0 +1,288 @@
+#ifndef THREAD_POOL_PARKING_H_
+#define THREAD_POOL_PARKING_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#if defined(__linux__)
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#else
+#include <condition_variable>
+#endif
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \class parker_t
+     * \brief A parking slot owned by a single worker thread. Each
+     * worker parks on its own word, so that a producer can wake
+     * one specific worker instead of signaling a shared semaphore.
+     * On Linux the word is used as a futex, other platforms fall
+     * back to a mutex and a condition variable.
+     */
+    class parker_t {
+
+      friend class idle_stack_t;
+
+      /**
+       * \brief The worker is running and is not registered
+       * as being idle.
+       */
+      static const uint32_t RUNNING  = 0;
+
+      /**
+       * \brief The worker is registered on the idle stack
+       * and is (or is about to be) sleeping.
+       */
+      static const uint32_t PARKED   = 1;
+
+      /**
+       * \brief A producer popped the worker from the idle
+       * stack and asked it to resume.
+       */
+      static const uint32_t NOTIFIED = 2;
+
+      /**
+       * \brief The word the worker sleeps on.
+       */
+      std::atomic<uint32_t> state_;
+
+      /**
+       * \brief Intrusive links of the idle stack, guarded
+       * by the idle stack lock.
+       */
+      parker_t* prev_;
+      parker_t* next_;
+
+      /**
+       * \brief Whether the parker is currently linked in
+       * the idle stack, guarded by the idle stack lock.
+       */
+      bool idle_;
+
+#if !defined(__linux__)
+      std::mutex mutex_;
+      std::condition_variable condition_;
+#endif
+
+      /**
+       * \brief Keeps two parkers from sharing a cache line, since
+       * their state is written by different threads.
+       */
+      char padding_[64];
+
+    public:
+
+      /**
+       * \constructor
+       */
+      parker_t()
+        : state_(RUNNING), prev_(nullptr), next_(nullptr), idle_(false) {}
+
+      /**
+       * \brief A parker is bound to a worker thread and cannot be copied.
+       */
+      parker_t(const parker_t&) = delete;
+
+      /**
+       * \brief A parker is bound to a worker thread and cannot be copied.
+       */
+      parker_t& operator=(const parker_t&) = delete;
+
+      /**
+       * \brief Blocks the calling worker until it is notified or
+       * until `timeout` has elapsed. The worker must have been
+       * pushed on an idle stack beforehand.
+       * \return whether the worker has been notified.
+       */
+      template <typename Rep, typename Period>
+      bool park_for(const std::chrono::duration<Rep, Period>& timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+#if defined(__linux__)
+        while (state_.load(std::memory_order_acquire) == PARKED) {
+          auto now = std::chrono::steady_clock::now();
+          if (now >= deadline) {
+            break;
+          }
+          auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+          struct timespec ts;
+          ts.tv_sec  = static_cast<time_t>(remaining / 1000000000);
+          ts.tv_nsec = static_cast<long>(remaining % 1000000000);
+          ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAIT_PRIVATE, PARKED, &ts, nullptr, 0);
+        }
+        return (state_.load(std::memory_order_acquire) == NOTIFIED);
+#else
+        std::unique_lock<std::mutex> lock(mutex_);
+        return (condition_.wait_until(lock, deadline, [this] () {
+          return (state_.load(std::memory_order_acquire) != PARKED);
+        }));
+#endif
+      }
+
+    private:
+
+      /**
+       * \brief Wakes the worker if it is sleeping on its word.
+       */
+      void wake() {
+#if defined(__linux__)
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        std::lock_guard<std::mutex> lock(mutex_);
+        condition_.notify_one();
+#endif
+      }
+    };
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be 32-bit wide");
+
+    /**
+     * \class idle_stack_t
+     * \brief A LIFO stack of parked workers. The most recently parked
+     * worker is the first one to be woken up, as its stack and caches
+     * are the most likely to still be warm. Producers only take the
+     * lock when at least one worker is registered as idle.
+     */
+    class idle_stack_t {
+
+      /**
+       * \brief The number of workers popped from the stack under a
+       * single acquisition of the lock, before they are woken up.
+       */
+      static const size_t WAKE_BATCH = 16;
+
+      /**
+       * \brief Lock guarding the links of the stack.
+       */
+      std::mutex lock_;
+
+      /**
+       * \brief The most recently parked worker.
+       */
+      parker_t* head_;
+
+      /**
+       * \brief The number of workers on the stack, readable
+       * without taking the lock.
+       */
+      std::atomic<size_t> size_;
+
+      /**
+       * \brief Unlinks the given parker, the lock must be held.
+       */
+      void unlink(parker_t& parker) {
+        if (parker.prev_) {
+          parker.prev_->next_ = parker.next_;
+        } else {
+          head_ = parker.next_;
+        }
+        if (parker.next_) {
+          parker.next_->prev_ = parker.prev_;
+        }
+        parker.prev_ = parker.next_ = nullptr;
+        parker.idle_ = false;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+      }
+
+    public:
+
+      /**
+       * \constructor
+       */
+      idle_stack_t()
+        : head_(nullptr), size_(0) {}
+
+      /**
+       * \brief Registers the given parker as idle. The caller must
+       * check again for available work after this call and before
+       * parking, so that a concurrent producer cannot be missed.
+       */
+      void push(parker_t& parker) {
+        std::lock_guard<std::mutex> lock(lock_);
+        parker.state_.store(parker_t::PARKED, std::memory_order_relaxed);
+        parker.prev_ = nullptr;
+        parker.next_ = head_;
+        if (head_) {
+          head_->prev_ = &parker;
+        }
+        head_ = &parker;
+        parker.idle_ = true;
+        size_.fetch_add(1, std::memory_order_seq_cst);
+      }
+
+      /**
+       * \brief Withdraws the given parker from the stack if a producer
+       * has not already done so, and marks it as running again.
+       */
+      void remove(parker_t& parker) {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (parker.idle_) {
+          unlink(parker);
+        }
+        parker.state_.store(parker_t::RUNNING, std::memory_order_relaxed);
+      }
+
+      /**
+       * \brief Wakes up to `count` parked workers, most recently parked
+       * first. This must be called after the work has been published.
+       * The workers are popped under the lock and woken up once it has
+       * been released, so that the wake-up system calls do not hold back
+       * the workers parking or resuming meanwhile. A popped worker which
+       * resumes and parks again before being woken up finds its state
+       * `PARKED` again and goes back to sleep.
+       * \return the number of workers which have been woken up.
+       */
+      size_t notify(size_t count) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (count == 0 || size_.load(std::memory_order_relaxed) == 0) {
+          return (0);
+        }
+        size_t n = 0;
+        while (n < count) {
+          parker_t* popped[WAKE_BATCH];
+          size_t size = 0;
+          {
+            std::lock_guard<std::mutex> lock(lock_);
+            while (head_ && n + size < count && size < WAKE_BATCH) {
+              parker_t* parker = head_;
+              unlink(*parker);
+              parker->state_.store(parker_t::NOTIFIED, std::memory_order_release);
+              popped[size++] = parker;
+            }
+          }
+          for (size_t i = 0; i < size; ++i) {
+            popped[i]->wake();
+          }
+          n += size;
+          if (size < WAKE_BATCH) {
+            break;
+          }
+        }
+        return (n);
+      }
+
+      /**
+       * \brief Wakes every parked worker.
+       */
+      size_t notify_all() {
+        return (notify(static_cast<size_t>(-1)));
+      }
+
+      /**
+       * \return the approximate number of parked workers.
+       */
+      size_t size_approx() const {
+        return (size_.load(std::memory_order_relaxed));
+      }
+    };
+  };
+};
+
+#endif // THREAD_POOL_PARKING_H_
@@ -0,0 +1,335 @@
+#ifndef THREAD_POOL_QUEUE_H_
+#define THREAD_POOL_QUEUE_H_
+
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "thread_pool_memory.hpp"
+#include "concurrent_queue.hpp"
+#include "spsc_queue.hpp"
+#include "mpmc_queue.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * Queue backends
+     * --------------
+     *
+     * The queue used by a `parameterized_pool_t` to store and dispatch work
+     * amongst its workers is given as a class template `Queue<T>`, which must
+     * provide the following :
+     *
+     *  - `Queue<T>(size_t capacity)` - Creates the queue. The capacity is a
+     *    hint for unbounded queues, and a hard limit for bounded ones. A zero
+     *    capacity lets the queue pick its own default.
+     *  - `producer_token_t` and `consumer_token_t` - Token types which can be
+     *    created from a `Queue<T>&`.
+     *  - `bool enqueue([const producer_token_t&,] U&& item)` - Enqueues an item.
+     *  - `bool enqueue_bulk([const producer_token_t&,] It first, size_t count)` -
+     *    Enqueues `count` items read from the `first` iterator.
+     *  - `size_t try_dequeue_bulk(consumer_token_t&, It out, size_t max)` -
+     *    Moves up to `max` items to the `out` iterator without blocking, and
+     *    returns the number of dequeued items.
+     *  - `size_t size_approx() const` - The approximate number of queued items.
+     *
+     * Backends may also provide the following :
+     *
+     *  - `bool try_enqueue([const producer_token_t&,] U&& item)` - Enqueues an
+     *    item without allocating memory, and fails instead. `try_schedule`
+     *    does not compile with backends which do not provide it.
+     *  - `bool reserve(size_t items, size_t producers)` - Pre-allocates the
+     *    storage needed to hold `items` items enqueued by `producers` threads.
+     *    Reserving fails with backends which do not provide it.
+     *  - `static const bool single_consumer` - True for backends which only
+     *    support a single consumer thread and a single producer thread, in
+     *    which case the pool refuses to run more than one worker.
+     *
+     * The enqueue operations return false when the item could not be stored,
+     * and must not block. Queues should allocate their storage from the
+     * `current_resource()`, which the thread-pool selects while constructing
+     * the queue and enqueuing items, and release it using the resource the
+     * storage was allocated from, for instance through `tagged_allocate`.
+     * The timed bulk dequeue and the wakeup of workers are built by the
+     * thread-pool on top of `try_dequeue_bulk` and `size_approx`, using its
+     * idle policy and the parking of its workers, so that every backend
+     * shares the same idle behavior.
+     */
+
+    /**
+     * \struct resource_queue_traits_t
+     * \brief Traits of a `moodycamel::ConcurrentQueue` allocating its blocks
+     * from the `current_resource()` rather than from the global heap.
+     */
+    struct resource_queue_traits_t : public moodycamel::ConcurrentQueueDefaultTraits {
+      static void* malloc(size_t size) {
+        try {
+          return (tagged_allocate(size));
+        } catch (const std::bad_alloc&) {
+          return (nullptr);
+        }
+      }
+
+      static void free(void* ptr) {
+        tagged_deallocate(ptr);
+      }
+    };
+
+    /**
+     * \brief The default queue backend, the lock-free unbounded
+     * `moodycamel::ConcurrentQueue`.
+     */
+    template <typename T>
+    using moodycamel_queue_t = moodycamel::ConcurrentQueue<T, resource_queue_traits_t>;
+
+    /**
+     * \brief Enqueues `item` without allocating memory, for the
+     * backends which provide a `try_enqueue` method.
+     */
+    template <typename Queue, typename U>
+    auto try_enqueue_queue(Queue& queue, U&& item, int) -> decltype(queue.try_enqueue(std::forward<U>(item))) {
+      return (queue.try_enqueue(std::forward<U>(item)));
+    }
+
+    /**
+     * \brief Backends which do not provide a `try_enqueue`
+     * method may allocate on every enqueue.
+     */
+    template <typename Queue, typename U>
+    bool try_enqueue_queue(Queue&, U&&, long) {
+      static_assert(sizeof(Queue) == 0, "try_schedule requires a queue backend providing try_enqueue");
+      return (false);
+    }
+
+    /**
+     * \brief Enqueues `item` using `token` without allocating
+     * memory, for the backends which provide a `try_enqueue` method.
+     */
+    template <typename Queue, typename Token, typename U>
+    auto try_enqueue_queue(Queue& queue, const Token& token, U&& item, int) -> decltype(queue.try_enqueue(token, std::forward<U>(item))) {
+      return (queue.try_enqueue(token, std::forward<U>(item)));
+    }
+
+    /**
+     * \brief Backends which do not provide a `try_enqueue`
+     * method may allocate on every enqueue.
+     */
+    template <typename Queue, typename Token, typename U>
+    bool try_enqueue_queue(Queue&, const Token&, U&&, long) {
+      static_assert(sizeof(Queue) == 0, "try_schedule requires a queue backend providing try_enqueue");
+      return (false);
+    }
+
+    /**
+     * \brief Pre-allocates the storage needed to hold `items` items
+     * enqueued by `producers` threads, for the backends which provide
+     * a `reserve` method.
+     * \return false if the storage could not be allocated.
+     */
+    template <typename Queue>
+    auto reserve_queue(Queue& queue, size_t items, size_t producers, int) -> decltype(queue.reserve(items, producers)) {
+      return (queue.reserve(items, producers));
+    }
+
+    /**
+     * \brief Pre-allocates the blocks of a `moodycamel::ConcurrentQueue`,
+     * and the implicit producers of the threads enqueuing without a token.
+     * Each producer may hold a partially filled block on top of the blocks
+     * needed to hold `items` items, and the block index of each producer
+     * is large enough for one producer to hold every item.
+     */
+    template <typename T, typename Traits>
+    bool reserve_queue(moodycamel::ConcurrentQueue<T, Traits>& queue, size_t items, size_t producers, int) {
+      const size_t block_size = moodycamel::ConcurrentQueue<T, Traits>::BLOCK_SIZE;
+      size_t blocks = (items + block_size - 1) / block_size;
+      return (queue.reserve(blocks + producers, producers, blocks + 1));
+    }
+
+    /**
+     * \brief Backends which do not provide a `reserve`
+     * method cannot pre-allocate their storage.
+     */
+    template <typename Queue>
+    bool reserve_queue(Queue&, size_t, size_t, long) {
+      return (false);
+    }
+
+    /**
+     * \return whether `Queue` only supports a single consumer
+     * thread, for the backends which tell.
+     */
+    template <typename Queue>
+    constexpr auto is_single_consumer(int) -> decltype(bool(Queue::single_consumer)) {
+      return (Queue::single_consumer);
+    }
+
+    /**
+     * \brief Backends which do not tell support several consumers.
+     */
+    template <typename Queue>
+    constexpr bool is_single_consumer(long) {
+      return (false);
+    }
+
+    /**
+     * \brief Checks that a pool may run `concurrency` workers
+     * consuming from a `Queue`.
+     * \throw std::invalid_argument if the queue only supports a single
+     * consumer thread and `concurrency` is not 1.
+     * \return `concurrency`.
+     */
+    template <typename Queue>
+    size_t check_concurrency(size_t concurrency) {
+      if (is_single_consumer<Queue>(0) && concurrency != 1) {
+        throw std::invalid_argument("single consumer queue backends require a single worker");
+      }
+      return (concurrency);
+    }
+
+    /**
+     * \class locked_queue_t
+     * \brief An unbounded queue backend made of a `std::deque` guarded by
+     * a mutex. Under very low contention, taking an uncontended lock can be
+     * cheaper than the bookkeeping of a lock-free queue.
+     */
+    template <typename T>
+    class locked_queue_t {
+    public:
+
+      /**
+       * \struct token_t
+       * \brief The queue does not make use of tokens, this type only
+       * allows token based APIs to be used with the queue.
+       */
+      struct token_t {
+        explicit token_t(locked_queue_t&) {}
+      };
+
+      /**
+       * \brief Token types required by the queue concept.
+       */
+      using producer_token_t = token_t;
+      using consumer_token_t = token_t;
+
+      /**
+       * \constructor
+       */
+      explicit locked_queue_t(size_t = 0)
+        : items_(resource_allocator_t<T>(current_resource())), size_(0) {}
+
+      /**
+       * \brief A queue is non-copyable.
+       */
+      locked_queue_t(const locked_queue_t&) = delete;
+
+      /**
+       * \brief A queue is non-copyable.
+       */
+      locked_queue_t& operator=(const locked_queue_t&) = delete;
+
+      /**
+       * \brief Enqueues a single element.
+       * \return false if the element could not be stored.
+       */
+      template <typename U>
+      bool enqueue(U&& item) {
+        std::lock_guard<std::mutex> lock(lock_);
+        try {
+          items_.emplace_back(std::forward<U>(item));
+        } catch (...) {
+          return (false);
+        }
+        size_.store(items_.size(), std::memory_order_release);
+        return (true);
+      }
+
+      /**
+       * \brief Enqueues a single element.
+       */
+      template <typename U>
+      bool enqueue(const producer_token_t&, U&& item) {
+        return (enqueue(std::forward<U>(item)));
+      }
+
+      /**
+       * \brief Enqueues `count` elements, or none of them if one
+       * of them could not be stored.
+       * \return false if the elements could not be stored.
+       */
+      template <typename It>
+      bool enqueue_bulk(It first, size_t count) {
+        std::lock_guard<std::mutex> lock(lock_);
+        size_t size = items_.size();
+        try {
+          for (size_t i = 0; i < count; ++i, ++first) {
+            items_.emplace_back(*first);
+          }
+        } catch (...) {
+          while (items_.size() > size) {
+            items_.pop_back();
+          }
+          return (false);
+        }
+        size_.store(items_.size(), std::memory_order_release);
+        return (true);
+      }
+
+      /**
+       * \brief Enqueues `count` elements.
+       */
+      template <typename It>
+      bool enqueue_bulk(const producer_token_t&, It first, size_t count) {
+        return (enqueue_bulk(first, count));
+      }
+
+      /**
+       * \brief Dequeues up to `max` elements.
+       * \return the number of dequeued elements.
+       */
+      template <typename It>
+      size_t try_dequeue_bulk(consumer_token_t&, It out, size_t max) {
+        if (size_.load(std::memory_order_acquire) == 0) {
+          return (0);
+        }
+        std::lock_guard<std::mutex> lock(lock_);
+        size_t count = items_.size() < max ? items_.size() : max;
+        for (size_t i = 0; i < count; ++i, ++out) {
+          *out = std::move(items_.front());
+          items_.pop_front();
+        }
+        size_.store(items_.size(), std::memory_order_release);
+        return (count);
+      }
+
+      /**
+       * \return the approximate number of elements in the queue.
+       */
+      size_t size_approx() const {
+        return (size_.load(std::memory_order_relaxed));
+      }
+
+    private:
+
+      /**
+       * \brief Lock guarding the elements.
+       */
+      std::mutex lock_;
+
+      /**
+       * \brief The queued elements.
+       */
+      std::deque<T, resource_allocator_t<T>> items_;
+
+      /**
+       * \brief The number of queued elements, readable
+       * without taking the lock.
+       */
+      std::atomic<size_t> size_;
+    };
+  };
+};
+
+#endif // THREAD_POOL_QUEUE_H_
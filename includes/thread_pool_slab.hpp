@@ -0,0 +1,564 @@
+#ifndef THREAD_POOL_SLAB_H_
+#define THREAD_POOL_SLAB_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "thread_pool_memory.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \class slab_resource_t
+     * \brief A resource serving small allocations from per-thread slabs
+     * of fixed-size blocks, grouped in size classes, which is used to store
+     * the tasks which do not fit inline within a `task_t`.
+     *
+     * Tasks are allocated by producer threads and released by worker
+     * threads, which is the worst case for most general purpose allocators.
+     * Here, every thread using the resource owns a heap, and a block always
+     * returns to the heap it was carved from. A thread releasing a block it
+     * does not own appends it to a local batch for the owning heap, and hands
+     * the whole batch over with a single compare-and-swap once it is full or
+     * when `flush()` is called. The owner takes every block handed over to it
+     * at once when its own free list is empty, so neither side takes a lock.
+     *
+     * Memory is requested from the upstream resource in chunks, and is only
+     * released to it when the resource is destroyed. Allocations which are
+     * too large, or which require a stronger alignment than the default
+     * one, are forwarded to the upstream resource.
+     */
+    class slab_resource_t : public memory_resource_t {
+
+      /**
+       * \brief Size of the header preceding each block, which keeps
+       * the memory following it aligned on the default alignment.
+       */
+      static const size_t HEADER_SIZE = DEFAULT_ALIGNMENT;
+
+      /**
+       * \brief Size of a cache line, used to keep the blocks handed over
+       * by other threads away from the state of the owner.
+       */
+      static const size_t CACHE_LINE_SIZE = 64;
+
+      /**
+       * \brief A free block, linked to the next free block.
+       */
+      struct block_t {
+        block_t* next;
+      };
+
+      struct heap_t;
+
+      /**
+       * \brief Header preceding each block, recording its heap.
+       */
+      union header_t {
+        heap_t* owner;
+        std::max_align_t alignment;
+      };
+
+      /**
+       * \brief Blocks released by a thread on behalf of the
+       * heap owning them, waiting to be handed over.
+       */
+      struct batch_t {
+        heap_t* owner;
+        size_t size_class;
+        block_t* head;
+        block_t* tail;
+        size_t count;
+      };
+
+    public:
+
+      /**
+       * \brief Size of the blocks of the smallest size class.
+       */
+      static const size_t MIN_BLOCK_SIZE = 64;
+
+      /**
+       * \brief The number of size classes. The size of the blocks grows
+       * by half of a power of two from one class to the next (64, 96, 128,
+       * 192, 256 ...) so that at most a third of a block is wasted.
+       */
+      static const size_t SIZE_CLASSES = 13;
+
+      /**
+       * \brief Size of the blocks of the largest size class.
+       */
+      static const size_t MAX_BLOCK_SIZE = MIN_BLOCK_SIZE << (SIZE_CLASSES / 2);
+
+      /**
+       * \brief Size of the chunks requested from the upstream resource.
+       */
+      static const size_t CHUNK_SIZE = 64 * 1024;
+
+      /**
+       * \brief The number of blocks released on behalf of another
+       * heap which are handed over to it at once.
+       */
+      static const size_t BATCH_SIZE = 32;
+
+      /**
+       * \brief The number of heaps a thread can batch blocks for at once.
+       */
+      static const size_t BATCHES = 8;
+
+    private:
+
+      /**
+       * \brief The heap of a thread.
+       */
+      struct heap_t {
+
+        heap_t()
+          : abandoned(false), next(nullptr) {
+          for (size_t i = 0; i < SIZE_CLASSES; ++i) {
+            free[i] = nullptr;
+            remote[i].store(nullptr, std::memory_order_relaxed);
+          }
+          for (size_t i = 0; i < BATCHES; ++i) {
+            batches[i] = batch_t{ nullptr, 0, nullptr, nullptr, 0 };
+          }
+        }
+
+        /**
+         * \brief Blocks which can be allocated by the owner.
+         */
+        block_t* free[SIZE_CLASSES];
+
+        /**
+         * \brief Blocks released by other threads, waiting for the owner.
+         */
+        batch_t batches[BATCHES];
+
+        /**
+         * \brief Chunks carved in blocks by this heap.
+         */
+        std::vector<void*> chunks;
+
+        /**
+         * \brief Reserved chunks which have not been carved yet.
+         */
+        std::vector<void*> spare;
+
+        /**
+         * \brief Whether the thread owning this heap has exited,
+         * guarded by the lock of the resource.
+         */
+        bool abandoned;
+
+        /**
+         * \brief The next heap of the resource.
+         */
+        heap_t* next;
+
+        char padding_[CACHE_LINE_SIZE];
+
+        /**
+         * \brief Blocks handed over by other threads.
+         */
+        std::atomic<block_t*> remote[SIZE_CLASSES];
+
+        char remote_padding_[CACHE_LINE_SIZE];
+      };
+
+      /**
+       * \brief A heap used by the calling thread.
+       */
+      struct thread_heap_t {
+        uint64_t id;
+        slab_resource_t* resource;
+        heap_t* heap;
+      };
+
+      /**
+       * \struct thread_heaps_t
+       * \brief The heaps used by the calling thread, which are released
+       * when the thread exits so that other threads can adopt them.
+       */
+      struct thread_heaps_t {
+        std::vector<thread_heap_t> heaps;
+
+        ~thread_heaps_t() {
+          std::lock_guard<std::mutex> lock(registry_lock());
+          for (thread_heap_t& entry : heaps) {
+            if (is_alive(entry.id)) {
+              entry.resource->abandon(entry.heap);
+            }
+          }
+        }
+      };
+
+      /**
+       * \brief The last heap used by the calling thread.
+       */
+      struct cache_t {
+        uint64_t id;
+        heap_t* heap;
+      };
+
+    public:
+
+      /**
+       * \constructor
+       */
+      explicit slab_resource_t(memory_resource_t* upstream = new_delete_resource())
+        : upstream_(upstream), id_(next_id().fetch_add(1, std::memory_order_relaxed)), heaps_(nullptr) {
+        std::lock_guard<std::mutex> lock(registry_lock());
+        registry().push_back(id_);
+      }
+
+      /**
+       * \destructor
+       * \brief Releases every chunk to the upstream resource.
+       */
+      ~slab_resource_t() {
+        {
+          std::lock_guard<std::mutex> lock(registry_lock());
+          std::vector<uint64_t>& ids = registry();
+          ids.erase(std::find(ids.begin(), ids.end(), id_));
+        }
+        while (heaps_ != nullptr) {
+          heap_t* heap = heaps_;
+          heaps_ = heap->next;
+          for (void* chunk : heap->chunks) {
+            upstream_->deallocate(chunk, CHUNK_SIZE);
+          }
+          for (void* chunk : heap->spare) {
+            upstream_->deallocate(chunk, CHUNK_SIZE);
+          }
+          delete heap;
+        }
+      }
+
+      /**
+       * \brief A resource is non-copyable.
+       */
+      slab_resource_t(const slab_resource_t&) = delete;
+
+      /**
+       * \brief A resource is non-copyable.
+       */
+      slab_resource_t& operator=(const slab_resource_t&) = delete;
+
+      /**
+       * \brief Hands the blocks released by the calling thread on behalf
+       * of other threads over to them, which should be done before the
+       * calling thread stops releasing blocks for a while.
+       */
+      void flush() noexcept {
+        heap_t* heap = thread_cache().id == id_ ? thread_cache().heap : nullptr;
+        for (size_t i = 0; heap == nullptr && i < thread_heaps().heaps.size(); ++i) {
+          if (thread_heaps().heaps[i].id == id_) {
+            heap = thread_heaps().heaps[i].heap;
+          }
+        }
+        for (size_t i = 0; heap != nullptr && i < BATCHES; ++i) {
+          hand_over(heap->batches[i]);
+        }
+      }
+
+      /**
+       * \return the number of bytes of slab memory used by an allocation
+       * of `bytes` bytes, including the header of its block.
+       */
+      static size_t footprint(size_t bytes) noexcept {
+        return (is_small(bytes, DEFAULT_ALIGNMENT) ? block_size(size_class_of(bytes)) : bytes);
+      }
+
+      /**
+       * \brief Creates `heaps` heaps holding `bytes` bytes of chunks each,
+       * which are adopted by the next threads allocating from the resource
+       * for the first time, so that these threads carve their blocks out of
+       * the reserved chunks rather than requesting new ones upstream.
+       */
+      void reserve(size_t heaps, size_t bytes) {
+        size_t chunks = (bytes + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        for (size_t i = 0; i < heaps; ++i) {
+          std::unique_ptr<heap_t> heap(new heap_t());
+          heap->abandoned = true;
+          heap->chunks.reserve(chunks);
+          heap->spare.reserve(chunks);
+          try {
+            for (size_t j = 0; j < chunks; ++j) {
+              heap->spare.push_back(upstream_->allocate(CHUNK_SIZE));
+            }
+          } catch (...) {
+            for (void* chunk : heap->spare) {
+              upstream_->deallocate(chunk, CHUNK_SIZE);
+            }
+            throw;
+          }
+          std::lock_guard<std::mutex> lock(lock_);
+          heap->next = heaps_;
+          heaps_ = heap.release();
+        }
+      }
+
+    protected:
+
+      void* do_allocate(size_t bytes, size_t alignment) override {
+        if (!is_small(bytes, alignment)) {
+          return (upstream_->allocate(bytes, alignment));
+        }
+        size_t size_class = size_class_of(bytes);
+        heap_t* heap = local_heap();
+        block_t*& free = heap->free[size_class];
+        if (free == nullptr) {
+          free = heap->remote[size_class].exchange(nullptr, std::memory_order_acquire);
+          if (free == nullptr) {
+            refill(heap, size_class);
+          }
+        }
+        block_t* block = free;
+        free = block->next;
+        return (block);
+      }
+
+      void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (!is_small(bytes, alignment)) {
+          upstream_->deallocate(ptr, bytes, alignment);
+          return;
+        }
+        size_t size_class = size_class_of(bytes);
+        block_t* block = static_cast<block_t*>(ptr);
+        heap_t* owner = header_of(block)->owner;
+        heap_t* heap = local_heap();
+        if (owner == heap) {
+          block->next = heap->free[size_class];
+          heap->free[size_class] = block;
+          return;
+        }
+        batch_t& batch = heap->batches[(reinterpret_cast<uintptr_t>(owner) / sizeof(heap_t) + size_class) % BATCHES];
+        if (batch.owner != owner || batch.size_class != size_class) {
+          hand_over(batch);
+          batch.owner = owner;
+          batch.size_class = size_class;
+        }
+        block->next = batch.head;
+        batch.head = block;
+        if (batch.tail == nullptr) {
+          batch.tail = block;
+        }
+        if (++batch.count >= BATCH_SIZE) {
+          hand_over(batch);
+        }
+      }
+
+      bool do_is_equal(const memory_resource_t& other) const noexcept override {
+        return (this == &other);
+      }
+
+    private:
+
+      /**
+       * \return whether an allocation is served from the slabs.
+       */
+      static bool is_small(size_t bytes, size_t alignment) noexcept {
+        return (bytes <= MAX_BLOCK_SIZE - HEADER_SIZE && alignment <= DEFAULT_ALIGNMENT);
+      }
+
+      /**
+       * \return the size class of the blocks able to hold `bytes` bytes.
+       */
+      static size_t size_class_of(size_t bytes) noexcept {
+        size_t size_class = 0;
+        while (block_size(size_class) < bytes + HEADER_SIZE) {
+          ++size_class;
+        }
+        return (size_class);
+      }
+
+      /**
+       * \return the size of the blocks of the given size class.
+       */
+      static size_t block_size(size_t size_class) noexcept {
+        return ((size_class % 2 ? MIN_BLOCK_SIZE + MIN_BLOCK_SIZE / 2 : MIN_BLOCK_SIZE) << (size_class / 2));
+      }
+
+      /**
+       * \return the header of the given block.
+       */
+      static header_t* header_of(block_t* block) noexcept {
+        return (reinterpret_cast<header_t*>(reinterpret_cast<char*>(block) - HEADER_SIZE));
+      }
+
+      /**
+       * \brief Carves a new chunk in blocks of the given size class.
+       */
+      void refill(heap_t* heap, size_t size_class) {
+        heap->chunks.reserve(heap->chunks.size() + 1);
+        char* chunk = nullptr;
+        if (!heap->spare.empty()) {
+          chunk = static_cast<char*>(heap->spare.back());
+          heap->spare.pop_back();
+        } else {
+          chunk = static_cast<char*>(upstream_->allocate(CHUNK_SIZE));
+        }
+        heap->chunks.push_back(chunk);
+        size_t size = block_size(size_class);
+        block_t* free = nullptr;
+        for (size_t offset = CHUNK_SIZE; offset >= size; offset -= size) {
+          char* start = chunk + offset - size;
+          reinterpret_cast<header_t*>(start)->owner = heap;
+          block_t* block = reinterpret_cast<block_t*>(start + HEADER_SIZE);
+          block->next = free;
+          free = block;
+        }
+        heap->free[size_class] = free;
+      }
+
+      /**
+       * \brief Hands the blocks of a batch over to the heap owning them.
+       */
+      static void hand_over(batch_t& batch) noexcept {
+        if (batch.head != nullptr) {
+          std::atomic<block_t*>& remote = batch.owner->remote[batch.size_class];
+          block_t* head = remote.load(std::memory_order_relaxed);
+          do {
+            batch.tail->next = head;
+          } while (!remote.compare_exchange_weak(head, batch.head, std::memory_order_release, std::memory_order_relaxed));
+        }
+        batch.head = batch.tail = nullptr;
+        batch.count = 0;
+      }
+
+      /**
+       * \return the heap of the calling thread.
+       */
+      heap_t* local_heap() {
+        cache_t& cache = thread_cache();
+        if (cache.id != id_) {
+          cache.heap = attach();
+          cache.id = id_;
+        }
+        return (cache.heap);
+      }
+
+      /**
+       * \brief Looks up the heap of the calling thread, adopting the heap
+       * of a thread which has exited or creating one if there is none.
+       */
+      heap_t* attach() {
+        std::vector<thread_heap_t>& heaps = thread_heaps().heaps;
+        for (const thread_heap_t& entry : heaps) {
+          if (entry.id == id_) {
+            return (entry.heap);
+          }
+        }
+        {
+          // Forgetting about the heaps of the resources which are gone.
+          std::lock_guard<std::mutex> lock(registry_lock());
+          heaps.erase(std::remove_if(heaps.begin(), heaps.end(), [] (const thread_heap_t& entry) {
+            return (!is_alive(entry.id));
+          }), heaps.end());
+        }
+        heaps.reserve(heaps.size() + 1);
+        std::lock_guard<std::mutex> lock(lock_);
+        // Adopting the heaps holding reserved chunks first.
+        heap_t* heap = nullptr;
+        for (heap_t* it = heaps_; it != nullptr; it = it->next) {
+          if (it->abandoned && (heap == nullptr || (heap->spare.empty() && !it->spare.empty()))) {
+            heap = it;
+          }
+        }
+        if (heap == nullptr) {
+          heap = new heap_t();
+          heap->next = heaps_;
+          heaps_ = heap;
+        }
+        heap->abandoned = false;
+        heaps.push_back(thread_heap_t{ id_, this, heap });
+        return (heap);
+      }
+
+      /**
+       * \brief Called when the thread owning `heap` exits.
+       */
+      void abandon(heap_t* heap) noexcept {
+        for (size_t i = 0; i < BATCHES; ++i) {
+          hand_over(heap->batches[i]);
+        }
+        std::lock_guard<std::mutex> lock(lock_);
+        heap->abandoned = true;
+      }
+
+      /**
+       * \return whether the resource identified by `id` still exists,
+       * which must be called with the registry lock held.
+       */
+      static bool is_alive(uint64_t id) {
+        const std::vector<uint64_t>& ids = registry();
+        return (std::find(ids.begin(), ids.end(), id) != ids.end());
+      }
+
+      /**
+       * \brief Identifiers are never reused, so that a thread never
+       * mistakes a new resource for one which has been destroyed.
+       */
+      static std::atomic<uint64_t>& next_id() {
+        static std::atomic<uint64_t> id(1);
+        return (id);
+      }
+
+      /**
+       * \brief The identifiers of the existing resources.
+       */
+      static std::vector<uint64_t>& registry() {
+        static std::vector<uint64_t> ids;
+        return (ids);
+      }
+
+      /**
+       * \brief Lock guarding the registry, which threads which are exiting
+       * take to release their heaps while their resource still exists.
+       */
+      static std::mutex& registry_lock() {
+        static std::mutex lock;
+        return (lock);
+      }
+
+      static thread_heaps_t& thread_heaps() {
+        static thread_local thread_heaps_t heaps;
+        return (heaps);
+      }
+
+      static cache_t& thread_cache() {
+        static thread_local cache_t cache = { 0, nullptr };
+        return (cache);
+      }
+
+      /**
+       * \brief The resource chunks are allocated from.
+       */
+      memory_resource_t* upstream_;
+
+      /**
+       * \brief The identifier of the resource.
+       */
+      const uint64_t id_;
+
+      /**
+       * \brief Lock guarding the list of heaps.
+       */
+      std::mutex lock_;
+
+      /**
+       * \brief Every heap created by the resource.
+       */
+      heap_t* heaps_;
+    };
+  };
+};
+
+#endif // THREAD_POOL_SLAB_H_
@@ -0,0 +1,561 @@
+#ifndef THREAD_POOL_TASK_H_
+#define THREAD_POOL_TASK_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "thread_pool_memory.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \class task_t
+     * \brief A move-only callable taking no arguments, which is the unit
+     * of work stored in the queue of a thread pool. Callables which are
+     * small enough, and which cannot throw when moved, are stored inline
+     * within the task, other ones are allocated from a memory resource.
+     */
+    class task_t {
+
+      /**
+       * \brief Operations on the stored callable. Callables which are
+       * trivially copyable have no `move` and no `destroy` operation, and
+       * are relocated by copying the storage of the task.
+       */
+      struct vtable_t {
+        void (*invoke)(void* storage);
+        void (*move)(void* to, void* from) noexcept;
+        void (*destroy)(void* storage) noexcept;
+      };
+
+      /**
+       * \brief Operations on a callable stored within the task.
+       */
+      template <typename F>
+      struct inline_t {
+        static void invoke(void* storage) {
+          (*static_cast<F*>(storage))();
+        }
+
+        static void move(void* to, void* from) noexcept {
+          new (to) F(std::move(*static_cast<F*>(from)));
+          static_cast<F*>(from)->~F();
+        }
+
+        static void destroy(void* storage) noexcept {
+          static_cast<F*>(storage)->~F();
+        }
+
+        static const vtable_t vtable;
+      };
+
+      /**
+       * \brief Operations on a trivially copyable callable stored within the task.
+       */
+      template <typename F>
+      struct trivial_t {
+        static void invoke(void* storage) {
+          (*static_cast<F*>(storage))();
+        }
+
+        static const vtable_t vtable;
+      };
+
+      /**
+       * \brief Location of a callable allocated from a resource.
+       */
+      struct allocated_t {
+        void* callable;
+        memory_resource_t* resource;
+      };
+
+      /**
+       * \brief Operations on a callable allocated from a resource.
+       */
+      template <typename F>
+      struct heap_t {
+        static void invoke(void* storage) {
+          (*static_cast<F*>(static_cast<allocated_t*>(storage)->callable))();
+        }
+
+        static void destroy(void* storage) noexcept {
+          allocated_t* allocated = static_cast<allocated_t*>(storage);
+          static_cast<F*>(allocated->callable)->~F();
+          allocated->resource->deallocate(allocated->callable, sizeof(F), alignof(F));
+        }
+
+        static const vtable_t vtable;
+      };
+
+    public:
+
+      /**
+       * \brief The size of the storage available to callables
+       * within a task, which keeps a task on a single cache line.
+       */
+      static const size_t INLINE_SIZE = 48;
+
+      /**
+       * \brief The number of low bits of the stamp of a task holding its
+       * enqueue time, the remaining bits holding the label of the task.
+       * Enqueue times wrap around every 2^48 nanoseconds, about 78 hours,
+       * which leaves the difference between two times exact, as long as
+       * it is computed modulo `STAMP_MASK + 1`.
+       */
+      static const unsigned STAMP_BITS = 48;
+
+      /**
+       * \brief The mask of the bits of the stamp holding the enqueue time.
+       */
+      static const uint64_t STAMP_MASK = (uint64_t(1) << STAMP_BITS) - 1;
+
+      /**
+       * \return whether a callable of type `F` is stored within a task.
+       */
+      template <typename F>
+      static constexpr bool is_inline() {
+        return (sizeof(F) <= INLINE_SIZE
+          && alignof(F) <= alignof(std::max_align_t)
+          && std::is_nothrow_move_constructible<F>::value);
+      }
+
+      /**
+       * \constructor
+       * \brief Creates an empty task.
+       */
+      task_t() noexcept
+        : vtable_(nullptr), stamp_(0) {}
+
+      /**
+       * \constructor
+       * \brief Creates a task storing `f`, allocated from `resource`
+       * if it cannot be stored inline.
+       */
+      template <typename F, typename Callable = typename std::decay<F>::type>
+      task_t(memory_resource_t* resource, F&& f)
+        : vtable_(nullptr), stamp_(0) {
+        store<Callable>(resource, std::forward<F>(f), std::integral_constant<bool, is_inline<Callable>()>());
+      }
+
+      /**
+       * \constructor
+       * \brief Takes over the callable of `other`, leaving it empty.
+       */
+      task_t(task_t&& other) noexcept
+        : vtable_(other.vtable_), stamp_(other.stamp_) {
+        if (vtable_ != nullptr) {
+          relocate(other);
+          other.vtable_ = nullptr;
+        }
+      }
+
+      /**
+       * \brief Destroys the current callable, and takes
+       * over the callable of `other`, leaving it empty.
+       */
+      task_t& operator=(task_t&& other) noexcept {
+        if (this != &other) {
+          reset();
+          if (other.vtable_ != nullptr) {
+            vtable_ = other.vtable_;
+            relocate(other);
+            other.vtable_ = nullptr;
+          }
+          stamp_ = other.stamp_;
+        }
+        return (*this);
+      }
+
+      /**
+       * \destructor
+       */
+      ~task_t() {
+        reset();
+      }
+
+      /**
+       * \brief A task is non-copyable.
+       */
+      task_t(const task_t&) = delete;
+
+      /**
+       * \brief A task is non-copyable.
+       */
+      task_t& operator=(const task_t&) = delete;
+
+      /**
+       * \brief Invokes the stored callable.
+       */
+      void operator()() {
+        vtable_->invoke(&storage_);
+      }
+
+      /**
+       * \return whether the task stores a callable.
+       */
+      explicit operator bool() const noexcept {
+        return (vtable_ != nullptr);
+      }
+
+      /**
+       * \return the time at which the task has been enqueued, as given
+       * by the metrics policy of the pool and truncated to `STAMP_BITS`
+       * bits, or zero if it was not recorded.
+       */
+      uint64_t stamp() const noexcept {
+        return (stamp_ & STAMP_MASK);
+      }
+
+      /**
+       * \brief Records the time at which the task is enqueued.
+       */
+      void stamp(uint64_t stamp) noexcept {
+        stamp_ = (stamp_ & ~STAMP_MASK) | (stamp & STAMP_MASK);
+      }
+
+      /**
+       * \return the identifier of the label of the task,
+       * which is zero for unlabeled tasks.
+       */
+      uint16_t label() const noexcept {
+        return (static_cast<uint16_t>(stamp_ >> STAMP_BITS));
+      }
+
+      /**
+       * \brief Sets the identifier of the label of the task.
+       */
+      void label(uint16_t label) noexcept {
+        stamp_ = (uint64_t(label) << STAMP_BITS) | (stamp_ & STAMP_MASK);
+      }
+
+      /**
+       * \brief Destroys the stored callable.
+       */
+      void reset() noexcept {
+        if (vtable_ != nullptr) {
+          if (vtable_->destroy != nullptr) {
+            vtable_->destroy(&storage_);
+          }
+          vtable_ = nullptr;
+        }
+      }
+
+    private:
+
+      /**
+       * \brief Moves the callable of `other` to this task,
+       * which uses the same operations.
+       */
+      void relocate(task_t& other) noexcept {
+        if (vtable_->move != nullptr) {
+          vtable_->move(&storage_, &other.storage_);
+        } else {
+          storage_ = other.storage_;
+        }
+      }
+
+      template <typename Callable, typename F>
+      void store(memory_resource_t*, F&& f, std::true_type) {
+        new (&storage_) Callable(std::forward<F>(f));
+        vtable_ = std::is_trivially_copyable<Callable>::value
+          ? &trivial_t<Callable>::vtable
+          : &inline_t<Callable>::vtable;
+      }
+
+      template <typename Callable, typename F>
+      void store(memory_resource_t* resource, F&& f, std::false_type) {
+        void* callable = resource->allocate(sizeof(Callable), alignof(Callable));
+        try {
+          new (callable) Callable(std::forward<F>(f));
+        } catch (...) {
+          resource->deallocate(callable, sizeof(Callable), alignof(Callable));
+          throw;
+        }
+        new (&storage_) allocated_t{ callable, resource };
+        vtable_ = &heap_t<Callable>::vtable;
+      }
+
+      /**
+       * \brief Storage of the callable, or of its location.
+       */
+      typename std::aligned_storage<INLINE_SIZE, alignof(std::max_align_t)>::type storage_;
+
+      /**
+       * \brief Operations on the stored callable, null for an empty task.
+       */
+      const vtable_t* vtable_;
+
+      /**
+       * \brief The time at which the task has been enqueued, and the label
+       * of the task, which live within the padding a task has anyway.
+       */
+      uint64_t stamp_;
+    };
+
+    template <typename F>
+    const task_t::vtable_t task_t::inline_t<F>::vtable = {
+      &task_t::inline_t<F>::invoke, &task_t::inline_t<F>::move, &task_t::inline_t<F>::destroy
+    };
+
+    template <typename F>
+    const task_t::vtable_t task_t::trivial_t<F>::vtable = {
+      &task_t::trivial_t<F>::invoke, nullptr, nullptr
+    };
+
+    template <typename F>
+    const task_t::vtable_t task_t::heap_t<F>::vtable = {
+      &task_t::heap_t<F>::invoke, nullptr, &task_t::heap_t<F>::destroy
+    };
+
+    /**
+     * \brief Stores the result of `function`, or the exception
+     * it has thrown, in `promise`.
+     */
+    template <typename R, typename F>
+    void fulfill(std::promise<R>& promise, F& function) {
+      try {
+        promise.set_value(function());
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+      }
+    }
+
+    /**
+     * \brief Calls `function` and signals its completion, or
+     * the exception it has thrown, to `promise`.
+     */
+    template <typename F>
+    void fulfill(std::promise<void>& promise, F& function) {
+      try {
+        function();
+        promise.set_value();
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+      }
+    }
+
+    /**
+     * \struct promise_task_t
+     * \brief A callable whose result is delivered to a future.
+     */
+    template <typename R, typename F>
+    struct promise_task_t {
+      F function;
+      std::promise<R> promise;
+
+      void operator()() {
+        fulfill(promise, function);
+      }
+    };
+
+    /**
+     * \class task_iterator_t
+     * \brief An iterator adaptor wrapping the callables read
+     * from `It` in tasks, as they are being enqueued.
+     */
+    template <typename It>
+    class task_iterator_t {
+    public:
+
+      task_iterator_t(It it, memory_resource_t* resource, uint64_t stamp = 0)
+        : it_(it), resource_(resource), stamp_(stamp) {}
+
+      task_t operator*() const {
+        task_t task(resource_, *it_);
+        task.stamp(stamp_);
+        return (task);
+      }
+
+      task_iterator_t& operator++() {
+        ++it_;
+        return (*this);
+      }
+
+      task_iterator_t operator++(int) {
+        task_iterator_t previous(*this);
+        ++it_;
+        return (previous);
+      }
+
+    private:
+
+      It it_;
+      memory_resource_t* resource_;
+      uint64_t stamp_;
+    };
+
+    /**
+     * \return an iterator wrapping the callables read from `it` in
+     * tasks, which are stamped with the given enqueue time.
+     */
+    template <typename It>
+    task_iterator_t<It> make_task_iterator(It it, memory_resource_t* resource, uint64_t stamp = 0) {
+      return (task_iterator_t<It>(it, resource, stamp));
+    }
+
+    /**
+     * \class generator_iterator_t
+     * \brief An iterator yielding the callables returned by
+     * successive calls to a generator.
+     */
+    template <typename G>
+    class generator_iterator_t {
+    public:
+
+      explicit generator_iterator_t(G& generator)
+        : generator_(&generator) {}
+
+      auto operator*() const -> decltype(std::declval<G&>()()) {
+        return ((*generator_)());
+      }
+
+      generator_iterator_t& operator++() {
+        return (*this);
+      }
+
+      generator_iterator_t operator++(int) {
+        return (*this);
+      }
+
+    private:
+
+      G* generator_;
+    };
+
+    /**
+     * \class shared_callable_t
+     * \brief A callable shared by many tasks, allocated from a resource,
+     * and released along with the last task referencing it.
+     */
+    template <typename F>
+    class shared_callable_t {
+    public:
+
+      /**
+       * \return a new shared callable holding `f`, which
+       * is referenced once by the caller.
+       */
+      template <typename G>
+      static shared_callable_t* create(memory_resource_t* resource, G&& f) {
+        void* memory = resource->allocate(sizeof(shared_callable_t), alignof(shared_callable_t));
+        try {
+          return (new (memory) shared_callable_t(resource, std::forward<G>(f)));
+        } catch (...) {
+          resource->deallocate(memory, sizeof(shared_callable_t), alignof(shared_callable_t));
+          throw;
+        }
+      }
+
+      /**
+       * \brief Invokes the callable with `index`, which may happen from
+       * several threads at once, hence the callable is invoked as const.
+       */
+      void operator()(size_t index) const {
+        function_(index);
+      }
+
+      void acquire() noexcept {
+        references_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      void release() noexcept {
+        if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          memory_resource_t* resource = resource_;
+          this->~shared_callable_t();
+          resource->deallocate(this, sizeof(shared_callable_t), alignof(shared_callable_t));
+        }
+      }
+
+    private:
+
+      template <typename G>
+      shared_callable_t(memory_resource_t* resource, G&& f)
+        : function_(std::forward<G>(f)), references_(1), resource_(resource) {}
+
+      const F function_;
+      std::atomic<size_t> references_;
+      memory_resource_t* resource_;
+    };
+
+    /**
+     * \class index_task_t
+     * \brief A callable invoking a shared callable with an index, which
+     * is small enough to be stored inline within a task.
+     */
+    template <typename F>
+    class index_task_t {
+    public:
+
+      index_task_t(shared_callable_t<F>* shared, size_t index) noexcept
+        : shared_(shared), index_(index) {
+        shared_->acquire();
+      }
+
+      index_task_t(index_task_t&& other) noexcept
+        : shared_(other.shared_), index_(other.index_) {
+        other.shared_ = nullptr;
+      }
+
+      ~index_task_t() {
+        if (shared_ != nullptr) {
+          shared_->release();
+        }
+      }
+
+      index_task_t(const index_task_t&) = delete;
+      index_task_t& operator=(const index_task_t&) = delete;
+
+      void operator()() {
+        (*shared_)(index_);
+      }
+
+    private:
+
+      shared_callable_t<F>* shared_;
+      size_t index_;
+    };
+
+    /**
+     * \class index_iterator_t
+     * \brief An iterator yielding callables which invoke
+     * a shared callable with successive indices.
+     */
+    template <typename F>
+    class index_iterator_t {
+    public:
+
+      index_iterator_t(shared_callable_t<F>* shared, size_t index)
+        : shared_(shared), index_(index) {}
+
+      index_task_t<F> operator*() const {
+        return (index_task_t<F>(shared_, index_));
+      }
+
+      index_iterator_t& operator++() {
+        ++index_;
+        return (*this);
+      }
+
+      index_iterator_t operator++(int) {
+        index_iterator_t previous(*this);
+        ++index_;
+        return (previous);
+      }
+
+    private:
+
+      shared_callable_t<F>* shared_;
+      size_t index_;
+    };
+  };
+};
+
+#endif // THREAD_POOL_TASK_H_
@@ -0,0 +1,394 @@
+#ifndef THREAD_POOL_TRACE_H_
+#define THREAD_POOL_TRACE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "thread_pool_metrics.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \brief The kinds of events recorded by a tracer.
+     */
+    enum class trace_event_type_t : uint8_t {
+      ENQUEUE,
+      DEQUEUE,
+      START,
+      END
+    };
+
+    /**
+     * \struct trace_event_t
+     * \brief An event read from the rings of a tracer.
+     */
+    struct trace_event_t {
+
+      /**
+       * \brief The time of the event, in nanoseconds since
+       * the creation of the tracer.
+       */
+      uint64_t time;
+
+      /**
+       * \brief The kind of event.
+       */
+      trace_event_type_t type;
+
+      /**
+       * \brief The number of tasks enqueued or dequeued.
+       */
+      uint32_t count;
+
+      /**
+       * \brief The label of the task, or a null pointer.
+       */
+      const char* label;
+
+      /**
+       * \brief The index of the ring, which stands
+       * for the thread which recorded the event.
+       */
+      size_t thread;
+    };
+
+    /**
+     * \class trace_ring_t
+     * \brief A bounded ring of events written by a single thread, which
+     * overwrites its oldest events once it is full, so that tracing can
+     * stay enabled indefinitely. Recording an event involves no lock and
+     * no atomic read-modify-write, and the ring can be read by any thread
+     * at any time. Events overwritten while being read are discarded.
+     */
+    class trace_ring_t {
+
+      /**
+       * \brief A slot of the ring, whose fields are relaxed atomics
+       * so that a reader never sees a torn value.
+       */
+      struct slot_t {
+        std::atomic<uint64_t> time;
+        std::atomic<uint64_t> info;
+        std::atomic<const char*> label;
+      };
+
+    public:
+
+      /**
+       * \constructor
+       * \brief Creates a ring of `capacity` events, rounded up
+       * to a power of two.
+       */
+      trace_ring_t(size_t capacity, std::string name)
+        : mask_(round_up(capacity) - 1),
+          slots_(new slot_t[mask_ + 1]),
+          head_(0),
+          name_(std::move(name)) {}
+
+      /**
+       * \brief Records an event, which must be called by the owning thread.
+       */
+      void record(uint64_t time, trace_event_type_t type, uint32_t count, const char* label = nullptr) noexcept {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        slot_t& slot = slots_[head & mask_];
+        slot.time.store(time, std::memory_order_relaxed);
+        slot.info.store((uint64_t(count) << 8) | static_cast<uint8_t>(type), std::memory_order_relaxed);
+        slot.label.store(label, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+      }
+
+      /**
+       * \brief Appends the events held by the ring, from the
+       * oldest to the newest one, to `events`. Since the writer may be
+       * overwriting the oldest slot of a full ring, at most `capacity - 1`
+       * events are read from it.
+       */
+      void read(size_t thread, std::vector<trace_event_t>& events) const {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t first = head > mask_ + 1 ? head - (mask_ + 1) : 0;
+        size_t size = events.size();
+        for (uint64_t i = first; i < head; ++i) {
+          const slot_t& slot = slots_[i & mask_];
+          uint64_t info = slot.info.load(std::memory_order_relaxed);
+          events.push_back(trace_event_t{
+            slot.time.load(std::memory_order_relaxed),
+            static_cast<trace_event_type_t>(info & 0xff),
+            static_cast<uint32_t>(info >> 8),
+            slot.label.load(std::memory_order_relaxed),
+            thread
+          });
+        }
+        // Discarding the events the writer may have overwritten meanwhile,
+        // including the one whose slot holds the unpublished event `last`.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t last = head_.load(std::memory_order_relaxed);
+        uint64_t overwritten = last > mask_ ? last - mask_ : 0;
+        if (overwritten > first) {
+          size_t stale = static_cast<size_t>(overwritten - first);
+          stale = stale < head - first ? stale : static_cast<size_t>(head - first);
+          events.erase(events.begin() + size, events.begin() + size + stale);
+        }
+      }
+
+      /**
+       * \return the name of the thread owning the ring.
+       */
+      const std::string& name() const noexcept {
+        return (name_);
+      }
+
+    private:
+
+      static size_t round_up(size_t capacity) noexcept {
+        size_t size = 1;
+        while (size < capacity) {
+          size <<= 1;
+        }
+        return (size);
+      }
+
+      const uint64_t mask_;
+      std::unique_ptr<slot_t[]> slots_;
+      std::atomic<uint64_t> head_;
+      const std::string name_;
+    };
+
+    /**
+     * \class tracer_t
+     * \brief Records the timeline of the tasks of a pool into one ring per
+     * thread, which are created the first time a thread records an event,
+     * and exports it in the Chrome Trace Event format, which can be loaded
+     * by `chrome://tracing` and by the Perfetto UI.
+     */
+    class tracer_t {
+    public:
+
+      /**
+       * \constructor
+       * \brief Creates a tracer whose rings hold `capacity` events each.
+       */
+      explicit tracer_t(size_t capacity)
+        : id_(next_id()), capacity_(capacity > 0 ? capacity : 1), origin_(steady_now()), producers_(0) {}
+
+      /**
+       * \return the ring of the given worker, which must be
+       * called once by each worker when it starts.
+       */
+      trace_ring_t& worker_ring(size_t worker) {
+        return (*ring("worker " + std::to_string(worker)));
+      }
+
+      /**
+       * \brief Records an event on the ring of the calling thread. The
+       * event is dropped if the ring of the thread cannot be created.
+       */
+      void record(trace_event_type_t type, uint32_t count, const char* label = nullptr) noexcept {
+        try {
+          local_ring()->record(now(), type, count, label);
+        } catch (std::exception&) {}
+      }
+
+      /**
+       * \return the time elapsed since the creation of
+       * the tracer, in nanoseconds.
+       */
+      uint64_t now() const noexcept {
+        return (steady_now() - origin_);
+      }
+
+      /**
+       * \return the events held by every ring.
+       */
+      std::vector<trace_event_t> events() const {
+        std::vector<trace_event_t> events;
+        std::lock_guard<std::mutex> lock(lock_);
+        for (size_t i = 0; i < rings_.size(); ++i) {
+          rings_[i]->read(i, events);
+        }
+        return (events);
+      }
+
+      /**
+       * \brief Writes the events held by every ring as a Chrome Trace Event
+       * JSON document. Tasks are written as duration events on the thread
+       * which ran them, and enqueue and dequeue operations as instant events
+       * on the thread which performed them.
+       */
+      void write_chrome_trace(std::ostream& stream) const {
+        std::vector<trace_event_t> events = this->events();
+        std::vector<std::string> names;
+        {
+          std::lock_guard<std::mutex> lock(lock_);
+          for (const std::shared_ptr<trace_ring_t>& ring : rings_) {
+            names.push_back(ring->name());
+          }
+        }
+        stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        for (size_t i = 0; i < names.size(); ++i) {
+          stream << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << i
+                 << ",\"args\":{\"name\":";
+          write_string(stream, names[i].c_str());
+          stream << "}}";
+          first = false;
+        }
+        for (const trace_event_t& event : events) {
+          stream << (first ? "" : ",") << "\n{\"pid\":1,\"tid\":" << event.thread
+                 << ",\"ts\":" << event.time / 1000 << "." << pad(event.time % 1000);
+          switch (event.type) {
+            case trace_event_type_t::ENQUEUE:
+              stream << ",\"ph\":\"i\",\"s\":\"t\",\"name\":\"enqueue\",\"args\":{\"count\":" << event.count << "}}";
+              break;
+            case trace_event_type_t::DEQUEUE:
+              stream << ",\"ph\":\"i\",\"s\":\"t\",\"name\":\"dequeue\",\"args\":{\"count\":" << event.count << "}}";
+              break;
+            case trace_event_type_t::START:
+              stream << ",\"ph\":\"B\",\"name\":";
+              write_string(stream, event.label != nullptr ? event.label : "task");
+              stream << "}";
+              break;
+            case trace_event_type_t::END:
+              stream << ",\"ph\":\"E\"}";
+              break;
+          }
+          first = false;
+        }
+        stream << "\n]}\n";
+      }
+
+    private:
+
+      /**
+       * \struct local_ring_t
+       * \brief A ring used by a thread, cached along with the identifier
+       * of its tracer. The weak reference tells whether the tracer, which
+       * owns the ring, has been destroyed.
+       */
+      struct local_ring_t {
+        uint64_t tracer;
+        std::weak_ptr<trace_ring_t> owner;
+        trace_ring_t* ring;
+      };
+
+      /**
+       * \brief The rings used by a thread, by tracer.
+       */
+      using local_rings_t = std::vector<local_ring_t>;
+
+      /**
+       * \return a new identifier, which is never reused, unlike the
+       * address of a tracer, so that the rings cached by threads
+       * never refer to a destroyed tracer.
+       */
+      static uint64_t next_id() noexcept {
+        static std::atomic<uint64_t> id(0);
+        return (id.fetch_add(1, std::memory_order_relaxed) + 1);
+      }
+
+      /**
+       * \return the rings cached by the calling thread.
+       */
+      static local_rings_t& local_rings() {
+        static thread_local local_rings_t rings;
+        return (rings);
+      }
+
+      /**
+       * \return the ring of the calling thread, which is
+       * created the first time it records an event. The rings of the
+       * destroyed tracers are dropped from the cache of the thread before
+       * a ring is added to it, so that the cache only grows with the
+       * number of live tracers the thread records events on.
+       */
+      trace_ring_t* local_ring() {
+        local_rings_t& rings = local_rings();
+        for (const local_ring_t& entry : rings) {
+          if (entry.tracer == id_) {
+            return (entry.ring);
+          }
+        }
+        rings.erase(std::remove_if(rings.begin(), rings.end(), [] (const local_ring_t& entry) {
+          return (entry.owner.expired());
+        }), rings.end());
+        std::shared_ptr<trace_ring_t> created = ring("producer " + std::to_string(producers_.fetch_add(1, std::memory_order_relaxed)));
+        rings.push_back(local_ring_t{ id_, created, created.get() });
+        return (created.get());
+      }
+
+      /**
+       * \return a new ring with the given name.
+       */
+      std::shared_ptr<trace_ring_t> ring(std::string name) {
+        std::shared_ptr<trace_ring_t> ring = std::make_shared<trace_ring_t>(capacity_, std::move(name));
+        std::lock_guard<std::mutex> lock(lock_);
+        rings_.push_back(ring);
+        return (ring);
+      }
+
+      /**
+       * \return `value` padded with zeroes to three digits.
+       */
+      static std::string pad(uint64_t value) {
+        std::string digits = std::to_string(value);
+        return (std::string(3 - digits.size(), '0') + digits);
+      }
+
+      /**
+       * \brief Writes `value` as a JSON string.
+       */
+      static void write_string(std::ostream& stream, const char* value) {
+        stream << '"';
+        for (const char* c = value; *c != '\0'; ++c) {
+          if (*c == '"' || *c == '\\') {
+            stream << '\\' << *c;
+          } else if (static_cast<unsigned char>(*c) >= 0x20) {
+            stream << *c;
+          }
+        }
+        stream << '"';
+      }
+
+      /**
+       * \brief The identifier of the tracer.
+       */
+      const uint64_t id_;
+
+      /**
+       * \brief The number of events held by each ring.
+       */
+      const size_t capacity_;
+
+      /**
+       * \brief The time at which the tracer has been created.
+       */
+      const uint64_t origin_;
+
+      /**
+       * \brief The number of rings created for producers.
+       */
+      std::atomic<size_t> producers_;
+
+      /**
+       * \brief Lock guarding the list of rings.
+       */
+      mutable std::mutex lock_;
+
+      /**
+       * \brief Every ring of the tracer.
+       */
+      std::vector<std::shared_ptr<trace_ring_t>> rings_;
+    };
+  };
+};
+
+#endif // THREAD_POOL_TRACE_H_
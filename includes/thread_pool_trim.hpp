@@ -0,0 +1,139 @@
+#ifndef THREAD_POOL_TRIM_H_
+#define THREAD_POOL_TRIM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \brief Releases the memory a queue keeps around after a burst, for
+     * the queue backends which provide a `size_t trim()` method.
+     * \return the number of bytes released by the queue.
+     */
+    template <typename Queue>
+    auto trim_queue(Queue& queue, int) -> decltype(queue.trim()) {
+      return (queue.trim());
+    }
+
+    /**
+     * \brief Queue backends which do not provide a `trim()` method
+     * do not hold memory they could release.
+     */
+    template <typename Queue>
+    size_t trim_queue(Queue&, long) {
+      return (0);
+    }
+
+    /**
+     * \class trim_gate_t
+     * \brief Keeps producers and a trimming thread from running at the
+     * same time, since releasing the blocks of a queue is only safe when
+     * no enqueue operation is in progress. Producers announce themselves
+     * through a shared counter, which is why the gate is only enabled on
+     * pools which trim their queue automatically.
+     */
+    class trim_gate_t {
+
+      /**
+       * \brief Whether the gate is enabled.
+       */
+      const bool enabled_;
+
+      /**
+       * \brief Whether a thread is currently trimming the queue.
+       */
+      std::atomic<bool> trimming_;
+
+      /**
+       * \brief The number of enqueue operations in progress.
+       */
+      std::atomic<size_t> producers_;
+
+    public:
+
+      /**
+       * \class scope_t
+       * \brief Holds the gate open for a producer during its lifetime.
+       */
+      class scope_t {
+        trim_gate_t& gate_;
+
+      public:
+
+        explicit scope_t(trim_gate_t& gate)
+          : gate_(gate) {
+          if (gate_.enabled_) {
+            gate_.enter();
+          }
+        }
+
+        ~scope_t() {
+          if (gate_.enabled_) {
+            gate_.producers_.fetch_sub(1, std::memory_order_release);
+          }
+        }
+
+        scope_t(const scope_t&) = delete;
+        scope_t& operator=(const scope_t&) = delete;
+      };
+
+      /**
+       * \constructor
+       */
+      explicit trim_gate_t(bool enabled)
+        : enabled_(enabled), trimming_(false), producers_(0) {}
+
+      /**
+       * \return whether the gate is enabled.
+       */
+      bool enabled() const {
+        return (enabled_);
+      }
+
+      /**
+       * \brief Invokes `trim` if no producer is in the middle of an enqueue
+       * operation, while keeping new producers out.
+       * \return the value returned by `trim`, or zero if producers were
+       * active or another thread was already trimming.
+       */
+      template <typename F>
+      size_t try_trim(F trim) {
+        bool expected = false;
+        if (!trimming_.compare_exchange_strong(expected, true, std::memory_order_seq_cst)) {
+          return (0);
+        }
+        size_t released = 0;
+        if (producers_.load(std::memory_order_seq_cst) == 0) {
+          released = trim();
+        }
+        trimming_.store(false, std::memory_order_release);
+        return (released);
+      }
+
+    private:
+
+      /**
+       * \brief Registers a producer, waiting for a trim in progress to
+       * complete first.
+       */
+      void enter() {
+        for (;;) {
+          producers_.fetch_add(1, std::memory_order_seq_cst);
+          if (!trimming_.load(std::memory_order_seq_cst)) {
+            return;
+          }
+          producers_.fetch_sub(1, std::memory_order_relaxed);
+          while (trimming_.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    };
+  };
+};
+
+#endif // THREAD_POOL_TRIM_H_
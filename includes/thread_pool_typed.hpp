@@ -0,0 +1,284 @@
+#ifndef THREAD_POOL_TYPED_H_
+#define THREAD_POOL_TYPED_H_
+
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \struct call_task_t
+     * \brief The default handler of a typed pool, which
+     * invokes the tasks it is given as callables.
+     */
+    struct call_task_t {
+
+      template <typename Task>
+      void operator()(Task& task) const {
+        task();
+      }
+    };
+
+    /**
+     * \struct handle_task_t
+     * \brief The invoke step of a `typed_pool_t`, which hands the tasks to
+     * the handler of the pool through the metrics policy. Typed tasks carry
+     * no label, and no enqueue time from which to measure their queue wait.
+     */
+    template <typename Task, typename Handler>
+    struct handle_task_t {
+
+      /**
+       * \struct bound_t
+       * \brief A task bound to the handler, as run by the metrics policy.
+       */
+      struct bound_t {
+
+        static const uint64_t STAMP_MASK = task_t::STAMP_MASK;
+
+        const Handler& handler;
+        Task& task;
+
+        void operator()() const {
+          handler(task);
+        }
+
+        static uint64_t stamp() noexcept {
+          return (0);
+        }
+
+        static uint16_t label() noexcept {
+          return (0);
+        }
+      };
+
+      template <typename Metrics>
+      uint64_t run(Metrics& metrics, size_t worker, Task& task, uint64_t start) const {
+        bound_t bound{ handler, task };
+        return (metrics.run(worker, bound, start));
+      }
+
+      static uint16_t label(const Task&) noexcept {
+        return (0);
+      }
+
+      /**
+       * \brief The handler the tasks are given to.
+       */
+      Handler handler;
+    };
+
+    /**
+     * \struct typed_pool_t
+     * \brief A thread pool running a single kind of task. Its queue stores
+     * `Task` values as they are, rather than type-erased callables, and its
+     * workers hand each dequeued task to an instance of `Handler` which is
+     * known at compile time, so that the handler can be inlined within the
+     * worker loop. A task is typically a small trivially copyable value,
+     * such as a pointer to a record, which is copied in and out of the
+     * queue without any indirection or allocation.
+     *
+     * The handler is invoked as a const callable with a reference to each
+     * task, from several workers at once, and must not throw. `Task` must be
+     * default constructible and move assignable, since workers dequeue tasks
+     * into an array of `BULK_MAX_ITEMS` tasks. The workers are provided by
+     * the same `pool_core_t` as those of `parameterized_pool_t`, and the
+     * other template parameters and the options have the same meaning,
+     * except for `task_slabs` which does not apply to typed pools. Hooks
+     * are given a reference to the tasks, and metrics policies do not
+     * record the queue wait of typed tasks, which are not stamped.
+     */
+    template <
+      typename Task,
+      typename Handler = call_task_t,
+      size_t BULK_MAX_ITEMS = WORK_PARTITIONING_HEAVY,
+      milliseconds_t DEQUEUE_TIMEOUT = 1 * 1000,
+      typename IdlePolicy = spin_yield_park_t<>,
+      template <typename> class Queue = moodycamel_queue_t,
+      typename Metrics = no_metrics_t,
+      typename Hooks = no_hooks_t
+    >
+    struct typed_pool_t : public pool_core_t<Task, handle_task_t<Task, Handler>, BULK_MAX_ITEMS, DEQUEUE_TIMEOUT, IdlePolicy, Queue, Metrics, Hooks> {
+
+      static_assert(std::is_default_constructible<Task>::value, "typed pools require default constructible tasks");
+      static_assert(std::is_move_assignable<Task>::value, "typed pools require move assignable tasks");
+
+      /**
+       * \brief The core providing the workers of the pool.
+       */
+      using core_t = pool_core_t<Task, handle_task_t<Task, Handler>, BULK_MAX_ITEMS, DEQUEUE_TIMEOUT, IdlePolicy, Queue, Metrics, Hooks>;
+
+      /**
+       * \brief The type of the tasks run by the pool.
+       */
+      using task_type = Task;
+
+      /**
+       * \brief The type of the queue used to dispatch tasks to the workers.
+       */
+      using queue_t = typename core_t::queue_t;
+
+      /**
+       * \brief The producer token type associated with the queue.
+       */
+      using producer_token_t = typename core_t::producer_token_t;
+
+      /**
+       * \brief The consumer token type associated with the queue.
+       */
+      using consumer_token_t = typename core_t::consumer_token_t;
+
+      /**
+       * \constructor
+       * \brief Creates a new thread pool and allocates `concurrency`
+       * number of threads, which hand the tasks to `handler` and run
+       * `hooks` around them. Queue backends supporting a single consumer
+       * require a single worker and a single producer thread, as for
+       * `parameterized_pool_t`.
+       * \throw std::invalid_argument if the queue backend supports a single
+       * consumer and `concurrency` is not 1.
+       */
+      typed_pool_t(size_t concurrency, const pool_options_t& options = pool_options_t(), const Handler& handler = Handler(), const Hooks& hooks = Hooks())
+        : core_t(concurrency, options, false, handle_task_t<Task, Handler>{ handler }, hooks) {}
+
+      /**
+       * \brief Schedules a task, which is moved or copied into the queue.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename U>
+      bool schedule(const producer_token_t& token, U&& task) noexcept {
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue(token, std::forward<U>(task)) && wake(1));
+      }
+
+      /**
+       * \brief Schedules a task, which is moved or copied into the queue.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename U>
+      bool schedule(U&& task) noexcept {
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue(std::forward<U>(task)) && wake(1));
+      }
+
+      /**
+       * \brief Schedules an array of tasks, which are copied into the queue.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      bool schedule_bulk(const producer_token_t& token, const Task array[], size_t size) noexcept {
+        return (enqueue_bulk(token, array, size));
+      }
+
+      /**
+       * \brief Schedules an array of tasks, which are copied into the queue.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      bool schedule_bulk(const Task array[], size_t size) noexcept {
+        return (enqueue_bulk(array, size));
+      }
+
+      /**
+       * \brief Schedules the tasks in the range `[first, last)`, which are
+       * moved into the queue if the iterators yield rvalues, and are copied
+       * otherwise. The iterators must be forward iterators.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename It>
+      bool schedule_bulk(const producer_token_t& token, It first, It last) noexcept {
+        return (enqueue_bulk(token, first, static_cast<size_t>(std::distance(first, last))));
+      }
+
+      /**
+       * \brief Schedules the tasks in the range `[first, last)`, which are
+       * moved into the queue if the iterators yield rvalues, and are copied
+       * otherwise. The iterators must be forward iterators.
+       * \return a true value if the schedule operation was
+       * successful, false otherwise.
+       */
+      template <typename It>
+      bool schedule_bulk(It first, It last) noexcept {
+        return (enqueue_bulk(first, static_cast<size_t>(std::distance(first, last))));
+      }
+
+      /**
+       * \brief Blocks until every threads in the thread pool
+       * have been terminated.
+       */
+      typed_pool_t& await() {
+        core_t::join();
+        return (*this);
+      }
+
+      /**
+       * \brief Stops the execution of the threads allocated
+       * by the thread pool.
+       */
+      typed_pool_t& stop() noexcept {
+        core_t::halt();
+        return (*this);
+      }
+
+      /**
+       * \brief Pre-allocates the blocks of the queue needed to hold `tasks`
+       * tasks scheduled by `producers` threads without a token, and has the
+       * workers pre-fault their stack, under the same conditions as
+       * `parameterized_pool_t::reserve()`.
+       * \return false if the memory could not be allocated.
+       */
+      bool reserve(size_t tasks, size_t producers = 1) {
+        return (core_t::reserve_elements(tasks, producers > 0 ? producers : 1));
+      }
+
+      /**
+       * \return the handler the tasks are given to.
+       */
+      const Handler& handler() const noexcept {
+        return (core_t::invoke_.handler);
+      }
+
+    private:
+
+      using core_t::resource_;
+      using core_t::tasks_;
+      using core_t::gate_;
+      using core_t::wake;
+
+      /**
+       * \brief Enqueues `count` tasks read from `first`, and wakes
+       * up the workers needed to run them.
+       */
+      template <typename It>
+      bool enqueue_bulk(const producer_token_t& token, It first, size_t count) noexcept {
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue_bulk(token, first, count) && wake(count));
+      }
+
+      /**
+       * \brief Enqueues `count` tasks read from `first`, and wakes
+       * up the workers needed to run them.
+       */
+      template <typename It>
+      bool enqueue_bulk(It first, size_t count) noexcept {
+        trim_gate_t::scope_t scope(gate_);
+        resource_scope_t resource(resource_.get());
+        return (tasks_.enqueue_bulk(first, count) && wake(count));
+      }
+    };
+  };
+};
+
+#endif // THREAD_POOL_TYPED_H_
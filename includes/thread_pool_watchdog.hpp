@@ -0,0 +1,345 @@
+#ifndef THREAD_POOL_WATCHDOG_H_
+#define THREAD_POOL_WATCHDOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread_pool_label.hpp"
+
+namespace thread {
+
+  namespace pool {
+
+    /**
+     * \struct watchdog_event_t
+     * \brief A problem reported by the watchdog of a pool.
+     */
+    struct watchdog_event_t {
+
+      /**
+       * \brief The kinds of problems reported by the watchdog.
+       */
+      enum kind_t {
+
+        /**
+         * \brief A task has been running for longer than
+         * the slow task threshold.
+         */
+        SLOW_TASK,
+
+        /**
+         * \brief Every worker has been running the same task for longer
+         * than the stall threshold, while tasks are waiting in the queue.
+         */
+        STALL
+      };
+
+      /**
+       * \brief The kind of problem.
+       */
+      kind_t kind;
+
+      /**
+       * \brief The worker running the slow task, or the number
+       * of workers of the pool for a stall.
+       */
+      size_t worker;
+
+      /**
+       * \brief The label of the slow task, or a null pointer for a stall.
+       */
+      const char* label;
+
+      /**
+       * \brief How long the slow task has been running, or how long
+       * every worker has been busy for a stall. Since workers are
+       * sampled, this is a lower bound of the actual duration.
+       */
+      std::chrono::milliseconds elapsed;
+
+      /**
+       * \brief The approximate number of queued tasks.
+       */
+      size_t queue_depth;
+    };
+
+    /**
+     * \brief The callback invoked by the watchdog, from its own thread.
+     */
+    using watchdog_callback_t = std::function<void(const watchdog_event_t&)>;
+
+    /**
+     * \class heartbeat_t
+     * \brief The state a worker publishes to the watchdog: the sequence
+     * number of the task it runs, the label of that task, and whether it
+     * is running, packed into a single word. Publishing it is a relaxed
+     * store, and involves neither a read of the clock nor a fence, since
+     * the watchdog measures time by itself by sampling the word.
+     */
+    class heartbeat_t {
+    public:
+
+      heartbeat_t() noexcept
+        : state_(0), sequence_(0) {}
+
+      /**
+       * \brief Called by the owning worker before running a task.
+       */
+      void start(uint16_t label) noexcept {
+        state_.store((++sequence_ << 17) | (uint64_t(label) << 1) | 1, std::memory_order_relaxed);
+      }
+
+      /**
+       * \brief Called by the owning worker after having run a task.
+       */
+      void end() noexcept {
+        state_.store(sequence_ << 17, std::memory_order_relaxed);
+      }
+
+      /**
+       * \return the current state of the worker.
+       */
+      uint64_t load() const noexcept {
+        return (state_.load(std::memory_order_relaxed));
+      }
+
+      /**
+       * \return whether the given state stands for a running task.
+       */
+      static bool running(uint64_t state) noexcept {
+        return ((state & 1) != 0);
+      }
+
+      /**
+       * \return the label of the task of the given state.
+       */
+      static uint16_t label(uint64_t state) noexcept {
+        return (static_cast<uint16_t>(state >> 1));
+      }
+
+    private:
+
+      /**
+       * \brief The state sampled by the watchdog.
+       */
+      std::atomic<uint64_t> state_;
+
+      /**
+       * \brief The number of tasks started by the worker,
+       * which is only used by the worker itself.
+       */
+      uint64_t sequence_;
+
+      /**
+       * \brief Keeps the heartbeats of two workers from sharing a cache line.
+       */
+      char padding_[64 - sizeof(std::atomic<uint64_t>) - sizeof(uint64_t)];
+    };
+
+    /**
+     * \class watchdog_t
+     * \brief A thread sampling the heartbeats of the workers of a pool and
+     * the depth of its queue every period, which reports the tasks running
+     * for longer than a threshold, and the stalls of the pool, where every
+     * worker is stuck on a task while tasks are waiting in the queue. Each
+     * problem is reported once: a slow task until it ends, and a stall
+     * until a worker makes progress or the queue drains.
+     */
+    class watchdog_t {
+
+      /**
+       * \brief What the watchdog knows about a worker.
+       */
+      struct sample_t {
+        uint64_t state;
+        std::chrono::steady_clock::time_point since;
+        bool reported;
+      };
+
+    public:
+
+      /**
+       * \constructor
+       * \brief Starts watching `workers` workers, whose heartbeats are
+       * returned by `heartbeat()`. `depth` returns the number of queued
+       * tasks. A zero threshold disables the matching check, and a null
+       * callback logs problems to the standard error.
+       */
+      watchdog_t(size_t workers,
+                 std::chrono::milliseconds period,
+                 std::chrono::milliseconds slow_task,
+                 std::chrono::milliseconds stall,
+                 watchdog_callback_t callback,
+                 std::function<size_t()> depth)
+        : workers_(workers),
+          heartbeats_(new heartbeat_t[workers > 0 ? workers : 1]),
+          period_(period),
+          slow_task_(slow_task),
+          stall_(stall),
+          callback_(callback ? std::move(callback) : watchdog_callback_t(&log)),
+          depth_(std::move(depth)),
+          done_(false),
+          thread_(&watchdog_t::watch, this) {}
+
+      /**
+       * \destructor
+       * \brief Stops the watchdog thread.
+       */
+      ~watchdog_t() {
+        {
+          std::lock_guard<std::mutex> lock(lock_);
+          done_ = true;
+        }
+        wakeup_.notify_one();
+        thread_.join();
+      }
+
+      /**
+       * \brief A watchdog is non-copyable.
+       */
+      watchdog_t(const watchdog_t&) = delete;
+
+      /**
+       * \brief A watchdog is non-copyable.
+       */
+      watchdog_t& operator=(const watchdog_t&) = delete;
+
+      /**
+       * \return the heartbeat of the given worker.
+       */
+      heartbeat_t& heartbeat(size_t worker) noexcept {
+        return (heartbeats_[worker]);
+      }
+
+      /**
+       * \brief The default callback, which logs problems to the standard error.
+       */
+      static void log(const watchdog_event_t& event) {
+        if (event.kind == watchdog_event_t::SLOW_TASK) {
+          std::cerr << "[thread-pool] task '" << event.label << "' has been running on worker "
+            << event.worker << " for " << event.elapsed.count() << " ms (queue depth "
+            << event.queue_depth << ")" << std::endl;
+        } else {
+          std::cerr << "[thread-pool] all " << event.worker << " workers have been busy for "
+            << event.elapsed.count() << " ms with " << event.queue_depth << " queued tasks" << std::endl;
+        }
+      }
+
+    private:
+
+      /**
+       * \brief The watchdog thread.
+       */
+      void watch() {
+        std::vector<sample_t> samples(workers_, sample_t{ 0, std::chrono::steady_clock::now(), false });
+        bool stalled = false;
+        std::unique_lock<std::mutex> lock(lock_);
+        while (!wakeup_.wait_for(lock, period_, [this] () { return (done_); })) {
+          lock.unlock();
+          stalled = check(samples, stalled);
+          lock.lock();
+        }
+      }
+
+      /**
+       * \brief Samples the workers and the queue once.
+       * \return whether the pool is stalled.
+       */
+      bool check(std::vector<sample_t>& samples, bool stalled) {
+        auto now = std::chrono::steady_clock::now();
+        size_t depth = depth_();
+        std::chrono::milliseconds busy = std::chrono::milliseconds::max();
+        for (size_t i = 0; i < workers_; ++i) {
+          sample_t& sample = samples[i];
+          uint64_t state = heartbeats_[i].load();
+          if (state != sample.state) {
+            sample = sample_t{ state, now, false };
+          }
+          if (!heartbeat_t::running(state)) {
+            busy = std::chrono::milliseconds(0);
+            continue;
+          }
+          auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - sample.since);
+          busy = elapsed < busy ? elapsed : busy;
+          if (slow_task_.count() > 0 && elapsed >= slow_task_ && !sample.reported) {
+            sample.reported = true;
+            notify(watchdog_event_t{ watchdog_event_t::SLOW_TASK, i,
+              label_registry_t::instance().name(heartbeat_t::label(state)), elapsed, depth });
+          }
+        }
+        bool stall = workers_ > 0 && stall_.count() > 0 && depth > 0 && busy >= stall_;
+        if (stall && !stalled) {
+          notify(watchdog_event_t{ watchdog_event_t::STALL, workers_, nullptr, busy, depth });
+        }
+        return (stall);
+      }
+
+      /**
+       * \brief Invokes the callback, which must not
+       * bring the watchdog thread down.
+       */
+      void notify(const watchdog_event_t& event) noexcept {
+        try {
+          callback_(event);
+        } catch (...) {}
+      }
+
+      /**
+       * \brief The number of workers.
+       */
+      const size_t workers_;
+
+      /**
+       * \brief The heartbeat of each worker.
+       */
+      std::unique_ptr<heartbeat_t[]> heartbeats_;
+
+      /**
+       * \brief The period at which workers are sampled.
+       */
+      const std::chrono::milliseconds period_;
+
+      /**
+       * \brief The thresholds of slow tasks and stalls.
+       */
+      const std::chrono::milliseconds slow_task_;
+      const std::chrono::milliseconds stall_;
+
+      /**
+       * \brief The callback problems are reported to.
+       */
+      const watchdog_callback_t callback_;
+
+      /**
+       * \brief Returns the number of queued tasks.
+       */
+      const std::function<size_t()> depth_;
+
+      /**
+       * \brief Lock and condition waking the watchdog up when it stops.
+       */
+      std::mutex lock_;
+      std::condition_variable wakeup_;
+
+      /**
+       * \brief States whether the watchdog should stop.
+       */
+      bool done_;
+
+      /**
+       * \brief The watchdog thread, started last.
+       */
+      std::thread thread_;
+    };
+  };
+};
+
+#endif // THREAD_POOL_WATCHDOG_H_
@@ -0,0 +1,197 @@
+#include <iostream>
+#include <array>
+#include "../../includes/thread_pool.hpp"
+#include "../../includes/thread_pool_callable.hpp"
+#include "../../common/testing/allocation_counter.hpp"
+
+using testing::allocation_hooks_t;
+using testing::allocation_scope_t;
+
+/**
+ * \brief A pool whose workers report their allocations.
+ */
+using counted_pool_t = thread::pool::parameterized_pool_t<
+  thread::pool::WORK_PARTITIONING_HEAVY,
+  1 * 1000,
+  thread::pool::spin_yield_park_t<>,
+  thread::pool::moodycamel_queue_t,
+  thread::pool::no_metrics_t,
+  allocation_hooks_t
+>;
+
+/**
+ * \brief The number of operations per round.
+ */
+static const size_t OPERATIONS = 256;
+
+/**
+ * \brief The number of rounds run to reach the steady
+ * state, and the number of rounds measured.
+ */
+static const size_t WARMUP_ROUNDS = 16;
+static const size_t MEASURED_ROUNDS = 16;
+
+/**
+ * \brief The number of tasks run so far, and the number
+ * of tasks scheduled so far.
+ */
+static std::atomic<size_t> executed(0);
+static size_t scheduled = 0;
+
+static void increment() {
+  executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+static int identity(int value) {
+  executed.fetch_add(1, std::memory_order_relaxed);
+  return (value);
+}
+
+/**
+ * \brief Waits, without allocating, until every scheduled task has been run.
+ */
+static void drain() {
+  scheduled += OPERATIONS;
+  while (executed.load(std::memory_order_relaxed) < scheduled) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Runs `round`, which schedules `OPERATIONS` tasks, until the
+ * steady state is reached, and asserts that each operation then makes
+ * exactly `expected` allocations on the calling thread, and that the
+ * workers of `hooks`, unless it is null, make none.
+ */
+template <typename Round>
+static void assert_allocations(const char* name, const allocation_hooks_t* hooks, size_t expected, Round round) {
+  for (size_t i = 0; i < WARMUP_ROUNDS; ++i) {
+    round();
+  }
+  size_t workers = hooks != nullptr ? hooks->count() : 0;
+  allocation_scope_t scope;
+  for (size_t i = 0; i < MEASURED_ROUNDS; ++i) {
+    round();
+  }
+  size_t producer = scope.count();
+  // Leaving the workers the time to publish the allocations of their last task.
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::cout << "[+] " << name << " : " << producer << " allocations for "
+    << OPERATIONS * MEASURED_ROUNDS << " operations" << std::endl;
+  assert(producer == expected * OPERATIONS * MEASURED_ROUNDS);
+  assert(hooks == nullptr || hooks->count() == workers);
+}
+
+/**
+ * \brief A callable too large to be stored inline within a task.
+ */
+struct large_t {
+  std::array<char, 128> payload;
+
+  void operator()() const {
+    increment();
+  }
+};
+
+/**
+ * \brief Asserts the allocations made by each scheduling API, and by the
+ * worker loop, in steady state. Small callables are stored inline within
+ * tasks, and the queue recycles its blocks once it has grown, so that
+ * scheduling them allocates nothing.
+ */
+static void test_scheduling() {
+  allocation_hooks_t hooks;
+  counted_pool_t pool(2, thread::pool::pool_options_t(), hooks);
+  const auto token = pool.create_token_of<counted_pool_t::producer_token_t>();
+
+  assert_allocations("schedule_and_forget", &hooks, 0, [&] () {
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+      bool scheduled = pool.schedule_and_forget(&increment);
+      assert(scheduled);
+    }
+    drain();
+  });
+  assert_allocations("schedule_and_forget with a token", &hooks, 0, [&] () {
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+      bool scheduled = pool.schedule_and_forget(token, &increment);
+      assert(scheduled);
+    }
+    drain();
+  });
+  assert_allocations("try_schedule with a token", &hooks, 0, [&] () {
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+      bool scheduled = pool.try_schedule(token, &increment);
+      assert(scheduled);
+    }
+    drain();
+  });
+  // A callable which does not fit inline is allocated from the pool resource.
+  large_t large;
+  assert_allocations("schedule_and_forget of a large callable", &hooks, 1, [&] () {
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+      bool scheduled = pool.schedule_and_forget(token, large);
+      assert(scheduled);
+    }
+    drain();
+  });
+  // The shared state of the future, and the storage of its result.
+  assert_allocations("schedule", &hooks, 2, [&] () {
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+      auto result = pool.schedule(&identity, 1).get();
+      assert(result == 1);
+    }
+    drain();
+  });
+  assert_allocations("schedule with a token", &hooks, 2, [&] () {
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+      auto result = pool.schedule(token, &identity, 1).get();
+      assert(result == 1);
+    }
+    drain();
+  });
+  std::array<void (*)(), OPERATIONS> functions;
+  functions.fill(&increment);
+  assert_allocations("schedule_bulk", &hooks, 0, [&] () {
+    bool scheduled = pool.schedule_bulk(functions.begin(), functions.end());
+    assert(scheduled);
+    drain();
+  });
+  assert_allocations("schedule_bulk with a token", &hooks, 0, [&] () {
+    bool scheduled = pool.schedule_bulk(token, functions.begin(), functions.end());
+    assert(scheduled);
+    drain();
+  });
+  std::array<thread::pool::consumer_t, OPERATIONS> consumers;
+  consumers.fill(&increment);
+  assert_allocations("schedule_bulk of consumers", &hooks, 0, [&] () {
+    bool scheduled = pool.schedule_bulk(token, consumers.data(), consumers.size());
+    assert(scheduled);
+    drain();
+  });
+}
+
+/**
+ * \brief Asserts the allocations made by a bound callable, which
+ * schedules a copy of its `std::function` with `.schedule()`.
+ */
+static void test_bind() {
+  thread::pool::pool_t pool(2);
+  auto callable = thread::pool::bind(pool, &identity);
+
+  // The task, whose `std::function` and promise do not fit inline,
+  // the shared state of the future and the storage of its result.
+  // `bind()` only accepts a `pool_t`, whose workers are not counted.
+  assert_allocations("bind", nullptr, 3, [&] () {
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+      auto result = callable(1).get();
+      assert(result == 1);
+    }
+    drain();
+  });
+}
+
+int main() {
+  test_scheduling();
+  test_bind();
+  return (0);
+}
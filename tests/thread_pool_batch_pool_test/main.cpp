@@ -0,0 +1,111 @@
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include "../../includes/thread_pool_batch_pool.hpp"
+
+/**
+ * \brief The batches seen by a handler.
+ */
+struct batches_t {
+  std::mutex lock;
+  std::vector<size_t> sizes;
+  std::atomic<size_t> items;
+  std::atomic<size_t> sum;
+
+  batches_t()
+    : items(0), sum(0) {}
+};
+
+/**
+ * \brief A handler recording the batches it is given.
+ */
+struct record_t {
+  batches_t* batches;
+
+  void operator()(size_t* values, size_t count) const {
+    for (size_t i = 0; i < count; ++i) {
+      batches->sum += values[i];
+    }
+    std::lock_guard<std::mutex> lock(batches->lock);
+    batches->sizes.push_back(count);
+    batches->items += count;
+  }
+};
+
+/**
+ * \brief Waits for `batches` to have seen `count` items.
+ */
+void await(batches_t& batches, size_t count) {
+  while (batches.items < count) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Hands every item to the handler, in batches bounded by `max_batch`.
+ */
+void run_batches() {
+  static const size_t size = 100 * 1000;
+  batches_t batches;
+  thread::pool::batch_pool_t<size_t, record_t> pool(2, thread::pool::batch_options_t(64), record_t{ &batches });
+  std::vector<size_t> values(size);
+  for (size_t i = 0; i < size; ++i) {
+    values[i] = i;
+  }
+
+  bool scheduled = pool.schedule_bulk(values.data(), size / 2);
+  assert(scheduled);
+  scheduled = pool.schedule_bulk(values.begin() + size / 2, values.end());
+  assert(scheduled);
+  await(batches, size);
+  assert(batches.sum == size * (size - 1) / 2);
+  for (size_t count : batches.sizes) {
+    assert(count > 0 && count <= 64);
+  }
+  std::cout << "[+] Handled " << size << " items in " << batches.sizes.size() << " batches" << std::endl;
+}
+
+/**
+ * \brief Waits for batches to fill up during the linger time.
+ */
+void run_linger() {
+  batches_t batches;
+  thread::pool::batch_options_t options(16, 8, std::chrono::seconds(5));
+  thread::pool::batch_pool_t<size_t, record_t, 10> pool(1, options, record_t{ &batches });
+  const auto token = pool.create_token_of<decltype(pool)::producer_token_t>();
+
+  // Items trickling in are handed at once, once `min_batch` of them arrived.
+  for (size_t i = 0; i < 8; ++i) {
+    bool scheduled = pool.schedule(token, i);
+    assert(scheduled);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  await(batches, 8);
+  assert(batches.sizes.size() == 1 && batches.sizes[0] == 8);
+  std::cout << "[+] Filled a batch during the linger time" << std::endl;
+}
+
+/**
+ * \brief Hands partial batches to the handler once the linger time elapsed.
+ */
+void run_linger_timeout() {
+  batches_t batches;
+  thread::pool::batch_options_t options(16, 16, std::chrono::milliseconds(20));
+  thread::pool::batch_pool_t<size_t, record_t, 10> pool(1, options, record_t{ &batches });
+
+  auto start = std::chrono::steady_clock::now();
+  size_t values[3] = { 1, 2, 3 };
+  bool scheduled = pool.schedule_bulk(values, 3);
+  assert(scheduled);
+  await(batches, 3);
+  assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+  assert(batches.sizes.size() == 1 && batches.sizes[0] == 3);
+  std::cout << "[+] Handed a partial batch once the linger time elapsed" << std::endl;
+}
+
+int main() {
+  run_batches();
+  run_linger();
+  run_linger_timeout();
+  return (0);
+}
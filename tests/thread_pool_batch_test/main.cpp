@@ -0,0 +1,191 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed work.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Waits on a batch of callables, and attaches
+ * continuations to it.
+ */
+void run_wait() {
+  thread::pool::pool_t pool(2);
+  std::vector<std::function<void()>> callables(100, [] () { ++count; });
+
+  count = 0;
+  thread::pool::batch_t batch = pool.schedule_batch(callables);
+  assert(batch.valid());
+  batch.wait();
+  assert(batch.ready());
+  assert(count == 100);
+  assert(batch.exception() == nullptr);
+  batch.get();
+
+  // A continuation attached to a completed batch runs right away.
+  bool called = false;
+  batch.then([&called] (std::exception_ptr e) { called = !e; });
+  assert(called);
+
+  // A continuation attached to a pending batch runs once it completes.
+  std::promise<void> gate;
+  std::shared_future<void> opened = gate.get_future().share();
+  std::promise<size_t> continued;
+  count = 0;
+  batch = pool.schedule_batch_n(10, [opened] (size_t) { opened.wait(); ++count; });
+  batch.then([&continued] (std::exception_ptr) { continued.set_value(count); });
+  auto status = batch.wait_for(std::chrono::milliseconds(10));
+  assert(status == std::future_status::timeout);
+  gate.set_value();
+  auto result = continued.get_future().get();
+  assert(result == 10);
+  status = batch.wait_for(std::chrono::seconds(10));
+  assert(status == std::future_status::ready);
+  std::cout << "[+] Waited on batches" << std::endl;
+}
+
+/**
+ * \brief Captures the first exception thrown by the tasks of a batch.
+ */
+void run_exceptions() {
+  thread::pool::pool_t pool(2);
+
+  count = 0;
+  thread::pool::batch_t batch = pool.schedule_batch_n(100, [] (size_t i) {
+    ++count;
+    if (i % 10 == 0) {
+      throw std::runtime_error("failed");
+    }
+  });
+  try {
+    batch.get();
+    assert(false);
+  } catch (const std::runtime_error& e) {
+    assert(std::string(e.what()) == "failed");
+  }
+  // Every task runs, even once one of them has failed.
+  assert(count == 100);
+  assert(batch.exception() != nullptr);
+  std::cout << "[+] Captured the first exception of a batch" << std::endl;
+}
+
+/**
+ * \brief A batch only allocates a single state, whatever its size.
+ */
+void run_fan_out() {
+  static const size_t tasks = 100 * 1000;
+  thread::pool::pool_t pool(2);
+  std::atomic<size_t> sum(0);
+
+  thread::pool::batch_t batch = pool.schedule_batch_n(tasks, [&sum] (size_t i) { sum += i; });
+  batch.wait();
+  assert(sum == tasks * (tasks - 1) / 2);
+  // Only the blocks of the queue, the shared callable and the state of the batch.
+  assert(pool.allocation_stats().allocations < tasks / 16);
+  std::cout << "[+] Scheduled a batch of " << tasks << " tasks using "
+    << pool.allocation_stats().allocations << " allocations" << std::endl;
+}
+
+/**
+ * \brief A batch outlives the pool, and tasks which never ran
+ * complete it with a broken promise.
+ */
+void run_abandoned() {
+  thread::pool::batch_t batch;
+  {
+    thread::pool::pool_t pool(0);
+    batch = pool.schedule_batch_n(10, [] (size_t) {});
+    assert(!batch.ready());
+  }
+  assert(batch.ready());
+  try {
+    batch.get();
+    assert(false);
+  } catch (const std::future_error& e) {
+    assert(e.code() == std::future_errc::broken_promise);
+  }
+  std::cout << "[+] Completed an abandoned batch" << std::endl;
+}
+
+/**
+ * \brief Stores the results of callables into caller-provided storage.
+ */
+void run_into() {
+  static const size_t tasks = 100 * 1000;
+  thread::pool::pool_t pool(2);
+
+  // A single callable bound to its arguments.
+  std::string slot;
+  pool.schedule_into(&slot, [] (std::string s, size_t n) { return (s + std::to_string(n)); }, "value-", 42).get();
+  assert(slot == "value-42");
+
+  // A range of callables.
+  std::vector<std::function<int()>> callables;
+  for (int i = 0; i < 100; ++i) {
+    callables.push_back([i] () { return (i * 2); });
+  }
+  std::vector<int> values(callables.size());
+  pool.schedule_bulk_into(values.data(), callables.begin(), callables.end()).get();
+  for (int i = 0; i < 100; ++i) {
+    assert(values[i] == i * 2);
+  }
+
+  // An index function, writing its results into a contiguous array.
+  size_t allocations = pool.allocation_stats().allocations;
+  std::vector<size_t> squares(tasks);
+  pool.schedule_bulk_into_n(squares.data(), tasks, [] (size_t i) { return (i * i); }).get();
+  for (size_t i = 0; i < tasks; ++i) {
+    assert(squares[i] == i * i);
+  }
+  assert(pool.allocation_stats().allocations - allocations < tasks / 16);
+  std::cout << "[+] Stored the results of " << tasks << " tasks using "
+    << pool.allocation_stats().allocations - allocations << " allocations" << std::endl;
+}
+
+/**
+ * \brief An index function whose copy throws.
+ */
+struct throwing_copy_t {
+  throwing_copy_t() {}
+
+  throwing_copy_t(const throwing_copy_t&) {
+    throw std::runtime_error("copy");
+  }
+
+  void operator()(size_t) const {}
+};
+
+/**
+ * \brief A batch whose callable cannot be copied does not
+ * leak the memory allocated for it.
+ */
+void run_throwing_copy() {
+  thread::pool::pool_t pool(1);
+  throwing_copy_t f;
+  size_t in_use = pool.allocation_stats().bytes_in_use;
+  bool thrown = false;
+
+  try {
+    pool.schedule_batch_n(10, f);
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  assert(thrown);
+  assert(pool.allocation_stats().bytes_in_use == in_use);
+  std::cout << "[+] Released the state of a batch whose callable threw" << std::endl;
+}
+
+int main() {
+  run_wait();
+  run_exceptions();
+  run_fan_out();
+  run_into();
+  run_abandoned();
+  run_throwing_copy();
+  return (0);
+}
@@ -0,0 +1,97 @@
+#include <iostream>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief A per-worker cache, set up once by each worker.
+ */
+static thread_local std::vector<int>* cache = nullptr;
+
+/**
+ * \brief The label of the task being run by the current worker.
+ */
+static thread_local uint16_t current = 0;
+
+/**
+ * \brief Hooks counting their calls, and setting up
+ * and tearing down a thread-local cache.
+ */
+struct counting_hooks_t {
+  std::shared_ptr<std::atomic<size_t>> started = std::make_shared<std::atomic<size_t>>(0);
+  std::shared_ptr<std::atomic<size_t>> stopped = std::make_shared<std::atomic<size_t>>(0);
+  std::shared_ptr<std::atomic<size_t>> before = std::make_shared<std::atomic<size_t>>(0);
+  std::shared_ptr<std::atomic<size_t>> after = std::make_shared<std::atomic<size_t>>(0);
+  std::shared_ptr<std::atomic<size_t>> idle = std::make_shared<std::atomic<size_t>>(0);
+
+  void on_worker_start(size_t worker) noexcept {
+    cache = new std::vector<int>(1, static_cast<int>(worker));
+    ++*started;
+  }
+
+  void on_worker_stop(size_t) noexcept {
+    delete cache;
+    cache = nullptr;
+    ++*stopped;
+  }
+
+  void before_task(size_t, const thread::pool::task_t& task) noexcept {
+    current = task.label();
+    ++*before;
+  }
+
+  void after_task(size_t, const thread::pool::task_t&) noexcept {
+    current = 0;
+    ++*after;
+  }
+
+  void on_idle(size_t) noexcept {
+    ++*idle;
+  }
+};
+
+/**
+ * \brief A pool running counting hooks.
+ */
+using hooked_pool_t = thread::pool::parameterized_pool_t<
+  thread::pool::WORK_PARTITIONING_HEAVY,
+  100,
+  thread::pool::spin_yield_park_t<>,
+  thread::pool::moodycamel_queue_t,
+  thread::pool::no_metrics_t,
+  counting_hooks_t
+>;
+
+/**
+ * \brief Runs the hooks around tasks and workers.
+ */
+void run_hooks() {
+  counting_hooks_t hooks;
+  static const thread::pool::task_label_t request("request");
+  {
+    hooked_pool_t pool(3, thread::pool::pool_options_t(), hooks);
+    std::vector<std::future<bool>> futures;
+    for (size_t i = 0; i < 100; ++i) {
+      futures.push_back(pool.schedule([] () { return (cache != nullptr && cache->size() == 1 && current == 0); }));
+    }
+    for (std::future<bool>& future : futures) {
+      bool context = future.get();
+      assert(context);
+    }
+    // Tasks see their label through the context set up by the hooks.
+    auto result = pool.schedule(request, [] () { return (current); }).get();
+    assert(result == request.id());
+    assert(*pool.hooks().before >= 101);
+    pool.stop().await();
+  }
+  assert(*hooks.started == 3);
+  assert(*hooks.stopped == 3);
+  assert(*hooks.before == 101);
+  assert(*hooks.after == 101);
+  assert(*hooks.idle > 0);
+  std::cout << "[+] Ran hooks around " << *hooks.before << " tasks" << std::endl;
+}
+
+int main() {
+  static_assert(std::is_empty<thread::pool::no_hooks_t>::value, "The default hooks hold no state");
+  run_hooks();
+  return (0);
+}
@@ -0,0 +1,151 @@
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief A pool accounting for the tasks of each label.
+ */
+using labeled_pool_t = thread::pool::parameterized_pool_t<
+  thread::pool::WORK_PARTITIONING_HEAVY,
+  100,
+  thread::pool::spin_yield_park_t<>,
+  thread::pool::moodycamel_queue_t,
+  thread::pool::labeled_metrics_t
+>;
+
+/**
+ * \brief A tag type naming a label.
+ */
+struct encode_tag_t {
+  static const char* name() { return ("encode"); }
+};
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed work.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Waits for `count` to reach `target`.
+ */
+void await(size_t target) {
+  while (count < target) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Spins for the given duration.
+ */
+void spin(std::chrono::microseconds duration) {
+  auto end = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < end) {}
+}
+
+/**
+ * \return the snapshot of the label with the given name.
+ */
+const thread::pool::label_snapshot_t* find(const thread::pool::metrics_snapshot_t& snapshot, const char* name) {
+  for (const thread::pool::label_snapshot_t& label : snapshot.labels) {
+    if (std::strcmp(label.name, name) == 0) {
+      return (&label);
+    }
+  }
+  return (nullptr);
+}
+
+/**
+ * \brief Interns labels into identifiers.
+ */
+void run_registry() {
+  thread::pool::task_label_t unlabeled;
+  thread::pool::task_label_t resize("resize");
+  std::string name("resize");
+
+  assert(unlabeled.id() == 0);
+  assert(std::strcmp(unlabeled.name(), "unlabeled") == 0);
+  assert(resize.id() != 0);
+  // Labels are interned by name rather than by address.
+  assert(thread::pool::task_label_t(name.c_str()).id() == resize.id());
+  assert(std::strcmp(resize.name(), "resize") == 0);
+  assert(thread::pool::task_label_t::of<encode_tag_t>().id() == thread::pool::task_label_t("encode").id());
+  assert(thread::pool::task_label_t("other").id() != resize.id());
+
+  thread::pool::task_t task;
+  task.stamp(~uint64_t(0));
+  task.label(resize.id());
+  assert(task.stamp() == thread::pool::task_t::STAMP_MASK);
+  assert(task.label() == resize.id());
+  task.stamp(42);
+  assert(task.stamp() == 42 && task.label() == resize.id());
+  std::cout << "[+] Interned labels" << std::endl;
+}
+
+/**
+ * \brief Accounts for the tasks of each label.
+ */
+void run_labels() {
+  static const thread::pool::task_label_t resize("resize");
+  const thread::pool::task_label_t encode = thread::pool::task_label_t::of<encode_tag_t>();
+  labeled_pool_t pool(2);
+  const auto token = pool.create_token_of<labeled_pool_t::producer_token_t>();
+
+  count = 0;
+  for (size_t i = 0; i < 10; ++i) {
+    bool scheduled = pool.schedule_and_forget(resize, [] () { spin(std::chrono::microseconds(1000)); ++count; });
+    assert(scheduled);
+    scheduled = pool.schedule_and_forget(token, encode, [] () { ++count; });
+    assert(scheduled);
+  }
+  auto result = pool.schedule(encode, [] (int value) { return (value + 1); }, 1).get();
+  assert(result == 2);
+  result = pool.schedule(token, resize, [] () { return (1); }).get();
+  assert(result == 1);
+  bool scheduled = pool.schedule_and_forget([] () { ++count; });
+  assert(scheduled);
+  await(21);
+
+  thread::pool::metrics_snapshot_t snapshot = pool.snapshot();
+  const thread::pool::label_snapshot_t* resized = find(snapshot, "resize");
+  const thread::pool::label_snapshot_t* encoded = find(snapshot, "encode");
+  const thread::pool::label_snapshot_t* unlabeled = find(snapshot, "unlabeled");
+  assert(resized != nullptr && encoded != nullptr && unlabeled != nullptr);
+  assert(resized->count == 11);
+  assert(encoded->count == 11);
+  assert(unlabeled->count == 1);
+  assert(snapshot.completed == 23);
+  assert(resized->queue_wait.count() == 11);
+  assert(resized->wall_time >= std::chrono::milliseconds(10));
+  assert(resized->wall_time > encoded->wall_time);
+  // Spinning keeps the worker on the CPU, which its CPU time reflects.
+  assert(resized->cpu_time > encoded->cpu_time);
+  std::cout << "[+] Accounted for labels: resize ran for " << resized->wall_time.count()
+    << " ns, using " << resized->cpu_time.count() << " ns of CPU time" << std::endl;
+}
+
+/**
+ * \brief Labels show up in traces.
+ */
+void run_trace() {
+  thread::pool::pool_options_t options;
+  options.trace_events = 64;
+  thread::pool::pool_t pool(1, options);
+
+  auto status = pool.schedule(thread::pool::task_label_t("compress"), [] () {}).wait_for(std::chrono::seconds(5));
+  assert(status == std::future_status::ready);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::ostringstream stream;
+  bool written = pool.write_trace(stream);
+  assert(written);
+  assert(stream.str().find("\"ph\":\"B\",\"name\":\"compress\"") != std::string::npos);
+  std::cout << "[+] Traced labeled tasks" << std::endl;
+}
+
+int main() {
+  run_registry();
+  run_labels();
+  run_trace();
+  return (0);
+}
@@ -0,0 +1,288 @@
+#include <iostream>
+#include <array>
+#include <stdexcept>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief A resource forwarding to the global heap, which keeps
+ * track of the memory it has handed out, and of the chunks
+ * requested by the slab resources drawing from it.
+ */
+class tracking_resource_t : public thread::pool::memory_resource_t {
+public:
+
+  tracking_resource_t()
+    : allocations(0), outstanding(0), chunks(0) {}
+
+  std::atomic<size_t> allocations;
+  std::atomic<size_t> outstanding;
+  std::atomic<size_t> chunks;
+
+protected:
+
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    ++allocations;
+    outstanding += bytes;
+    chunks += bytes == thread::pool::slab_resource_t::CHUNK_SIZE;
+    return (thread::pool::new_delete_resource()->allocate(bytes, alignment));
+  }
+
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+    outstanding -= bytes;
+    thread::pool::new_delete_resource()->deallocate(ptr, bytes, alignment);
+  }
+
+  bool do_is_equal(const thread::pool::memory_resource_t& other) const noexcept override {
+    return (this == &other);
+  }
+};
+
+/**
+ * \brief Asserts that small callables are stored inline within
+ * a task, and that larger ones are allocated from a resource.
+ */
+void run_task() {
+  tracking_resource_t resource;
+  size_t count = 0;
+  std::array<size_t, 16> large = {};
+
+  thread::pool::task_t small(&resource, [&count] () { ++count; });
+  thread::pool::task_t big(&resource, [&count, large] () { count += large.size(); });
+  assert(resource.allocations == 1);
+  thread::pool::task_t moved(std::move(big));
+  assert(!big && moved);
+  small();
+  moved();
+  assert(count == 17);
+  moved.reset();
+  assert(resource.outstanding == 0);
+  std::cout << "[+] Tasks store " << thread::pool::task_t::INLINE_SIZE << " bytes inline" << std::endl;
+}
+
+/**
+ * \brief Schedules callables on a pool using the given queue backend
+ * and a custom resource, and asserts that the queue, the tasks and the
+ * futures have drawn their memory from it.
+ */
+template <template <typename> class Queue>
+void run(const char* name) {
+  tracking_resource_t resource;
+  std::future<size_t> future;
+  std::array<size_t, 16> large = {};
+  large.fill(1);
+
+  {
+    thread::pool::pool_options_t options(1024);
+    options.resource = &resource;
+    thread::pool::parameterized_pool_t<
+      thread::pool::WORK_PARTITIONING_LIGHT,
+      100,
+      thread::pool::spin_yield_park_t<>,
+      Queue
+    > pool(1, options);
+
+    for (size_t i = 0; i < 100; ++i) {
+      auto result = pool.schedule([large] () { return (large[0]); }).get();
+      assert(result == 1);
+    }
+    future = pool.schedule([large] () {
+      size_t sum = 0;
+      for (size_t value : large) {
+        sum += value;
+      }
+      return (sum);
+    });
+    try {
+      pool.schedule([] () { throw std::runtime_error("failure"); }).get();
+      assert(false);
+    } catch (const std::runtime_error&) {}
+    future.wait();
+
+    thread::pool::allocation_stats_t stats = pool.allocation_stats();
+    assert(stats.allocations == resource.allocations);
+    assert(stats.allocations >= 2 * 100);
+    assert(stats.allocations - stats.deallocations >= 1);
+    assert(stats.peak_bytes_in_use >= stats.bytes_in_use);
+    assert(stats.bytes_allocated >= stats.peak_bytes_in_use);
+    std::cout << "[+] `" << name << "` made " << stats.allocations
+      << " allocations, peaking at " << stats.peak_bytes_in_use << " bytes" << std::endl;
+  }
+
+  // The future outlives the pool, and releases its shared state last.
+  assert(resource.outstanding > 0);
+  auto result = future.get();
+  assert(result == 16);
+  future = std::future<size_t>();
+  assert(resource.outstanding == 0);
+}
+
+/**
+ * \brief Asserts that blocks released by another thread return to the
+ * slab they come from, and that the heaps of exited threads are reused.
+ */
+void run_slabs() {
+  tracking_resource_t upstream;
+  {
+    thread::pool::slab_resource_t slabs(&upstream);
+    std::vector<void*> blocks;
+
+    for (size_t i = 0; i < 1000; ++i) {
+      void* block = slabs.allocate(100 + i % 300);
+      assert(reinterpret_cast<uintptr_t>(block) % alignof(std::max_align_t) == 0);
+      blocks.push_back(block);
+    }
+    void* large = slabs.allocate(64 * 1024);
+    size_t chunks = upstream.allocations;
+
+    // Releasing the blocks from another thread, and reallocating them.
+    std::thread([&] () {
+      for (size_t i = 0; i < blocks.size(); ++i) {
+        slabs.deallocate(blocks[i], 100 + i % 300);
+      }
+      slabs.flush();
+    }).join();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      blocks[i] = slabs.allocate(100 + i % 300);
+    }
+    assert(upstream.allocations == chunks);
+
+    // A thread which has exited leaves its heap to the next one.
+    std::thread([&] () { slabs.deallocate(slabs.allocate(64), 64); }).join();
+    size_t heaps = upstream.allocations;
+    std::thread([&] () { slabs.deallocate(slabs.allocate(64), 64); }).join();
+    assert(upstream.allocations == heaps);
+    slabs.deallocate(large, 64 * 1024);
+  }
+  assert(upstream.outstanding == 0);
+
+  // Scheduling large callables from several producers.
+  std::atomic<size_t> sum(0);
+  size_t chunks = upstream.chunks;
+  {
+    thread::pool::pool_options_t options;
+    options.resource = &upstream;
+    options.task_slabs = true;
+    thread::pool::pool_t pool(2, options);
+    std::vector<std::thread> producers;
+    std::array<size_t, 16> large = {};
+    large.fill(1);
+
+    for (size_t i = 0; i < 4; ++i) {
+      producers.push_back(std::thread([&] () {
+        for (size_t j = 0; j < 10 * 1000; ++j) {
+          bool scheduled = pool.schedule_and_forget([&sum, large] () { sum += large[15]; });
+          assert(scheduled);
+        }
+      }));
+    }
+    for (std::thread& t : producers) {
+      t.join();
+    }
+    while (sum < 4 * 10 * 1000) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Each producer carves its tasks out of chunks of its own, even
+    // if no block is ever handed back to it by the workers.
+    const size_t blocks = thread::pool::slab_resource_t::CHUNK_SIZE / thread::pool::slab_resource_t::footprint(sizeof(large) + sizeof(&sum));
+    chunks = upstream.chunks - chunks;
+    assert(chunks <= 4 * ((10 * 1000 + blocks - 1) / blocks));
+    std::cout << "[+] Slabs served " << sum << " tasks using "
+      << chunks << " chunks" << std::endl;
+  }
+  assert(upstream.outstanding == 0);
+}
+
+/**
+ * \brief Asserts that large allocations are carved out of huge page
+ * regions, and that the pool can allocate its queue and tasks from them.
+ */
+void run_huge_pages() {
+  tracking_resource_t upstream;
+  size_t size = thread::pool::huge_page_resource_t::HUGE_PAGE_SIZE;
+  {
+    thread::pool::huge_page_resource_t pages(size, 0, &upstream);
+    assert(pages.reserved() == size);
+
+    void* block = pages.allocate(4000);
+    assert(reinterpret_cast<uintptr_t>(block) % 64 == 0);
+    pages.deallocate(block, 4000);
+    auto reused = pages.allocate(4000);
+    assert(reused == block);
+    void* small = pages.allocate(100);
+    assert(upstream.allocations == 1);
+    pages.deallocate(small, 100);
+
+    // Exhausting the first region maps another one.
+    pages.allocate(size);
+    assert(pages.reserved() == 2 * size);
+    std::cout << "[+] " << pages.explicit_huge_pages() << " bytes backed by explicit huge pages" << std::endl;
+  }
+  assert(upstream.outstanding == 0);
+
+  std::future<size_t> future;
+  {
+    thread::pool::pool_options_t options;
+    options.resource = &upstream;
+    options.huge_pages = true;
+    options.huge_pages_reserve = size;
+    thread::pool::pool_t pool(2, options);
+    std::array<size_t, 32> large = {};
+
+    for (size_t i = 0; i < 10 * 1000; ++i) {
+      bool scheduled = pool.schedule_and_forget([large] () {});
+      assert(scheduled);
+    }
+    future = pool.schedule([large] () { return (large.size()); });
+    auto result = future.get();
+    assert(result == 32);
+    future = pool.schedule([large] () { return (large.size()); });
+  }
+  assert(upstream.outstanding > 0);
+  future = std::future<size_t>();
+  assert(upstream.outstanding == 0);
+}
+
+/**
+ * \brief Asserts that threads releasing and reusing blocks of more sizes
+ * than the lock-free free lists of a huge page resource hold never get
+ * the same block at once.
+ */
+void run_huge_pages_concurrency() {
+  const size_t sizes = 2 * thread::pool::huge_page_resource_t::SIZE_CLASSES;
+  thread::pool::huge_page_resource_t pages(thread::pool::huge_page_resource_t::HUGE_PAGE_SIZE);
+  std::vector<std::thread> threads;
+
+  for (size_t t = 1; t <= 4; ++t) {
+    threads.push_back(std::thread([&pages, sizes, t] () {
+      std::array<std::pair<unsigned char*, size_t>, 8> blocks = {};
+      for (size_t i = 0; i < 20 * 1000; ++i) {
+        auto& block = blocks[i % blocks.size()];
+        if (block.first != nullptr) {
+          assert(block.first[0] == t && block.first[block.second - 1] == t);
+          pages.deallocate(block.first, block.second);
+        }
+        block.second = 1024 + (i * 7 % sizes) * 64;
+        block.first = static_cast<unsigned char*>(pages.allocate(block.second));
+        block.first[0] = block.first[block.second - 1] = static_cast<unsigned char>(t);
+      }
+      for (auto& block : blocks) {
+        pages.deallocate(block.first, block.second);
+      }
+    }));
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  std::cout << "[+] Reused blocks of " << sizes << " sizes from 4 threads" << std::endl;
+}
+
+int main() {
+  run_task();
+  run_slabs();
+  run_huge_pages();
+  run_huge_pages_concurrency();
+  run<thread::pool::moodycamel_queue_t>("moodycamel_queue_t");
+  run<thread::pool::locked_queue_t>("locked_queue_t");
+  run<thread::pool::mpmc_queue_t>("mpmc_queue_t");
+  return (0);
+}
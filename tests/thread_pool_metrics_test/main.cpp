@@ -0,0 +1,116 @@
+#include <iostream>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief A pool collecting metrics.
+ */
+using metered_pool_t = thread::pool::parameterized_pool_t<
+  thread::pool::WORK_PARTITIONING_HEAVY,
+  100,
+  thread::pool::spin_yield_park_t<>,
+  thread::pool::moodycamel_queue_t,
+  thread::pool::pool_metrics_t
+>;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed work.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Waits for `count` to reach `target`.
+ */
+void await(size_t target) {
+  while (count < target) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Checks the buckets of the log histograms.
+ */
+void run_histogram() {
+  using histogram_t = thread::pool::histogram_snapshot_t;
+
+  size_t previous = 0;
+  for (uint64_t value = 1; value < (uint64_t(1) << 40); value = value * 3 / 2 + 1) {
+    size_t bucket = histogram_t::bucket_of(value);
+    assert(bucket >= previous && bucket < histogram_t::BUCKETS);
+    assert(histogram_t::upper_bound_of(bucket) >= value);
+    // The relative error is bounded by the number of sub-buckets.
+    assert(histogram_t::upper_bound_of(bucket) - value <= value / histogram_t::SUB_COUNT);
+    previous = bucket;
+  }
+  assert(histogram_t::bucket_of(~uint64_t(0)) == histogram_t::BUCKETS - 1);
+  std::cout << "[+] Bucketed values in log histograms" << std::endl;
+}
+
+/**
+ * \brief Collects the metrics of a pool.
+ */
+void run_metrics() {
+  metered_pool_t pool(2);
+
+  count = 0;
+  for (size_t i = 0; i < 100; ++i) {
+    pool.schedule_and_forget([] () { ++count; });
+  }
+  pool.schedule([] () {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++count;
+  }).get();
+  bool scheduled = pool.schedule_bulk_n(1000, [] (size_t) { ++count; });
+  assert(scheduled);
+  await(1101);
+  // Letting the workers go idle and park.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  thread::pool::metrics_snapshot_t snapshot = pool.snapshot();
+  assert(snapshot.enabled);
+  assert(snapshot.enqueued == 1101);
+  assert(snapshot.dequeued == 1101);
+  assert(snapshot.completed == 1101);
+  assert(snapshot.queue_depth == 0);
+  assert(snapshot.run_time.count() == 1101);
+  assert(snapshot.queue_wait.count() == 1101);
+  assert(snapshot.run_time.max() >= 10 * 1000 * 1000);
+  assert(snapshot.run_time.percentile(50) < snapshot.run_time.max());
+  assert(snapshot.run_time.percentile(100) == snapshot.run_time.max());
+  assert(snapshot.workers.size() == 2);
+  uint64_t completed = 0;
+  std::chrono::nanoseconds busy(0), parked(0);
+  for (const thread::pool::worker_snapshot_t& worker : snapshot.workers) {
+    completed += worker.completed;
+    busy += worker.busy;
+    parked += worker.parked;
+  }
+  assert(completed == 1101);
+  assert(busy >= std::chrono::milliseconds(10));
+  assert(parked > std::chrono::milliseconds(0));
+  std::cout << "[+] Collected metrics: p50 run time " << snapshot.run_time.percentile(50)
+    << " ns, p99 queue wait " << snapshot.queue_wait.percentile(99) << " ns" << std::endl;
+}
+
+/**
+ * \brief Pools without metrics only report their queue depth.
+ */
+void run_disabled() {
+  thread::pool::pool_t pool(0);
+
+  bool scheduled = pool.schedule_and_forget([] () {});
+  assert(scheduled);
+  thread::pool::metrics_snapshot_t snapshot = pool.snapshot();
+  assert(!snapshot.enabled);
+  assert(snapshot.enqueued == 0);
+  assert(snapshot.queue_depth == 1);
+  assert(snapshot.workers.empty());
+  std::cout << "[+] Reported the queue depth without metrics" << std::endl;
+}
+
+int main() {
+  run_histogram();
+  run_metrics();
+  run_disabled();
+  return (0);
+}
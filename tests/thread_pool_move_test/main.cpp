@@ -0,0 +1,169 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief The number of copies and moves made of `counted_t` objects.
+ */
+static std::atomic<size_t> copies;
+static std::atomic<size_t> moves;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed callables.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief A copyable type counting its copies and moves.
+ */
+struct counted_t {
+  int value;
+
+  explicit counted_t(int value = 0)
+    : value(value) {}
+
+  counted_t(const counted_t& other)
+    : value(other.value) {
+    ++copies;
+  }
+
+  counted_t(counted_t&& other) noexcept
+    : value(other.value) {
+    ++moves;
+  }
+
+  counted_t& operator=(const counted_t&) = delete;
+  counted_t& operator=(counted_t&&) = delete;
+};
+
+/**
+ * \brief A copyable functor counting its copies and moves.
+ */
+struct counted_functor_t {
+  counted_t state;
+
+  int operator()(counted_t argument) {
+    ++count;
+    return (state.value + argument.value);
+  }
+};
+
+/**
+ * \brief A move-only functor.
+ */
+struct move_only_functor_t {
+  std::unique_ptr<int> value;
+
+  int operator()(std::unique_ptr<int> argument) {
+    ++count;
+    return (*value + *argument);
+  }
+};
+
+/**
+ * \brief A type exposing member functions and data.
+ */
+struct object_t {
+  int value;
+
+  int add(int other) const {
+    return (value + other);
+  }
+};
+
+/**
+ * \brief Waits for `expected` callables to have been executed.
+ */
+void await(size_t expected) {
+  while (count < expected) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Asserts that the callables and arguments given to the
+ * schedule methods are moved into the tasks, and never copied.
+ */
+void run_no_copies() {
+  thread::pool::pool_t pool(1);
+
+  copies = 0;
+  auto result = pool.schedule(counted_functor_t{ counted_t(1) }, counted_t(2)).get();
+  assert(result == 3);
+  bool scheduled = pool.schedule_and_forget(counted_functor_t{ counted_t(1) }, counted_t(2));
+  assert(scheduled);
+  scheduled = pool.try_schedule(counted_functor_t{ counted_t(1) }, counted_t(2));
+  assert(scheduled);
+  const auto token = pool.create_token_of<thread::pool::pool_t::producer_token_t>();
+  result = pool.schedule(token, counted_functor_t{ counted_t(1) }, counted_t(2)).get();
+  assert(result == 3);
+  scheduled = pool.schedule_and_forget(token, counted_functor_t{ counted_t(1) }, counted_t(2));
+  assert(scheduled);
+  await(5);
+  assert(copies == 0);
+  std::cout << "[+] Scheduled 5 callables with " << moves << " moves and no copy" << std::endl;
+
+  // Lvalues are copied exactly once, into the task.
+  counted_functor_t functor{ counted_t(1) };
+  counted_t argument(2);
+  result = pool.schedule(functor, argument).get();
+  assert(result == 3);
+  assert(copies == 2);
+}
+
+/**
+ * \brief Asserts that move-only callables and arguments can be scheduled.
+ */
+void run_move_only() {
+  thread::pool::pool_t pool(1);
+
+  count = 0;
+  std::unique_ptr<int> value(new int(1));
+  auto future = pool.schedule(move_only_functor_t{ std::move(value) }, std::unique_ptr<int>(new int(2)));
+  auto result = future.get();
+  assert(result == 3);
+  bool scheduled = pool.schedule_and_forget(move_only_functor_t{ std::unique_ptr<int>(new int(1)) }, std::unique_ptr<int>(new int(2)));
+  assert(scheduled);
+  scheduled = pool.try_schedule(move_only_functor_t{ std::unique_ptr<int>(new int(1)) }, std::unique_ptr<int>(new int(2)));
+  assert(scheduled);
+  await(3);
+
+  std::unique_ptr<std::string> string(new std::string("hello"));
+  auto length = pool.schedule([] (std::unique_ptr<std::string> s) { return (s->size()); }, std::move(string));
+  result = length.get();
+  assert(result == 5);
+}
+
+/**
+ * \brief Asserts that callables are invoked following the rules
+ * of `std::invoke`, including pointers to members.
+ */
+void run_invoke() {
+  thread::pool::pool_t pool(1);
+  object_t object{ 40 };
+
+  auto result = pool.schedule(&object_t::add, object, 2).get();
+  assert(result == 42);
+  result = pool.schedule(&object_t::add, &object, 2).get();
+  assert(result == 42);
+  result = pool.schedule(&object_t::add, std::cref(object), 2).get();
+  assert(result == 42);
+  result = pool.schedule(&object_t::add, std::unique_ptr<object_t>(new object_t{ 40 }), 2).get();
+  assert(result == 42);
+  result = pool.schedule(&object_t::value, &object).get();
+  assert(result == 40);
+
+  // Arguments wrapped in a `std::reference_wrapper` are passed by reference.
+  int value = 0;
+  pool.schedule([] (int& v) { v = 42; }, std::ref(value)).get();
+  assert(value == 42);
+}
+
+int main() {
+  run_no_copies();
+  run_move_only();
+  run_invoke();
+  return (0);
+}
@@ -0,0 +1,188 @@
+#include <iostream>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief The number of callables to be scheduled.
+ */
+static const size_t size = 1000;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed callables.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Schedules callables on a single worker pool using the given
+ * queue backend through every scheduling method, and asserts that
+ * each of them has been executed.
+ */
+template <template <typename> class Queue>
+void run(const char* name) {
+  thread::pool::parameterized_pool_t<
+    thread::pool::WORK_PARTITIONING_LIGHT,
+    100,
+    thread::pool::spin_yield_park_t<>,
+    Queue
+  > pool(1, 4 * size);
+  auto token = pool.template create_token_of<typename decltype(pool)::producer_token_t>();
+  std::vector<thread::pool::consumer_t> callables(size, [] () { ++count; });
+
+  count = 0;
+  bool scheduled = pool.schedule_bulk(callables.data(), size);
+  assert(scheduled);
+  scheduled = pool.schedule_bulk(token, callables.data(), size);
+  assert(scheduled);
+  for (size_t i = 0; i < size; ++i) {
+    bool scheduled = pool.schedule_and_forget([] () { ++count; });
+    assert(scheduled);
+  }
+  auto result = pool.schedule(token, [] (int value) { ++count; return (value); }, 42).get();
+  assert(result == 42);
+  result = pool.schedule([] () { return (++count); }).get();
+  assert(result > 0);
+
+  // Waiting for the consumer to complete.
+  while (count < 3 * size + 2) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::cout << "[+] `" << name << "` executed " << count << " callables" << std::endl;
+}
+
+/**
+ * \brief Exercises the bounded MPMC ring directly : capacity rounding,
+ * all-or-nothing bulk enqueues, wrapping around the ring and concurrent
+ * producers and consumers.
+ */
+void run_mpmc_ring() {
+  thread::pool::mpmc_queue_t<size_t> ring(100);
+  thread::pool::mpmc_queue_t<size_t>::consumer_token_t token(ring);
+  std::vector<size_t> items(ring.capacity());
+  std::vector<size_t> out(ring.capacity());
+
+  assert(ring.capacity() == 128);
+  for (size_t lap = 0; lap < 3; ++lap) {
+    for (size_t i = 0; i < items.size(); ++i) {
+      items[i] = lap * items.size() + i;
+    }
+    bool enqueued = ring.enqueue_bulk(items.data(), items.size() - 1);
+    assert(enqueued);
+    enqueued = ring.enqueue_bulk(items.data(), 2);
+    assert(!enqueued);
+    enqueued = ring.enqueue(items.back());
+    assert(enqueued);
+    enqueued = ring.enqueue(size_t(0));
+    assert(!enqueued);
+    auto dequeued = ring.try_dequeue_bulk(token, out.data(), out.size());
+    assert(dequeued == out.size());
+    assert(out == items);
+  }
+
+  // Concurrent producers and consumers summing up every item.
+  const size_t per_producer = 100 * 1000;
+  std::atomic<size_t> sum(0), dequeued(0);
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < 2; ++p) {
+    threads.push_back(std::thread([&ring] () {
+      for (size_t i = 1; i <= per_producer; ++i) {
+        while (!(i % 2 ? ring.enqueue(i) : ring.enqueue_bulk(&i, 1))) {
+          std::this_thread::yield();
+        }
+      }
+    }));
+    threads.push_back(std::thread([&] () {
+      thread::pool::mpmc_queue_t<size_t>::consumer_token_t token(ring);
+      size_t batch[16];
+      while (dequeued < 2 * per_producer) {
+        size_t count = ring.try_dequeue_bulk(token, batch, 16);
+        for (size_t i = 0; i < count; ++i) {
+          sum += batch[i];
+        }
+        dequeued += count;
+        if (count == 0) {
+          std::this_thread::yield();
+        }
+      }
+    }));
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  assert(sum == 2 * (per_producer * (per_producer + 1) / 2));
+  std::cout << "[+] `mpmc_queue_t` ring dequeued " << dequeued << " items" << std::endl;
+}
+
+/**
+ * \brief An item whose copy throws once `copies` reaches zero.
+ */
+struct throwing_item_t {
+  static size_t copies;
+
+  throwing_item_t() = default;
+
+  throwing_item_t(const throwing_item_t&) {
+    if (copies == 0) {
+      throw std::bad_alloc();
+    }
+    --copies;
+  }
+
+  throwing_item_t& operator=(const throwing_item_t&) = default;
+};
+
+size_t throwing_item_t::copies = 0;
+
+/**
+ * \brief Asserts that `locked_queue_t` reports the items it could not
+ * store rather than throwing, and does not keep part of a failed batch.
+ */
+void run_locked_failure() {
+  thread::pool::locked_queue_t<throwing_item_t> queue;
+  thread::pool::locked_queue_t<throwing_item_t>::consumer_token_t token(queue);
+  std::vector<throwing_item_t> items(4);
+
+  throwing_item_t::copies = 2;
+  bool enqueued = queue.enqueue_bulk(items.data(), items.size());
+  assert(!enqueued);
+  assert(queue.size_approx() == 0);
+  enqueued = queue.enqueue(items.front());
+  assert(!enqueued);
+  throwing_item_t::copies = 1;
+  enqueued = queue.enqueue(items.front());
+  assert(enqueued);
+  auto dequeued = queue.try_dequeue_bulk(token, items.data(), items.size());
+  assert(dequeued == 1);
+  std::cout << "[+] `locked_queue_t` reported the items it could not store" << std::endl;
+}
+
+/**
+ * \brief Asserts that a pool refuses to run several workers
+ * on a queue supporting a single consumer.
+ */
+void run_spsc_concurrency() {
+  using spsc_pool_t = thread::pool::parameterized_pool_t<
+    thread::pool::WORK_PARTITIONING_LIGHT,
+    100,
+    thread::pool::spin_yield_park_t<>,
+    thread::pool::spsc_queue_t
+  >;
+  bool thrown = false;
+  try {
+    spsc_pool_t pool(2);
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  assert(thrown);
+  std::cout << "[+] `spsc_queue_t` refuses several workers" << std::endl;
+}
+
+int main() {
+  run_mpmc_ring();
+  run<thread::pool::moodycamel_queue_t>("moodycamel_queue_t");
+  run<thread::pool::locked_queue_t>("locked_queue_t");
+  run<thread::pool::mpmc_queue_t>("mpmc_queue_t");
+  run<thread::pool::spsc_queue_t>("spsc_queue_t");
+  run_locked_failure();
+  run_spsc_concurrency();
+  return (0);
+}
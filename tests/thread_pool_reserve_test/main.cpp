@@ -0,0 +1,133 @@
+#include <iostream>
+#include <array>
+#include <vector>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief The number of callables scheduled after a reservation.
+ */
+static const size_t size = 10 * 1000;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed callables.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Asserts that `try_schedule` does not allocate once the
+ * queue has been reserved, and fails once the reservation is used up.
+ */
+void run_try_schedule() {
+  // A pool without workers keeps every callable in its queue.
+  thread::pool::pool_t pool(0);
+
+  bool reserved = pool.reserve(size);
+  assert(reserved);
+  size_t allocations = pool.allocation_stats().allocations;
+  for (size_t i = 0; i < size; ++i) {
+    bool scheduled = pool.try_schedule([] () { ++count; });
+    assert(scheduled);
+  }
+  size_t scheduled = size;
+  while (pool.try_schedule([] () { ++count; })) {
+    ++scheduled;
+  }
+  assert(scheduled < 2 * size);
+  assert(pool.allocation_stats().allocations == allocations);
+  // Other schedule methods are still allowed to allocate.
+  bool queued = pool.schedule_and_forget([] () { ++count; });
+  assert(queued);
+  assert(pool.allocation_stats().allocations > allocations);
+  std::cout << "[+] Scheduled " << scheduled << " callables without allocating" << std::endl;
+}
+
+/**
+ * \brief Asserts that producer threads scheduling for the first time,
+ * more than the initial implicit producer hash can hold, reuse the
+ * reserved producers and slabs rather than allocating.
+ */
+void run_producers() {
+  const size_t producers = 4 * moodycamel::ConcurrentQueueDefaultTraits::INITIAL_IMPLICIT_PRODUCER_HASH_SIZE;
+  thread::pool::pool_options_t options;
+  options.task_slabs = true;
+  thread::pool::pool_t pool(0, options);
+  std::array<size_t, 8> large = {};
+
+  bool reserved = pool.reserve(size, producers, sizeof(large) + sizeof(&count));
+  assert(reserved);
+  size_t allocations = pool.allocation_stats().allocations;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < producers; ++i) {
+    threads.push_back(std::thread([&pool, large] () {
+      for (size_t j = 0; j < size / producers; ++j) {
+        bool scheduled = pool.schedule_and_forget([large] () { count += large.size(); });
+        assert(scheduled);
+      }
+    }));
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  assert(pool.allocation_stats().allocations == allocations);
+  std::cout << "[+] " << producers << " producers scheduled " << size << " callables without allocating" << std::endl;
+}
+
+/**
+ * \brief Asserts that reserving while threads schedule without a token
+ * for the first time, and grow the implicit producer hash, loses no callable.
+ */
+void run_concurrent_reserve() {
+  const size_t producers = 4 * moodycamel::ConcurrentQueueDefaultTraits::INITIAL_IMPLICIT_PRODUCER_HASH_SIZE;
+  const size_t callables = 100;
+  thread::pool::pool_t pool(2);
+  std::vector<std::thread> threads;
+
+  count = 0;
+  for (size_t i = 0; i < producers; ++i) {
+    threads.push_back(std::thread([&pool, callables] () {
+      for (size_t j = 0; j < callables; ++j) {
+        bool scheduled = pool.schedule_and_forget([] () { ++count; });
+        assert(scheduled);
+      }
+    }));
+    bool reserved = pool.reserve(callables, 2);
+    assert(reserved);
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  while (count < producers * callables) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::cout << "[+] Reserved while " << producers << " producers were scheduling" << std::endl;
+}
+
+/**
+ * \brief Asserts that a pool keeps running callables once reserved.
+ */
+void run_workers() {
+  thread::pool::pool_t pool(2);
+
+  count = 0;
+  bool reserved = pool.reserve(size);
+  assert(reserved);
+  for (size_t i = 0; i < size; ++i) {
+    while (!pool.try_schedule([] () { ++count; })) {
+      std::this_thread::yield();
+    }
+  }
+  auto result = pool.schedule([] () { return (42); }).get();
+  assert(result == 42);
+  while (count < size) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+int main() {
+  run_try_schedule();
+  run_producers();
+  run_concurrent_reserve();
+  run_workers();
+  return (0);
+}
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <memory>
+#include <vector>
 #include "../../includes/thread_pool.hpp"
 #include "../../includes/thread_pool_callable.hpp"
 #include "../../common/executor/async_executor.hpp"
@@ -28,7 +30,93 @@ void static_void_function(int value) {
  count++;
 }
 
+/**
+ * \brief A move-only callable.
+ */
+struct move_only_t {
+ std::unique_ptr<size_t> value;
+
+ void operator()() {
+  count += *value;
+ }
+};
+
+/**
+ * \brief Waits for `count` to reach `target`.
+ */
+void await(size_t target) {
+ while (count < target) {
+  std::this_thread::yield();
+ }
+}
+
+/**
+ * \brief Schedules ranges of callables in bulk.
+ */
+void run_ranges() {
+ thread::pool::pool_t pool(2);
+
+ // Moving move-only callables out of an iterator range.
+ count = 0;
+ std::vector<move_only_t> callables;
+ for (size_t i = 0; i < size; ++i) {
+  callables.push_back(move_only_t{ std::unique_ptr<size_t>(new size_t(1)) });
+ }
+ bool scheduled = pool.schedule_bulk(std::make_move_iterator(callables.begin()), std::make_move_iterator(callables.end()));
+ assert(scheduled);
+ await(size);
+ assert(callables[0].value == nullptr);
+
+ // Moving the callables out of a range passed as an rvalue.
+ for (move_only_t& callable : callables) {
+  callable.value.reset(new size_t(1));
+ }
+ scheduled = pool.schedule_bulk(std::move(callables));
+ assert(scheduled);
+ await(2 * size);
+
+ // Copying the callables of a range passed as an lvalue.
+ std::vector<std::function<void()>> functions(size, [] () { ++count; });
+ const auto token = pool.create_token_of<thread::pool::pool_t::producer_token_t>();
+ scheduled = pool.schedule_bulk(token, functions);
+ assert(scheduled);
+ await(3 * size);
+ assert(functions[0] != nullptr);
+
+ // Scheduling the callables returned by a generator.
+ size_t generated = 0;
+ scheduled = pool.schedule_bulk([&generated] () {
+  return (move_only_t{ std::unique_ptr<size_t>(new size_t(++generated)) });
+ }, size);
+ assert(scheduled);
+ assert(generated == size);
+ await(3 * size + size * (size + 1) / 2);
+}
+
+/**
+ * \brief Schedules index tasks sharing a single callable.
+ */
+void run_bulk_n() {
+ static const size_t tasks = 100 * 1000;
+ thread::pool::pool_t pool(2);
+ std::atomic<size_t> sum(0);
+
+ count = 0;
+ bool scheduled = pool.schedule_bulk_n(tasks, [&sum] (size_t i) { sum += i; ++count; });
+ assert(scheduled);
+ await(tasks);
+ assert(sum == tasks * (tasks - 1) / 2);
+ // Only the blocks of the queue and the shared callable have been allocated.
+ assert(pool.allocation_stats().allocations < tasks / 16);
+ std::cout << "[+] Scheduled " << tasks << " index tasks using "
+  << pool.allocation_stats().allocations << " allocations" << std::endl;
+}
+
 int main() {
+ run_ranges();
+ run_bulk_n();
+
+ count = 0;
  thread::pool::pool_t pool(std::thread::hardware_concurrency() + 1);
  
  // Filling our array with `size` amount of functions,
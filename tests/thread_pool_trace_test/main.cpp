@@ -0,0 +1,144 @@
+#include <iostream>
+#include <sstream>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed work.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Waits for `count` to reach `target`.
+ */
+void await(size_t target) {
+  while (count < target) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \return the number of events of the given type.
+ */
+size_t count_of(const std::vector<thread::pool::trace_event_t>& events, thread::pool::trace_event_type_t type) {
+  size_t result = 0;
+  for (const thread::pool::trace_event_t& event : events) {
+    result += event.type == type;
+  }
+  return (result);
+}
+
+/**
+ * \brief Records the timeline of a pool.
+ */
+void run_trace() {
+  using thread::pool::trace_event_type_t;
+  thread::pool::pool_options_t options;
+  options.trace_events = 1024;
+  thread::pool::pool_t pool(2, options);
+
+  count = 0;
+  for (size_t i = 0; i < 10; ++i) {
+    bool scheduled = pool.schedule_and_forget([] () { ++count; });
+    assert(scheduled);
+  }
+  bool scheduled = pool.schedule_bulk_n(20, [] (size_t) { ++count; });
+  assert(scheduled);
+  await(30);
+  // The end of the last task is recorded after it has run.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  std::vector<thread::pool::trace_event_t> events = pool.trace();
+  assert(count_of(events, trace_event_type_t::ENQUEUE) == 11);
+  assert(count_of(events, trace_event_type_t::START) == 30);
+  assert(count_of(events, trace_event_type_t::END) == 30);
+  size_t dequeued = 0;
+  for (const thread::pool::trace_event_t& event : events) {
+    dequeued += event.type == trace_event_type_t::DEQUEUE ? event.count : 0;
+  }
+  assert(dequeued == 30);
+  // Events are ordered in time within the ring of each thread.
+  for (size_t i = 1; i < events.size(); ++i) {
+    assert(events[i].thread != events[i - 1].thread || events[i].time >= events[i - 1].time);
+  }
+
+  std::ostringstream stream;
+  bool written = pool.write_trace(stream);
+  assert(written);
+  const std::string json = stream.str();
+  assert(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0);
+  assert(json.find("\"name\":\"worker 0\"") != std::string::npos);
+  assert(json.find("\"name\":\"producer 0\"") != std::string::npos);
+  assert(json.find("\"ph\":\"B\",\"name\":\"task\"") != std::string::npos);
+  assert(json.find("\"name\":\"enqueue\",\"args\":{\"count\":20}") != std::string::npos);
+  assert(json.rfind("]}\n") == json.size() - 3);
+  std::cout << "[+] Traced " << events.size() << " events" << std::endl;
+}
+
+/**
+ * \brief Rings keep the most recent events once full.
+ */
+void run_overwrite() {
+  using thread::pool::trace_event_type_t;
+  thread::pool::trace_ring_t ring(6, "ring");
+
+  for (uint32_t i = 0; i < 100; ++i) {
+    ring.record(i, trace_event_type_t::ENQUEUE, i);
+  }
+  std::vector<thread::pool::trace_event_t> events;
+  ring.read(3, events);
+  // The capacity is rounded up to a power of two, and the oldest slot
+  // of a full ring is left out since it may be being overwritten.
+  assert(events.size() == 7);
+  for (size_t i = 0; i < events.size(); ++i) {
+    assert(events[i].count == 93 + i);
+    assert(events[i].thread == 3);
+  }
+  std::cout << "[+] Overwrote the oldest events" << std::endl;
+}
+
+/**
+ * \brief Pools do not trace unless enabled.
+ */
+void run_disabled() {
+  thread::pool::pool_t pool(1);
+  std::ostringstream stream;
+
+  auto status = pool.schedule([] () {}).wait_for(std::chrono::seconds(5));
+  assert(status == std::future_status::ready);
+  assert(pool.trace().empty());
+  bool written = pool.write_trace(stream);
+  assert(!written);
+  assert(stream.str().empty());
+  std::cout << "[+] Did not trace without a ring capacity" << std::endl;
+}
+
+/**
+ * \brief A thread recording on short-lived tracers keeps
+ * using the ring of a tracer which outlives them.
+ */
+void run_successive_tracers() {
+  using thread::pool::trace_event_type_t;
+  thread::pool::tracer_t tracer(16);
+
+  for (uint32_t i = 0; i < 1000; ++i) {
+    thread::pool::tracer_t transient(16);
+    transient.record(trace_event_type_t::ENQUEUE, i);
+    tracer.record(trace_event_type_t::ENQUEUE, i);
+  }
+  std::vector<thread::pool::trace_event_t> events = tracer.events();
+  assert(events.size() == 15);
+  for (size_t i = 0; i < events.size(); ++i) {
+    assert(events[i].count == 985 + i);
+    assert(events[i].thread == 0);
+  }
+  std::cout << "[+] Recorded on 1000 successive tracers" << std::endl;
+}
+
+int main() {
+  run_trace();
+  run_overwrite();
+  run_disabled();
+  run_successive_tracers();
+  return (0);
+}
@@ -0,0 +1,135 @@
+#include <iostream>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief The number of callables scheduled in a burst.
+ */
+static const size_t size = 100 * 1000;
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of executed callables.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief Schedules a burst of callables on the given pool
+ * and waits for all of them to be executed.
+ */
+template <typename Pool>
+void burst(Pool& pool) {
+  size_t target = count + size;
+  for (size_t i = 0; i < size; ++i) {
+    bool scheduled = pool.schedule_and_forget([] () { ++count; });
+    assert(scheduled);
+  }
+  while (count < target) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+/**
+ * \brief Trims the queue of a pool explicitly after a burst.
+ */
+void run_manual_trim() {
+  thread::pool::pool_t pool(1);
+
+  count = 0;
+  burst(pool);
+  size_t released = pool.trim();
+  assert(released > 0);
+  size_t remaining = pool.trim();
+  assert(remaining == 0);
+  // The pool keeps working once its queue has been trimmed.
+  burst(pool);
+  auto result = pool.schedule([] () { return (42); }).get();
+  assert(result == 42);
+  std::cout << "[+] Released " << released << " bytes after a burst" << std::endl;
+}
+
+/**
+ * \brief Queues a burst of callables behind a callable holding the only
+ * worker of the pool, so that the queue grows to hold all of them, and
+ * waits for all of them to be executed.
+ */
+template <typename Pool, typename Schedule>
+void held_burst(Pool& pool, Schedule schedule) {
+  std::atomic<bool> held(true);
+  size_t target = count + size;
+  bool scheduled = pool.schedule_and_forget([&held] () {
+    while (held) {
+      std::this_thread::yield();
+    }
+  });
+  assert(scheduled);
+  for (size_t i = 0; i < size; ++i) {
+    scheduled = schedule();
+    assert(scheduled);
+  }
+  held = false;
+  while (count < target) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+/**
+ * \brief Trims the blocks and the block indexes of a queue which grew
+ * while holding a burst scheduled with and without a producer token.
+ */
+void run_grown_trim() {
+  thread::pool::pool_t pool(1);
+  const auto token = pool.create_token_of<thread::pool::pool_t::producer_token_t>();
+
+  count = 0;
+  size_t in_use = pool.allocation_stats().bytes_in_use;
+  held_burst(pool, [&pool, &token] () { return (pool.schedule_and_forget(token, [] () { ++count; })); });
+  size_t grown = pool.allocation_stats().bytes_in_use;
+  size_t released = pool.trim();
+  assert(released > (grown - in_use) / 2);
+  assert(pool.allocation_stats().bytes_in_use < in_use + (grown - in_use) / 2);
+  std::cout << "[+] Released " << released << " of " << grown - in_use << " bytes after a burst with a token" << std::endl;
+
+  in_use = pool.allocation_stats().bytes_in_use;
+  held_burst(pool, [&pool] () { return (pool.schedule_and_forget([] () { ++count; })); });
+  grown = pool.allocation_stats().bytes_in_use;
+  released = pool.trim();
+  assert(released > (grown - in_use) / 2);
+  assert(pool.allocation_stats().bytes_in_use < in_use + (grown - in_use) / 2);
+  // The pool keeps working once its block indexes have been shrunk.
+  held_burst(pool, [&pool, &token] () { return (pool.schedule_and_forget(token, [] () { ++count; })); });
+  held_burst(pool, [&pool] () { return (pool.schedule_and_forget([] () { ++count; })); });
+  assert(count == 4 * size);
+  std::cout << "[+] Released " << released << " of " << grown - in_use << " bytes after a burst without a token" << std::endl;
+}
+
+/**
+ * \brief Lets idle workers trim the queue on their own, while
+ * bursts keep being scheduled by another thread.
+ */
+void run_auto_trim() {
+  thread::pool::pool_options_t options;
+  options.auto_trim = true;
+  thread::pool::parameterized_pool_t<thread::pool::WORK_PARTITIONING_HEAVY, 20> pool(2, options);
+
+  count = 0;
+  std::thread producer([&pool] () {
+    for (size_t i = 0; i < 10; ++i) {
+      burst(pool);
+      std::this_thread::sleep_for(std::chrono::milliseconds(i * 10));
+    }
+  });
+  producer.join();
+  // Waiting for a worker to be idle for a whole timeout.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  size_t released = pool.trim();
+  assert(released == 0);
+  assert(count == 10 * size);
+  std::cout << "[+] Idle workers trimmed the queue after " << count << " callables" << std::endl;
+}
+
+int main() {
+  run_manual_trim();
+  run_grown_trim();
+  run_auto_trim();
+  return (0);
+}
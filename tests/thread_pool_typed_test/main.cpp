@@ -0,0 +1,149 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "../../includes/thread_pool_typed.hpp"
+
+/**
+ * \brief A record processed by a typed pool.
+ */
+struct record_t {
+  size_t value;
+  size_t result;
+};
+
+/**
+ * \brief An atomic counter keeping track of the
+ * amount of processed records.
+ */
+static std::atomic<size_t> count;
+
+/**
+ * \brief The handler of the typed pool.
+ */
+struct process_t {
+  size_t factor;
+
+  void operator()(record_t* record) const {
+    record->result = record->value * factor;
+    ++count;
+  }
+};
+
+/**
+ * \brief Waits for `count` to reach `target`.
+ */
+void await(size_t target) {
+  while (count < target) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Processes records through a statically known handler.
+ */
+void run_records() {
+  static const size_t size = 100 * 1000;
+  std::vector<record_t> records(size);
+  std::vector<record_t*> pointers;
+  for (size_t i = 0; i < size; ++i) {
+    records[i].value = i;
+    pointers.push_back(&records[i]);
+  }
+  thread::pool::typed_pool_t<record_t*, process_t> pool(2, thread::pool::pool_options_t(), process_t{ 3 });
+  assert(pool.handler().factor == 3);
+
+  count = 0;
+  bool scheduled = pool.schedule(pointers[0]);
+  assert(scheduled);
+  await(1);
+  scheduled = pool.schedule_bulk(pointers.data() + 1, size / 2 - 1);
+  assert(scheduled);
+  scheduled = pool.schedule_bulk(pointers.begin() + size / 2, pointers.end());
+  assert(scheduled);
+  await(size);
+  for (size_t i = 0; i < size; ++i) {
+    assert(records[i].result == i * 3);
+  }
+  // Scheduling the pointers only allocated the blocks of the queue.
+  assert(pool.allocation_stats().allocations < size / 16);
+  std::cout << "[+] Processed " << size << " records using "
+    << pool.allocation_stats().allocations << " allocations" << std::endl;
+}
+
+/**
+ * \brief Runs callables with the default handler, using a token.
+ */
+void run_callables() {
+  thread::pool::typed_pool_t<std::function<void()>> pool(2);
+  const auto token = pool.create_token_of<decltype(pool)::producer_token_t>();
+  std::vector<std::function<void()>> callables(100, [] () { ++count; });
+
+  count = 0;
+  bool scheduled = pool.schedule(token, [] () { ++count; });
+  assert(scheduled);
+  scheduled = pool.schedule_bulk(token, std::make_move_iterator(callables.begin()), std::make_move_iterator(callables.end()));
+  assert(scheduled);
+  await(101);
+  std::cout << "[+] Ran callables with the default handler" << std::endl;
+}
+
+/**
+ * \brief Hooks counting the tasks run by the workers.
+ */
+struct counting_hooks_t : public thread::pool::no_hooks_t {
+  std::shared_ptr<std::atomic<size_t>> after = std::make_shared<std::atomic<size_t>>(0);
+
+  void after_task(size_t, record_t* const&) noexcept {
+    ++*after;
+  }
+};
+
+/**
+ * \brief Collects metrics, runs hooks and traces the tasks of a typed pool,
+ * whose workers are shared with the type-erased pool.
+ */
+void run_instrumented() {
+  static const size_t size = 1000;
+  std::vector<record_t> records(size);
+  std::vector<record_t*> pointers;
+  for (size_t i = 0; i < size; ++i) {
+    records[i].value = i;
+    pointers.push_back(&records[i]);
+  }
+  thread::pool::pool_options_t options;
+  options.trace_events = 4096;
+  thread::pool::typed_pool_t<
+    record_t*,
+    process_t,
+    thread::pool::WORK_PARTITIONING_LIGHT,
+    1000,
+    thread::pool::spin_yield_park_t<>,
+    thread::pool::moodycamel_queue_t,
+    thread::pool::pool_metrics_t,
+    counting_hooks_t
+  > pool(2, options, process_t{ 2 });
+
+  count = 0;
+  bool reserved = pool.reserve(size);
+  assert(reserved);
+  bool scheduled = pool.schedule_bulk(pointers.begin(), pointers.end());
+  assert(scheduled);
+  await(size);
+  pool.stop().await();
+  thread::pool::metrics_snapshot_t snapshot = pool.snapshot();
+  assert(snapshot.enqueued == size);
+  assert(snapshot.completed == size);
+  assert(*pool.hooks().after == size);
+  std::ostringstream stream;
+  bool written = pool.write_trace(stream);
+  assert(written);
+  assert(stream.str().find("\"name\":\"enqueue\",\"args\":{\"count\":1000}") != std::string::npos);
+  std::cout << "[+] Collected the metrics of " << snapshot.completed << " typed tasks" << std::endl;
+}
+
+int main() {
+  run_records();
+  run_callables();
+  run_instrumented();
+  return (0);
+}
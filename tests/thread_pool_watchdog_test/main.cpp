@@ -0,0 +1,135 @@
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include "../../includes/thread_pool.hpp"
+
+/**
+ * \brief The events reported by the watchdog.
+ */
+static std::vector<thread::pool::watchdog_event_t> events;
+
+/**
+ * \brief Lock guarding the reported events.
+ */
+static std::mutex lock;
+
+/**
+ * \brief Records an event reported by the watchdog.
+ */
+void report(const thread::pool::watchdog_event_t& event) {
+  std::lock_guard<std::mutex> guard(lock);
+  events.push_back(event);
+}
+
+/**
+ * \return the number of reported events of the given kind.
+ */
+size_t count_of(thread::pool::watchdog_event_t::kind_t kind) {
+  std::lock_guard<std::mutex> guard(lock);
+  size_t count = 0;
+  for (const thread::pool::watchdog_event_t& event : events) {
+    count += event.kind == kind;
+  }
+  return (count);
+}
+
+/**
+ * \return watchdog options reporting to `report()`.
+ */
+thread::pool::pool_options_t watched(std::chrono::milliseconds slow, std::chrono::milliseconds stall) {
+  thread::pool::pool_options_t options;
+  options.watchdog_period = std::chrono::milliseconds(10);
+  options.slow_task_threshold = slow;
+  options.stall_threshold = stall;
+  options.watchdog = &report;
+  return (options);
+}
+
+/**
+ * \brief Reports a task running for longer than the threshold, once.
+ */
+void run_slow_task() {
+  events.clear();
+  thread::pool::pool_t pool(2, watched(std::chrono::milliseconds(50), std::chrono::milliseconds(0)));
+
+  for (size_t i = 0; i < 100; ++i) {
+    pool.schedule_and_forget([] () {});
+  }
+  auto future = pool.schedule(thread::pool::task_label_t("lost-lock"), [] () {
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  });
+  future.wait();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  assert(count_of(thread::pool::watchdog_event_t::SLOW_TASK) == 1);
+  assert(count_of(thread::pool::watchdog_event_t::STALL) == 0);
+  const thread::pool::watchdog_event_t& event = events.front();
+  assert(std::strcmp(event.label, "lost-lock") == 0);
+  assert(event.worker < 2);
+  assert(event.elapsed >= std::chrono::milliseconds(50));
+  std::cout << "[+] Reported a slow task after " << event.elapsed.count() << " ms" << std::endl;
+}
+
+/**
+ * \brief Reports every worker being stuck while tasks are queued.
+ */
+void run_stall() {
+  events.clear();
+  thread::pool::pool_t pool(2, watched(std::chrono::milliseconds(0), std::chrono::milliseconds(50)));
+  std::atomic<bool> release(false);
+  std::atomic<size_t> started(0);
+
+  // Waiting for each blocking task to start, so that
+  // they are not dequeued at once by the same worker.
+  for (size_t i = 0; i < 2; ++i) {
+    pool.schedule_and_forget([&release, &started] () {
+      ++started;
+      while (!release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+    while (started <= i) {
+      std::this_thread::yield();
+    }
+  }
+  auto future = pool.schedule([] () { return (42); });
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (count_of(thread::pool::watchdog_event_t::STALL) == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  release = true;
+  auto result = future.get();
+  assert(result == 42);
+
+  assert(count_of(thread::pool::watchdog_event_t::STALL) == 1);
+  assert(count_of(thread::pool::watchdog_event_t::SLOW_TASK) == 0);
+  const thread::pool::watchdog_event_t& event = events.front();
+  assert(event.worker == 2);
+  assert(event.label == nullptr);
+  assert(event.queue_depth >= 1);
+  assert(event.elapsed >= std::chrono::milliseconds(50));
+  std::cout << "[+] Reported a stall with " << event.queue_depth << " queued task" << std::endl;
+}
+
+/**
+ * \brief Does not report anything for short tasks.
+ */
+void run_quiet() {
+  events.clear();
+  thread::pool::pool_t pool(2, watched(std::chrono::milliseconds(100), std::chrono::milliseconds(100)));
+
+  for (size_t i = 0; i < 20; ++i) {
+    pool.schedule([] () {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }).wait();
+  }
+  assert(events.empty());
+  std::cout << "[+] Did not report short tasks" << std::endl;
+}
+
+int main() {
+  run_slow_task();
+  run_stall();
+  run_quiet();
+  return (0);
+}